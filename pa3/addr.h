@@ -0,0 +1,94 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file addr.h
+ * @brief Compact binary set of the addresses a hostname resolves to
+ *
+ * Definitions for passing every A and AAAA record of a name between the
+ * backends, the cache and the log writer without turning them into text.
+ * Addresses are kept in network byte order, and only the log writer ever
+ * formats them.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __ADDR_H__
+#define __ADDR_H__
+
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#define ADDR_SET_MAX (8)
+
+#define ADDR_V4 (4)
+#define ADDR_V6 (6)
+
+typedef struct
+{
+  uint8_t family;
+  uint8_t bytes[16];
+} addr_t;
+
+typedef struct
+{
+  uint8_t count;
+  addr_t addrs[ADDR_SET_MAX];
+} addr_set_t;
+
+/**
+ * @brief Add an address to a set, skipping duplicates and once full
+ *
+ * @param ptr_set A pointer to the set
+ * @param family ADDR_V4 or ADDR_V6
+ * @param bytes The 4 or 16 address bytes in network byte order
+ *
+ * @return 0 if the address is in the set, -1 if the set is full
+ */
+static inline int addr_set_add(addr_set_t * ptr_set, int family, const void * bytes)
+{
+  int len = family == ADDR_V4 ? 4 : 16;
+
+  for(int i = 0; i < ptr_set->count; i++)
+  {
+    if(ptr_set->addrs[i].family == family && memcmp(ptr_set->addrs[i].bytes, bytes, len) == 0)
+    {
+      return 0;
+    }
+  }
+  if(ptr_set->count >= ADDR_SET_MAX)
+  {
+    return -1;
+  }
+  ptr_set->addrs[ptr_set->count].family = family;
+  memcpy(ptr_set->addrs[ptr_set->count].bytes, bytes, len);
+  ptr_set->count++;
+
+  return 0;
+}
+
+/**
+ * @brief Format one address as text
+ *
+ * @param ptr_addr A pointer to the address
+ * @param str Where the text is stored, at least INET6_ADDRSTRLEN bytes
+ *
+ * @return str
+ */
+static inline const char * addr_format(const addr_t * ptr_addr, char * str)
+{
+  return inet_ntop(ptr_addr->family == ADDR_V4 ? AF_INET : AF_INET6, ptr_addr->bytes, str, INET6_ADDRSTRLEN);
+}
+
+#endif /* __ADDR_H__ */
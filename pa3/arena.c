@@ -0,0 +1,86 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file arena.c
+ * @brief Append-only arena for hostname strings
+ *
+ * Implementations for the string arena. Only the newest block is filled,
+ * space left at the end of older blocks is not reused.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+void arena_init(arena_t * ptr_arena, size_t block_size)
+{
+  ptr_arena->ptr_block = NULL;
+  ptr_arena->block_size = block_size;
+}
+
+void arena_free(arena_t * ptr_arena)
+{
+  arena_block_t * ptr_next;
+
+  while(ptr_arena->ptr_block != NULL)
+  {
+    ptr_next = ptr_arena->ptr_block->next;
+    free((void *)ptr_arena->ptr_block);
+    ptr_arena->ptr_block = ptr_next;
+  }
+}
+
+char * arena_reserve(arena_t * ptr_arena, size_t size)
+{
+  arena_block_t * ptr_block = ptr_arena->ptr_block;
+  size_t block_size;
+
+  // start a new block if the string does not fit in the current one
+  if(ptr_block == NULL || ptr_block->size - ptr_block->used < size)
+  {
+    block_size = size > ptr_arena->block_size ? size : ptr_arena->block_size;
+    if( (ptr_block = (arena_block_t *)malloc(sizeof(arena_block_t) + block_size)) == NULL )
+    {
+      return NULL;
+    }
+    ptr_block->next = ptr_arena->ptr_block;
+    ptr_block->used = 0;
+    ptr_block->size = block_size;
+    ptr_arena->ptr_block = ptr_block;
+  }
+
+  return ptr_block->data + ptr_block->used;
+}
+
+void arena_commit(arena_t * ptr_arena, size_t len)
+{
+  ptr_arena->ptr_block->used += len;
+}
+
+char * arena_strndup(arena_t * ptr_arena, const char * str, size_t len)
+{
+  char * copy;
+
+  if( (copy = arena_reserve(ptr_arena, len + 1)) == NULL )
+  {
+    return NULL;
+  }
+  memcpy(copy, str, len);
+  copy[len] = '\0';
+  arena_commit(ptr_arena, len + 1);
+
+  return copy;
+}
@@ -0,0 +1,99 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file arena.h
+ * @brief Append-only arena for hostname strings
+ *
+ * Definitions and declarations for an arena that one thread copies
+ * strings into. Strings are packed into large blocks and never freed one
+ * at a time, so the allocator is only called once per block and the whole
+ * arena is released at once when the strings are no longer needed.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+#define ARENA_DEFAULT_BLOCK_SIZE (1024 * 1024)
+
+typedef struct arena_block
+{
+  struct arena_block * next;
+  size_t used;
+  size_t size;
+  char data[];
+} arena_block_t;
+
+typedef struct
+{
+  arena_block_t * ptr_block;
+  size_t block_size;
+} arena_t;
+
+/**
+ * @brief Create an empty arena
+ *
+ * No memory is allocated until the first string is added.
+ *
+ * @param ptr_arena A pointer to the arena
+ * @param block_size The size of the blocks strings are packed into
+ */
+void arena_init(arena_t * ptr_arena, size_t block_size);
+
+/**
+ * @brief Free every block of an arena, and with them every string
+ *
+ * @param ptr_arena A pointer to the arena
+ */
+void arena_free(arena_t * ptr_arena);
+
+/**
+ * @brief Copy a string into the arena
+ *
+ * Starts a new block when the current one is full. A string longer than
+ * a block gets a block of its own.
+ *
+ * @param ptr_arena A pointer to the arena
+ * @param str The string, which need not be null terminated
+ * @param len The length of the string
+ *
+ * @return The null terminated copy, NULL if a block could not be allocated
+ */
+char * arena_strndup(arena_t * ptr_arena, const char * str, size_t len);
+
+/**
+ * @brief Make room at the end of the arena for a string of unknown length
+ *
+ * The space stays free until arena_commit() keeps part of it, so a string
+ * can be written straight into the arena and only its real length used.
+ *
+ * @param ptr_arena A pointer to the arena
+ * @param size The most bytes that will be written
+ *
+ * @return Where to write them, NULL if a block could not be allocated
+ */
+char * arena_reserve(arena_t * ptr_arena, size_t size);
+
+/**
+ * @brief Keep the first bytes of the space from arena_reserve()
+ *
+ * @param ptr_arena A pointer to the arena
+ * @param len How many bytes to keep, at most the size reserved
+ */
+void arena_commit(arena_t * ptr_arena, size_t len);
+
+#endif /* __ARENA_H__ */
@@ -0,0 +1,292 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file autoscale.c
+ * @brief Thread pools that grow and shrink while the program runs
+ *
+ * Implementations for the pool controller. A pool's thread count and
+ * stopped flag only change under the controller's mutex, so a thread can
+ * never be created after its pool has been stopped.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include "autoscale.h"
+#include "timing.h"
+
+/**
+ * @brief Set up one pool with its target at the minimum
+ */
+static int autoscale_pool_init(autoscale_pool_t * ptr_pool, int min, int max)
+{
+  if( (ptr_pool->threads = (pthread_t *)malloc(sizeof(pthread_t) * max)) == NULL )
+  {
+    return -1;
+  }
+  ptr_pool->min = min;
+  ptr_pool->max = max;
+  atomic_init(&ptr_pool->target, min);
+  atomic_init(&ptr_pool->next_idx, 0);
+  ptr_pool->spawned = 0;
+  ptr_pool->exited = 0;
+  ptr_pool->peak = 0;
+  ptr_pool->stopped_f = 0;
+  ptr_pool->start = NULL;
+  ptr_pool->arg = NULL;
+
+  return 0;
+}
+
+int autoscale_init(autoscale_t ** ptr_autoscale, int min_requester, int max_requester,
+                   int min_resolver, int max_resolver, int interval_ms)
+{
+  pthread_condattr_t cond_attr;
+
+  if( (*ptr_autoscale = (autoscale_t *)malloc(sizeof(autoscale_t))) == NULL )
+  {
+    return -1;
+  }
+
+  if( autoscale_pool_init(&(*ptr_autoscale)->requesters, min_requester, max_requester) != 0 )
+  {
+    free((void *)*ptr_autoscale);
+    return -1;
+  }
+  if( autoscale_pool_init(&(*ptr_autoscale)->resolvers, min_resolver, max_resolver) != 0 )
+  {
+    free((void *)(*ptr_autoscale)->requesters.threads);
+    free((void *)*ptr_autoscale);
+    return -1;
+  }
+
+  // time the controller's sleeps on the monotonic clock like everything else
+  pthread_condattr_init(&cond_attr);
+  pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&(*ptr_autoscale)->cond, &cond_attr);
+  pthread_condattr_destroy(&cond_attr);
+  lockprof_mutex_init(&(*ptr_autoscale)->mutex, "autoscale");
+  (*ptr_autoscale)->interval_ms = interval_ms;
+  atomic_init(&(*ptr_autoscale)->resolver_idle_ns, 0);
+  atomic_init(&(*ptr_autoscale)->lookup_ns, 0);
+  atomic_init(&(*ptr_autoscale)->lookups, 0);
+
+  return 0;
+}
+
+void autoscale_free(autoscale_t * ptr_autoscale)
+{
+  lockprof_mutex_destroy(&ptr_autoscale->mutex);
+  pthread_cond_destroy(&ptr_autoscale->cond);
+  free((void *)ptr_autoscale->requesters.threads);
+  free((void *)ptr_autoscale->resolvers.threads);
+  free((void *)ptr_autoscale);
+}
+
+/**
+ * @brief Create threads until the pool holds as many as its target
+ *
+ * Must be called with the controller's mutex held.
+ */
+static int autoscale_spawn(autoscale_pool_t * ptr_pool)
+{
+  int target = atomic_load(&ptr_pool->target);
+
+  while(!ptr_pool->stopped_f && ptr_pool->spawned < target)
+  {
+    if( pthread_create(&ptr_pool->threads[ptr_pool->spawned], NULL, ptr_pool->start, ptr_pool->arg) != 0 )
+    {
+      return -1;
+    }
+    ptr_pool->spawned++;
+  }
+  if(ptr_pool->spawned > ptr_pool->peak)
+  {
+    ptr_pool->peak = ptr_pool->spawned;
+  }
+
+  return 0;
+}
+
+int autoscale_start(autoscale_t * ptr_autoscale, autoscale_pool_t * ptr_pool, void * (* start)(void *), void * arg)
+{
+  int ret;
+
+  lockprof_lock(&ptr_autoscale->mutex);
+  ptr_pool->start = start;
+  ptr_pool->arg = arg;
+  ret = autoscale_spawn(ptr_pool);
+  lockprof_unlock(&ptr_autoscale->mutex);
+
+  return ret;
+}
+
+int autoscale_index(autoscale_pool_t * ptr_pool)
+{
+  return atomic_fetch_add(&ptr_pool->next_idx, 1);
+}
+
+int autoscale_park(autoscale_t * ptr_autoscale, autoscale_pool_t * ptr_pool, int idx)
+{
+  int ret = 0;
+
+  // fast path, the thread is wanted
+  if(idx < atomic_load_explicit(&ptr_pool->target, memory_order_relaxed))
+  {
+    return 0;
+  }
+
+  lockprof_lock(&ptr_autoscale->mutex);
+  while(idx >= atomic_load(&ptr_pool->target))
+  {
+    if(ptr_pool->stopped_f)
+    {
+      ret = -1;
+      break;
+    }
+    lockprof_cond_wait(&ptr_autoscale->cond, &ptr_autoscale->mutex);
+  }
+  lockprof_unlock(&ptr_autoscale->mutex);
+
+  return ret;
+}
+
+void autoscale_stop(autoscale_t * ptr_autoscale, autoscale_pool_t * ptr_pool)
+{
+  lockprof_lock(&ptr_autoscale->mutex);
+  ptr_pool->stopped_f = 1;
+  pthread_cond_broadcast(&ptr_autoscale->cond);
+  lockprof_unlock(&ptr_autoscale->mutex);
+}
+
+int autoscale_exit(autoscale_t * ptr_autoscale, autoscale_pool_t * ptr_pool)
+{
+  int last_f;
+
+  lockprof_lock(&ptr_autoscale->mutex);
+  ptr_pool->exited++;
+  last_f = ptr_pool->stopped_f && ptr_pool->exited == ptr_pool->spawned;
+  if(last_f)
+  {
+    pthread_cond_broadcast(&ptr_autoscale->cond);
+  }
+  lockprof_unlock(&ptr_autoscale->mutex);
+
+  return last_f;
+}
+
+/**
+ * @brief Move a pool's target by a step, keeping it within its bounds
+ */
+static void autoscale_step(autoscale_pool_t * ptr_pool, int step)
+{
+  int target = atomic_load(&ptr_pool->target) + step;
+
+  if(target < ptr_pool->min) target = ptr_pool->min;
+  if(target > ptr_pool->max) target = ptr_pool->max;
+  atomic_store(&ptr_pool->target, target);
+}
+
+/**
+ * @brief Pick new targets from what happened over the last interval
+ *
+ * A backed up queue with busy resolvers needs more resolvers, grown by
+ * half at a time when lookups are slow enough that threads mostly wait on
+ * the network. Resolvers idle for most of the interval are shrunk, and if
+ * they are starved while the queue is nearly empty the requesters are
+ * grown instead. A nearly full queue means the requesters are ahead, so
+ * one is parked.
+ *
+ * Must be called with the controller's mutex held.
+ */
+static void autoscale_adjust(autoscale_t * ptr_autoscale, queue_t * ptr_queue)
+{
+  size_t capacity = ptr_queue->mask + 1;
+  size_t depth = queue_depth(ptr_queue);
+  long long idle_ns = atomic_exchange(&ptr_autoscale->resolver_idle_ns, 0);
+  long long lookup_ns = atomic_exchange(&ptr_autoscale->lookup_ns, 0);
+  long lookups = atomic_exchange(&ptr_autoscale->lookups, 0);
+  int num_resolver = atomic_load(&ptr_autoscale->resolvers.target);
+  double idle_frac = (double)idle_ns / ((double)num_resolver * ptr_autoscale->interval_ms * 1000000);
+
+  if(!ptr_autoscale->resolvers.stopped_f)
+  {
+    if(depth >= capacity / 4 && idle_frac < 0.1)
+    {
+      autoscale_step(&ptr_autoscale->resolvers,
+                     lookups > 0 && lookup_ns / lookups >= AUTOSCALE_SLOW_LOOKUP_NS ? num_resolver / 2 + 1 : 1);
+    }
+    else if(depth < capacity / 4 && idle_frac > 0.5)
+    {
+      autoscale_step(&ptr_autoscale->resolvers, -1);
+    }
+  }
+
+  if(!ptr_autoscale->requesters.stopped_f)
+  {
+    if(depth < capacity / 4 && idle_frac > 0.25)
+    {
+      autoscale_step(&ptr_autoscale->requesters, 1);
+    }
+    else if(depth > capacity * 3 / 4)
+    {
+      autoscale_step(&ptr_autoscale->requesters, -1);
+    }
+  }
+
+  // start any threads the pools have not had yet and wake parked ones
+  autoscale_spawn(&ptr_autoscale->requesters);
+  autoscale_spawn(&ptr_autoscale->resolvers);
+  pthread_cond_broadcast(&ptr_autoscale->cond);
+}
+
+void autoscale_run(autoscale_t * ptr_autoscale, queue_t * ptr_queue)
+{
+  autoscale_pool_t * ptr_resolvers = &ptr_autoscale->resolvers;
+  int fixed_f = ptr_autoscale->requesters.min == ptr_autoscale->requesters.max &&
+                ptr_resolvers->min == ptr_resolvers->max;
+  struct timespec deadline;
+  long long next_ns = now_ns();
+
+  lockprof_lock(&ptr_autoscale->mutex);
+  while(!ptr_resolvers->stopped_f || ptr_resolvers->exited < ptr_resolvers->spawned)
+  {
+    // fixed pools only need to wait for the threads to finish
+    if(fixed_f)
+    {
+      lockprof_cond_wait(&ptr_autoscale->cond, &ptr_autoscale->mutex);
+      continue;
+    }
+
+    next_ns += (long long)ptr_autoscale->interval_ms * 1000000;
+    deadline.tv_sec = next_ns / 1000000000;
+    deadline.tv_nsec = next_ns % 1000000000;
+    while( (!ptr_resolvers->stopped_f || ptr_resolvers->exited < ptr_resolvers->spawned) &&
+           lockprof_cond_timedwait(&ptr_autoscale->cond, &ptr_autoscale->mutex, &deadline) != ETIMEDOUT );
+
+    autoscale_adjust(ptr_autoscale, ptr_queue);
+  }
+  lockprof_unlock(&ptr_autoscale->mutex);
+
+  // every thread has exited or is about to, and no more can be created
+  for(int i = 0; i < ptr_autoscale->requesters.spawned; i++)
+  {
+    pthread_join(ptr_autoscale->requesters.threads[i], NULL);
+  }
+  for(int i = 0; i < ptr_resolvers->spawned; i++)
+  {
+    pthread_join(ptr_resolvers->threads[i], NULL);
+  }
+}
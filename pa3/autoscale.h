@@ -0,0 +1,158 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file autoscale.h
+ * @brief Thread pools that grow and shrink while the program runs
+ *
+ * Definitions and declarations for a controller that sizes the requester
+ * and resolver pools. Every thread of a pool has a fixed index, and only
+ * threads with an index below the pool's target run; the rest park until
+ * the target rises again or the pool is stopped. Threads are created the
+ * first time the target reaches them, so a pool never holds more threads
+ * than its peak. The controller samples the queue depth, how long the
+ * resolvers sit idle and how long lookups take, and moves each target
+ * between its pool's bounds.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __AUTOSCALE_H__
+#define __AUTOSCALE_H__
+
+#include <pthread.h>
+#include "lockprof.h"
+#include <stdatomic.h>
+#include "queue.h"
+
+#define AUTOSCALE_DEFAULT_INTERVAL_MS (100)
+#define AUTOSCALE_MAX_THREADS (1024)
+
+// lookups slower than this leave a blocking resolver waiting on the network
+// rather than the CPU, so its pool is grown faster
+#define AUTOSCALE_SLOW_LOOKUP_NS (1000000)
+
+typedef struct
+{
+  int min;
+  int max;
+  atomic_int target;
+  atomic_int next_idx;
+  int spawned;
+  int exited;
+  int peak;
+  int stopped_f;
+  pthread_t * threads;
+  void * (* start)(void *);
+  void * arg;
+} autoscale_pool_t;
+
+typedef struct
+{
+  lockprof_mutex_t mutex;
+  pthread_cond_t cond;
+  int interval_ms;
+  autoscale_pool_t requesters;
+  autoscale_pool_t resolvers;
+  atomic_llong resolver_idle_ns;
+  atomic_llong lookup_ns;
+  atomic_long lookups;
+} autoscale_t;
+
+/**
+ * @brief Create a controller for the two pools
+ *
+ * Fixed pools are created with min equal to max.
+ *
+ * @param ptr_autoscale A pointer to the uninitialized controller pointer
+ * @param min_requester The fewest requester threads to run
+ * @param max_requester The most requester threads to run
+ * @param min_resolver The fewest resolver threads to run
+ * @param max_resolver The most resolver threads to run
+ * @param interval_ms How often the targets are adjusted
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int autoscale_init(autoscale_t ** ptr_autoscale, int min_requester, int max_requester,
+                   int min_resolver, int max_resolver, int interval_ms);
+
+/**
+ * @brief Free a controller from the heap
+ *
+ * @param ptr_autoscale A pointer to the controller
+ */
+void autoscale_free(autoscale_t * ptr_autoscale);
+
+/**
+ * @brief Start the minimum number of threads of a pool
+ *
+ * @param ptr_autoscale A pointer to the controller
+ * @param ptr_pool The pool
+ * @param start The function every thread of the pool runs
+ * @param arg The argument every thread of the pool is given
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int autoscale_start(autoscale_t * ptr_autoscale, autoscale_pool_t * ptr_pool, void * (* start)(void *), void * arg);
+
+/**
+ * @brief Get the index of the calling thread in its pool
+ *
+ * Called once when the thread starts. Indices are below the pool's max.
+ *
+ * @param ptr_pool The pool
+ *
+ * @return The index
+ */
+int autoscale_index(autoscale_pool_t * ptr_pool);
+
+/**
+ * @brief Park the calling thread while the pool does not need it
+ *
+ * Returns right away while the thread's index is below the target.
+ *
+ * @param ptr_autoscale A pointer to the controller
+ * @param ptr_pool The pool
+ * @param idx The index of the calling thread
+ *
+ * @return 0 once the thread should run, -1 if the pool has been stopped
+ */
+int autoscale_park(autoscale_t * ptr_autoscale, autoscale_pool_t * ptr_pool, int idx);
+
+/**
+ * @brief Stop a pool, waking every parked thread and starting no more
+ *
+ * @param ptr_autoscale A pointer to the controller
+ * @param ptr_pool The pool
+ */
+void autoscale_stop(autoscale_t * ptr_autoscale, autoscale_pool_t * ptr_pool);
+
+/**
+ * @brief Record that a thread of a pool is exiting
+ *
+ * @param ptr_autoscale A pointer to the controller
+ * @param ptr_pool The pool
+ *
+ * @return 1 if the pool is stopped and this was its last thread, 0 otherwise
+ */
+int autoscale_exit(autoscale_t * ptr_autoscale, autoscale_pool_t * ptr_pool);
+
+/**
+ * @brief Adjust the pools until every resolver has exited, then join all threads
+ *
+ * @param ptr_autoscale A pointer to the controller
+ * @param ptr_queue The queue between the two pools
+ */
+void autoscale_run(autoscale_t * ptr_autoscale, queue_t * ptr_queue);
+
+#endif /* __AUTOSCALE_H__ */
@@ -0,0 +1,761 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file backend.c
+ * @brief Interchangeable ways of resolving a hostname
+ *
+ * Implementations for the getaddrinfo, hosts file, mock and replay
+ * backends, and the recorder that can wrap any of them. The hosts and
+ * replay tables are read-only once loaded, apart from the count of times
+ * each replayed name was used, and the mock keeps its random state per
+ * thread, so all of them can be shared by every resolver thread. The
+ * recorder writes one line per lookup under its own lock.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include "backend.h"
+#include "util.h"
+#include "cache.h"
+#include "arena.h"
+#include "timing.h"
+#include "lockprof.h"
+
+#define HOSTS_NAME_ARENA_SIZE (64 * 1024)
+
+#define MOCK_FIXED (0)
+#define MOCK_UNIFORM (1)
+#define MOCK_LOGNORMAL (2)
+
+typedef struct
+{
+  backend_t base;
+  int ipv6_f;
+} getaddrinfo_backend_t;
+
+typedef struct
+{
+  uint64_t hash;
+  const char * name;
+  addr_set_t addrs;
+} hosts_entry_t;
+
+typedef struct
+{
+  backend_t base;
+  hosts_entry_t * table;
+  size_t mask;
+  arena_t names;
+} hosts_backend_t;
+
+typedef struct
+{
+  backend_t base;
+  int dist;
+  double a;
+  double b;
+  double fail_rate;
+} mock_backend_t;
+
+typedef struct
+{
+  long long latency_ns;
+  int status;
+  addr_set_t addrs;
+} replay_record_t;
+
+typedef struct
+{
+  uint64_t hash;
+  const char * name;
+  size_t first;
+  size_t num_records;
+  size_t filled;
+  atomic_size_t uses;
+} replay_entry_t;
+
+typedef struct
+{
+  backend_t base;
+  replay_entry_t * table;
+  size_t mask;
+  replay_record_t * records;
+  arena_t names;
+} replay_backend_t;
+
+typedef struct
+{
+  backend_t base;
+  backend_t * ptr_inner;
+  FILE * ptr_file;
+  lockprof_mutex_t mutex;
+} record_backend_t;
+
+/**
+ * @brief Sleep for a number of nanoseconds, resuming after signals
+ */
+static void backend_sleep_ns(long long delay_ns)
+{
+  struct timespec delay;
+
+  if(delay_ns <= 0)
+  {
+    return;
+  }
+  delay.tv_sec = (time_t)(delay_ns / 1000000000);
+  delay.tv_nsec = (long)(delay_ns % 1000000000);
+  while( nanosleep(&delay, &delay) != 0 );
+}
+
+/**
+ * @brief Parse the text form of an address into family and bytes
+ *
+ * @return 0 if successful, -1 if it is not an IPv4 or IPv6 address
+ */
+static int backend_parse_addr(const char * str, int * ptr_family, void * bytes)
+{
+  if( inet_pton(AF_INET, str, bytes) == 1 )
+  {
+    *ptr_family = ADDR_V4;
+    return 0;
+  }
+  if( inet_pton(AF_INET6, str, bytes) == 1 )
+  {
+    *ptr_family = ADDR_V6;
+    return 0;
+  }
+
+  return -1;
+}
+
+/*
+ * getaddrinfo
+ */
+static int getaddrinfo_lookup(backend_t * ptr_backend, const char * hostname, addr_set_t * ptr_addrs)
+{
+  return dnslookup_all(hostname, ptr_addrs, ((getaddrinfo_backend_t *)ptr_backend)->ipv6_f);
+}
+
+static void getaddrinfo_destroy(backend_t * ptr_backend)
+{
+  free((void *)ptr_backend);
+}
+
+/*
+ * Hosts file
+ */
+static int hosts_lookup(backend_t * ptr_backend, const char * hostname, addr_set_t * ptr_addrs)
+{
+  hosts_backend_t * ptr_hosts = (hosts_backend_t *)ptr_backend;
+  uint64_t hash = cache_hash(hostname);
+  hosts_entry_t * ptr_entry;
+
+  for(size_t i = hash & ptr_hosts->mask; (ptr_entry = &ptr_hosts->table[i])->name != NULL; i = (i + 1) & ptr_hosts->mask)
+  {
+    if(ptr_entry->hash == hash && strcasecmp(ptr_entry->name, hostname) == 0)
+    {
+      *ptr_addrs = ptr_entry->addrs;
+      return UTIL_SUCCESS;
+    }
+  }
+
+  return UTIL_FAILURE;
+}
+
+static void hosts_destroy(backend_t * ptr_backend)
+{
+  hosts_backend_t * ptr_hosts = (hosts_backend_t *)ptr_backend;
+
+  arena_free(&ptr_hosts->names);
+  free((void *)ptr_hosts->table);
+  free((void *)ptr_hosts);
+}
+
+/**
+ * @brief Add an address of a name to the hosts table
+ *
+ * A name listed on several lines gets every address, in file order.
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+static int hosts_add(hosts_backend_t * ptr_hosts, const char * name, int family, const void * bytes)
+{
+  uint64_t hash = cache_hash(name);
+  hosts_entry_t * ptr_entry;
+  size_t i;
+
+  for(i = hash & ptr_hosts->mask; (ptr_entry = &ptr_hosts->table[i])->name != NULL; i = (i + 1) & ptr_hosts->mask)
+  {
+    if(ptr_entry->hash == hash && strcasecmp(ptr_entry->name, name) == 0)
+    {
+      addr_set_add(&ptr_entry->addrs, family, bytes);
+      return 0;
+    }
+  }
+
+  if( (ptr_entry->name = arena_strndup(&ptr_hosts->names, name, strlen(name))) == NULL )
+  {
+    return -1;
+  }
+  ptr_entry->hash = hash;
+  ptr_entry->addrs.count = 0;
+  addr_set_add(&ptr_entry->addrs, family, bytes);
+
+  return 0;
+}
+
+/**
+ * @brief Read a hosts file into a table
+ *
+ * Each line is an address followed by its names, and anything after a #
+ * is a comment. Lines whose address does not parse are skipped.
+ */
+static int hosts_init(backend_t ** ptr_backend, const char * file_name)
+{
+  hosts_backend_t * ptr_hosts;
+  FILE * ptr_file;
+  char * line = NULL;
+  size_t line_size = 0;
+  size_t num_names = 0;
+  size_t size = 16;
+  unsigned char addr[sizeof(struct in6_addr)];
+  char * ip_str;
+  char * name;
+  char * save;
+  int family;
+  int pass;
+
+  if( (ptr_file = fopen(file_name, "r")) == NULL )
+  {
+    return -1;
+  }
+
+  if( (ptr_hosts = (hosts_backend_t *)malloc(sizeof(hosts_backend_t))) == NULL )
+  {
+    fclose(ptr_file);
+    return -1;
+  }
+  ptr_hosts->base.lookup = hosts_lookup;
+  ptr_hosts->base.destroy = hosts_destroy;
+  ptr_hosts->table = NULL;
+  arena_init(&ptr_hosts->names, HOSTS_NAME_ARENA_SIZE);
+
+  // count the names on the first pass so the table never has to grow,
+  // then fill it on the second
+  for(pass = 0; pass < 2; pass++)
+  {
+    rewind(ptr_file);
+    while( getline(&line, &line_size, ptr_file) != -1 )
+    {
+      line[strcspn(line, "#")] = '\0';
+      if( (ip_str = strtok_r(line, " \t\r\n", &save)) == NULL )
+      {
+        continue;
+      }
+      if( backend_parse_addr(ip_str, &family, addr) != 0 )
+      {
+        continue;
+      }
+      while( (name = strtok_r(NULL, " \t\r\n", &save)) != NULL )
+      {
+        if(pass == 0)
+        {
+          num_names++;
+        }
+        else if( hosts_add(ptr_hosts, name, family, addr) != 0 )
+        {
+          free((void *)line);
+          fclose(ptr_file);
+          hosts_destroy(&ptr_hosts->base);
+          return -1;
+        }
+      }
+    }
+
+    if(pass == 0)
+    {
+      // keep the table at most half full so probes stay short
+      while(size < num_names * 2) size <<= 1;
+      if( (ptr_hosts->table = (hosts_entry_t *)calloc(size, sizeof(hosts_entry_t))) == NULL )
+      {
+        free((void *)line);
+        fclose(ptr_file);
+        hosts_destroy(&ptr_hosts->base);
+        return -1;
+      }
+      ptr_hosts->mask = size - 1;
+    }
+  }
+
+  free((void *)line);
+  fclose(ptr_file);
+  *ptr_backend = &ptr_hosts->base;
+
+  return 0;
+}
+
+/*
+ * Mock
+ */
+
+/**
+ * @brief Draw a uniform random number in [0, 1) from per-thread state
+ */
+static double mock_random(void)
+{
+  static __thread uint64_t state = 0;
+
+  // seed each thread differently the first time it draws
+  if(state == 0)
+  {
+    state = (uint64_t)now_ns() ^ ((uint64_t)(uintptr_t)&state * 0x9e3779b97f4a7c15ull);
+    if(state == 0) state = 1;
+  }
+
+  // xorshift64*
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+
+  return ((state * 0x2545f4914f6cdd1dull) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int mock_lookup(backend_t * ptr_backend, const char * hostname, addr_set_t * ptr_addrs)
+{
+  mock_backend_t * ptr_mock = (mock_backend_t *)ptr_backend;
+  uint64_t hash = cache_hash(hostname);
+  uint8_t bytes[16];
+  double delay_us;
+
+  // draw the delay, Box-Muller for the normal behind the lognormal
+  switch(ptr_mock->dist)
+  {
+    case MOCK_UNIFORM:
+      delay_us = ptr_mock->a + (ptr_mock->b - ptr_mock->a) * mock_random();
+      break;
+
+    case MOCK_LOGNORMAL:
+      delay_us = ptr_mock->a * exp(ptr_mock->b * sqrt(-2.0 * log(1.0 - mock_random())) * cos(2.0 * M_PI * mock_random()));
+      break;
+
+    default:
+      delay_us = ptr_mock->a;
+      break;
+  }
+  if(delay_us >= 1.0)
+  {
+    backend_sleep_ns((long long)(delay_us * 1000));
+  }
+
+  // the same names always fail, the rest get an address in 10.0.0.0/8 and
+  // one in fd00::/8
+  if( (hash >> 11) * (1.0 / 9007199254740992.0) < ptr_mock->fail_rate )
+  {
+    return UTIL_FAILURE;
+  }
+  ptr_addrs->count = 0;
+  bytes[0] = 10;
+  bytes[1] = hash >> 16;
+  bytes[2] = hash >> 8;
+  bytes[3] = hash;
+  addr_set_add(ptr_addrs, ADDR_V4, bytes);
+  bytes[0] = 0xfd;
+  for(int i = 1; i < 16; i++)
+  {
+    bytes[i] = hash >> (8 * (i % 8));
+  }
+  addr_set_add(ptr_addrs, ADDR_V6, bytes);
+
+  return UTIL_SUCCESS;
+}
+
+static void mock_destroy(backend_t * ptr_backend)
+{
+  free((void *)ptr_backend);
+}
+
+/**
+ * @brief Parse a latency spec and create the mock backend
+ */
+static int mock_init(backend_t ** ptr_backend, const char * latency_spec, double fail_rate)
+{
+  mock_backend_t * ptr_mock;
+  double a = 0, b = 0;
+  char extra;
+  int dist;
+
+  if( sscanf(latency_spec, "fixed:%lf%c", &a, &extra) == 1 && a >= 0 )
+  {
+    dist = MOCK_FIXED;
+  }
+  else if( sscanf(latency_spec, "uniform:%lf:%lf%c", &a, &b, &extra) == 2 && a >= 0 && b >= a )
+  {
+    dist = MOCK_UNIFORM;
+  }
+  else if( sscanf(latency_spec, "lognormal:%lf:%lf%c", &a, &b, &extra) == 2 && a > 0 && b >= 0 )
+  {
+    dist = MOCK_LOGNORMAL;
+  }
+  else
+  {
+    return -1;
+  }
+
+  if(fail_rate < 0 || fail_rate > 1)
+  {
+    return -1;
+  }
+
+  if( (ptr_mock = (mock_backend_t *)malloc(sizeof(mock_backend_t))) == NULL )
+  {
+    return -1;
+  }
+  ptr_mock->base.lookup = mock_lookup;
+  ptr_mock->base.destroy = mock_destroy;
+  ptr_mock->dist = dist;
+  ptr_mock->a = a;
+  ptr_mock->b = b;
+  ptr_mock->fail_rate = fail_rate;
+  *ptr_backend = &ptr_mock->base;
+
+  return 0;
+}
+
+/*
+ * Replay
+ */
+/**
+ * @brief Find the table entry of a name, or the empty slot it would go in
+ */
+static replay_entry_t * replay_find(replay_backend_t * ptr_replay, const char * hostname, uint64_t hash)
+{
+  replay_entry_t * ptr_entry;
+
+  for(size_t i = hash & ptr_replay->mask; (ptr_entry = &ptr_replay->table[i])->name != NULL; i = (i + 1) & ptr_replay->mask)
+  {
+    if(ptr_entry->hash == hash && strcasecmp(ptr_entry->name, hostname) == 0)
+    {
+      break;
+    }
+  }
+
+  return ptr_entry;
+}
+
+static int replay_lookup(backend_t * ptr_backend, const char * hostname, addr_set_t * ptr_addrs)
+{
+  replay_backend_t * ptr_replay = (replay_backend_t *)ptr_backend;
+  replay_entry_t * ptr_entry = replay_find(ptr_replay, hostname, cache_hash(hostname));
+  replay_record_t * ptr_record;
+  size_t use;
+
+  // a name the trace never saw fails at once
+  if(ptr_entry->name == NULL)
+  {
+    return UTIL_FAILURE;
+  }
+
+  // the nth lookup of a name gets its nth recorded result, starting over
+  // once they have all been used
+  use = atomic_fetch_add_explicit(&ptr_entry->uses, 1, memory_order_relaxed) % ptr_entry->num_records;
+  ptr_record = &ptr_replay->records[ptr_entry->first + use];
+  backend_sleep_ns(ptr_record->latency_ns);
+  if(ptr_record->status == UTIL_SUCCESS)
+  {
+    *ptr_addrs = ptr_record->addrs;
+  }
+  return ptr_record->status;
+}
+
+static void replay_destroy(backend_t * ptr_backend)
+{
+  replay_backend_t * ptr_replay = (replay_backend_t *)ptr_backend;
+
+  arena_free(&ptr_replay->names);
+  free((void *)ptr_replay->table);
+  free((void *)ptr_replay->records);
+  free((void *)ptr_replay);
+}
+
+/**
+ * @brief Parse one line of a trace into a record
+ *
+ * @return 0 if successful, -1 if the line is blank or not a record
+ */
+static int replay_parse(char * line, char ** ptr_name, replay_record_t * ptr_record)
+{
+  unsigned char addr[sizeof(struct in6_addr)];
+  char * result;
+  char * str;
+  char * save;
+  int family;
+
+  line[strcspn(line, "#")] = '\0';
+  if( (*ptr_name = strtok_r(line, " \t\r\n", &save)) == NULL ||
+      (str = strtok_r(NULL, " \t\r\n", &save)) == NULL ||
+      sscanf(str, "%lld", &ptr_record->latency_ns) != 1 || ptr_record->latency_ns < 0 ||
+      (result = strtok_r(NULL, " \t\r\n", &save)) == NULL )
+  {
+    return -1;
+  }
+  if( strcmp(result, "ok") == 0 )
+  {
+    ptr_record->status = UTIL_SUCCESS;
+  }
+  else if( strcmp(result, "fail") == 0 )
+  {
+    ptr_record->status = UTIL_FAILURE;
+  }
+  else
+  {
+    return -1;
+  }
+
+  ptr_record->addrs.count = 0;
+  while( (str = strtok_r(NULL, " \t\r\n", &save)) != NULL )
+  {
+    if( backend_parse_addr(str, &family, addr) != 0 )
+    {
+      return -1;
+    }
+    addr_set_add(&ptr_record->addrs, family, addr);
+  }
+
+  // a success needs an address to hand out
+  return ptr_record->status == UTIL_SUCCESS && ptr_record->addrs.count == 0 ? -1 : 0;
+}
+
+/**
+ * @brief Read a trace written by the recorder into a table
+ *
+ * Each line is a hostname, the lookup's latency in nanoseconds, ok or
+ * fail, and the addresses found, and anything after a # is a comment. A
+ * name's records are stored next to each other in file order, so a lookup
+ * indexes straight to the one it replays.
+ */
+static int replay_init(backend_t ** ptr_backend, const char * file_name)
+{
+  replay_backend_t * ptr_replay;
+  replay_entry_t * ptr_entry;
+  replay_record_t record;
+  FILE * ptr_file;
+  char * line = NULL;
+  size_t line_size = 0;
+  size_t num_records = 0;
+  size_t size = 16;
+  size_t offset = 0;
+  uint64_t hash;
+  char * name;
+  int pass;
+
+  if( (ptr_file = fopen(file_name, "r")) == NULL )
+  {
+    return -1;
+  }
+
+  if( (ptr_replay = (replay_backend_t *)malloc(sizeof(replay_backend_t))) == NULL )
+  {
+    fclose(ptr_file);
+    return -1;
+  }
+  ptr_replay->base.lookup = replay_lookup;
+  ptr_replay->base.destroy = replay_destroy;
+  ptr_replay->table = NULL;
+  ptr_replay->records = NULL;
+  arena_init(&ptr_replay->names, HOSTS_NAME_ARENA_SIZE);
+
+  // count the records on the first pass so nothing has to grow, count each
+  // name's records on the second, then copy them into place on the third
+  for(pass = 0; pass < 3; pass++)
+  {
+    rewind(ptr_file);
+    num_records = 0;
+    while( getline(&line, &line_size, ptr_file) != -1 )
+    {
+      if( replay_parse(line, &name, &record) != 0 )
+      {
+        continue;
+      }
+      num_records++;
+      if(pass == 0)
+      {
+        continue;
+      }
+
+      hash = cache_hash(name);
+      ptr_entry = replay_find(ptr_replay, name, hash);
+      if(pass == 2)
+      {
+        // skip lines added to the file since it was counted
+        if(ptr_entry->filled < ptr_entry->num_records)
+        {
+          ptr_replay->records[ptr_entry->first + ptr_entry->filled++] = record;
+        }
+        continue;
+      }
+      if(ptr_entry->name == NULL)
+      {
+        if( (ptr_entry->name = arena_strndup(&ptr_replay->names, name, strlen(name))) == NULL )
+        {
+          free((void *)line);
+          fclose(ptr_file);
+          replay_destroy(&ptr_replay->base);
+          return -1;
+        }
+        ptr_entry->hash = hash;
+        atomic_init(&ptr_entry->uses, 0);
+      }
+      ptr_entry->num_records++;
+    }
+
+    if(pass == 0)
+    {
+      // keep the table at most half full so probes stay short
+      while(size < num_records * 2) size <<= 1;
+      if( (ptr_replay->table = (replay_entry_t *)calloc(size, sizeof(replay_entry_t))) == NULL ||
+          (ptr_replay->records = (replay_record_t *)malloc(sizeof(replay_record_t) * (num_records + 1))) == NULL )
+      {
+        free((void *)line);
+        fclose(ptr_file);
+        replay_destroy(&ptr_replay->base);
+        return -1;
+      }
+      ptr_replay->mask = size - 1;
+    }
+    else if(pass == 1)
+    {
+      // give each name a run of records of its own
+      for(size_t i = 0; i < size; i++)
+      {
+        ptr_replay->table[i].first = offset;
+        offset += ptr_replay->table[i].num_records;
+      }
+    }
+  }
+
+  free((void *)line);
+  fclose(ptr_file);
+  *ptr_backend = &ptr_replay->base;
+
+  return 0;
+}
+
+/*
+ * Recorder
+ */
+static int record_lookup(backend_t * ptr_backend, const char * hostname, addr_set_t * ptr_addrs)
+{
+  record_backend_t * ptr_record = (record_backend_t *)ptr_backend;
+  char ip_strs[ADDR_SET_MAX][INET6_ADDRSTRLEN];
+  long long start_ns;
+  int status;
+
+  start_ns = now_ns();
+  status = backend_lookup(ptr_record->ptr_inner, hostname, ptr_addrs);
+  start_ns = now_ns() - start_ns;
+
+  // format outside the lock, so it is only held for the write
+  for(int i = 0; status == UTIL_SUCCESS && i < ptr_addrs->count; i++)
+  {
+    addr_format(&ptr_addrs->addrs[i], ip_strs[i]);
+  }
+  lockprof_lock(&ptr_record->mutex);
+  fprintf(ptr_record->ptr_file, "%s %lld %s", hostname, start_ns, status == UTIL_SUCCESS ? "ok" : "fail");
+  for(int i = 0; status == UTIL_SUCCESS && i < ptr_addrs->count; i++)
+  {
+    fprintf(ptr_record->ptr_file, " %s", ip_strs[i]);
+  }
+  fputc('\n', ptr_record->ptr_file);
+  lockprof_unlock(&ptr_record->mutex);
+
+  return status;
+}
+
+static void record_destroy(backend_t * ptr_backend)
+{
+  record_backend_t * ptr_record = (record_backend_t *)ptr_backend;
+
+  backend_free(ptr_record->ptr_inner);
+  fclose(ptr_record->ptr_file);
+  lockprof_mutex_destroy(&ptr_record->mutex);
+  free((void *)ptr_record);
+}
+
+int backend_record(backend_t ** ptr_backend, const char * file_name)
+{
+  record_backend_t * ptr_record;
+
+  if( (ptr_record = (record_backend_t *)malloc(sizeof(record_backend_t))) == NULL )
+  {
+    return -1;
+  }
+  if( (ptr_record->ptr_file = fopen(file_name, "w")) == NULL )
+  {
+    free((void *)ptr_record);
+    return -1;
+  }
+  fprintf(ptr_record->ptr_file, "# hostname latency_ns ok|fail [address ...]\n");
+  ptr_record->base.lookup = record_lookup;
+  ptr_record->base.destroy = record_destroy;
+  ptr_record->ptr_inner = *ptr_backend;
+  lockprof_mutex_init(&ptr_record->mutex, "trace");
+  *ptr_backend = &ptr_record->base;
+
+  return 0;
+}
+
+int backend_init(backend_t ** ptr_backend, const char * spec, const char * latency_spec, double fail_rate, int ipv6_f)
+{
+  getaddrinfo_backend_t * ptr_getaddrinfo;
+
+  if( strcmp(spec, "getaddrinfo") == 0 )
+  {
+    if( (ptr_getaddrinfo = (getaddrinfo_backend_t *)malloc(sizeof(getaddrinfo_backend_t))) == NULL )
+    {
+      return -1;
+    }
+    ptr_getaddrinfo->base.lookup = getaddrinfo_lookup;
+    ptr_getaddrinfo->base.destroy = getaddrinfo_destroy;
+    ptr_getaddrinfo->ipv6_f = ipv6_f;
+    *ptr_backend = &ptr_getaddrinfo->base;
+    return 0;
+  }
+  if( strncmp(spec, "hosts:", 6) == 0 )
+  {
+    return hosts_init(ptr_backend, spec + 6);
+  }
+  if( strcmp(spec, "mock") == 0 )
+  {
+    return mock_init(ptr_backend, latency_spec, fail_rate);
+  }
+  if( strncmp(spec, "replay:", 7) == 0 )
+  {
+    return replay_init(ptr_backend, spec + 7);
+  }
+
+  return -1;
+}
+
+void backend_free(backend_t * ptr_backend)
+{
+  ptr_backend->destroy(ptr_backend);
+}
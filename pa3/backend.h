@@ -0,0 +1,114 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file backend.h
+ * @brief Interchangeable ways of resolving a hostname
+ *
+ * Definitions and declarations for the interface blocking resolver
+ * threads look hostnames up through. A backend is a structure whose
+ * first member holds its functions, so each implementation can keep its
+ * own state after it. There are four: getaddrinfo, a fixed table read
+ * from a hosts-format file, a mock that makes up addresses after a
+ * configurable delay so the program can be measured without a network,
+ * and a replay of a trace written by the recorder, which wraps any of
+ * them and writes down the result and latency of every lookup.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __BACKEND_H__
+#define __BACKEND_H__
+
+#include "addr.h"
+
+#define BACKEND_DEFAULT ("getaddrinfo")
+#define BACKEND_DEFAULT_LATENCY ("fixed:0")
+
+typedef struct backend backend_t;
+
+/**
+ * @brief Resolve a hostname, blocking until done
+ *
+ * @param ptr_backend A pointer to the backend
+ * @param hostname The hostname
+ * @param ptr_addrs Where every address found is stored
+ *
+ * @return UTIL_SUCCESS if an address was found, UTIL_FAILURE otherwise
+ */
+typedef int (* backend_lookup_t)(backend_t * ptr_backend, const char * hostname, addr_set_t * ptr_addrs);
+
+struct backend
+{
+  backend_lookup_t lookup;
+  void (* destroy)(backend_t * ptr_backend);
+};
+
+/**
+ * @brief Create a backend
+ *
+ * The spec is "getaddrinfo", "hosts:FILE", "mock" or "replay:FILE".
+ * The replay backend waits as long as the recorded lookup of a name took
+ * and returns its recorded result, using a name's records in turn if it
+ * was looked up more than once, and fails names missing from the trace
+ * without waiting. The mock backend
+ * waits for a delay drawn from the latency spec, which is "fixed:US",
+ * "uniform:MIN_US:MAX_US" or "lognormal:MEDIAN_US:SIGMA", then fails
+ * with the given probability or returns an IPv4 and an IPv6 address made
+ * from the name.
+ * Whether a name fails is decided by its hash, so repeated lookups of a
+ * name agree.
+ *
+ * @param ptr_backend A pointer to the uninitialized backend pointer
+ * @param spec Which backend to create
+ * @param latency_spec The delay of the mock backend, ignored by the others
+ * @param fail_rate The fraction of names the mock backend fails, from 0 to 1
+ * @param ipv6_f 1 for getaddrinfo to return IPv6 addresses after the IPv4
+ *               ones, 0 for IPv4 only
+ *
+ * @return 0 if successful, -1 if the spec is invalid or the backend could
+ *         not be created
+ */
+int backend_init(backend_t ** ptr_backend, const char * spec, const char * latency_spec, double fail_rate, int ipv6_f);
+
+/**
+ * @brief Record every lookup made through a backend to a trace file
+ *
+ * Replaces the backend with one that passes each lookup on to it and then
+ * writes a line with the hostname, the latency in nanoseconds, ok or
+ * fail, and the addresses found. Freeing the recorder frees the backend
+ * it wraps and closes the file.
+ *
+ * @param ptr_backend A pointer to the backend pointer to wrap
+ * @param file_name The trace file, which is replaced
+ *
+ * @return 0 if successful, -1 otherwise, leaving the backend unwrapped
+ */
+int backend_record(backend_t ** ptr_backend, const char * file_name);
+
+/**
+ * @brief Free a backend from the heap
+ *
+ * @param ptr_backend A pointer to the backend
+ */
+void backend_free(backend_t * ptr_backend);
+
+/**
+ * @brief Resolve a hostname through a backend
+ */
+static inline int backend_lookup(backend_t * ptr_backend, const char * hostname, addr_set_t * ptr_addrs)
+{
+  return ptr_backend->lookup(ptr_backend, hostname, ptr_addrs);
+}
+
+#endif /* __BACKEND_H__ */
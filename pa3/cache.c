@@ -0,0 +1,530 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file cache.c
+ * @brief Concurrent in-memory cache of resolved hostnames
+ *
+ * Implementations for the sharded hash cache. The low bits of a hostname
+ * hash pick its shard and the high bits pick its bucket, so the two
+ * choices stay independent. Each shard's table doubles whenever it holds
+ * more entries than buckets. Resolved and negative entries share the
+ * table but sit on separate LRU lists, and each list is only ever trimmed
+ * to make room for an entry of its own kind. Lookups in flight are
+ * reference counted by their owner and waiters, since a polling waiter
+ * may only look at the result after the owner has moved on.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include "cache.h"
+#include "timing.h"
+
+#define FNV_OFFSET_BASIS (0xcbf29ce484222325ULL)
+#define FNV_PRIME (0x100000001b3ULL)
+
+int cache_init(cache_t ** ptr_cache, size_t max_bytes, int num_shards, size_t max_negative_bytes, int negative_ttl_s)
+{
+  int size = 1;
+  cache_shard_t * ptr_shard;
+
+  while(size < num_shards) size <<= 1;
+
+  if( (*ptr_cache = (cache_t *)malloc(sizeof(cache_t))) == NULL )
+  {
+    return -1;
+  }
+  if( posix_memalign((void **)&(*ptr_cache)->shards, CACHE_LINE_SIZE, sizeof(cache_shard_t) * size) != 0 )
+  {
+    free((void *)*ptr_cache);
+    return -1;
+  }
+  (*ptr_cache)->num_shards = size;
+  (*ptr_cache)->negative_ttl_s = negative_ttl_s;
+
+  for(int i = 0; i < size; i++)
+  {
+    ptr_shard = &(*ptr_cache)->shards[i];
+    memset(ptr_shard, 0, sizeof(cache_shard_t));
+    if( (ptr_shard->buckets = (cache_entry_t **)calloc(CACHE_INITIAL_BUCKETS, sizeof(cache_entry_t *))) == NULL )
+    {
+      (*ptr_cache)->num_shards = i;
+      cache_free(*ptr_cache);
+      return -1;
+    }
+    ptr_shard->num_buckets = CACHE_INITIAL_BUCKETS;
+    ptr_shard->lru.max_bytes = max_bytes / size;
+    ptr_shard->negative_lru.max_bytes = max_negative_bytes / size;
+    lockprof_mutex_init(&ptr_shard->mutex, "cache shard");
+  }
+
+  return 0;
+}
+
+void cache_free(cache_t * ptr_cache)
+{
+  cache_shard_t * ptr_shard;
+  cache_entry_t * ptr_entry;
+  cache_entry_t * ptr_next;
+  cache_flight_t * ptr_flight;
+  cache_flight_t * ptr_next_flight;
+
+  for(int i = 0; i < ptr_cache->num_shards; i++)
+  {
+    ptr_shard = &ptr_cache->shards[i];
+    for(ptr_entry = ptr_shard->lru.ptr_newest; ptr_entry != NULL; ptr_entry = ptr_next)
+    {
+      ptr_next = ptr_entry->lru_next;
+      free((void *)ptr_entry);
+    }
+    for(ptr_entry = ptr_shard->negative_lru.ptr_newest; ptr_entry != NULL; ptr_entry = ptr_next)
+    {
+      ptr_next = ptr_entry->lru_next;
+      free((void *)ptr_entry);
+    }
+    for(ptr_flight = ptr_shard->flights; ptr_flight != NULL; ptr_flight = ptr_next_flight)
+    {
+      ptr_next_flight = ptr_flight->next;
+      pthread_cond_destroy(&ptr_flight->cond);
+      free((void *)ptr_flight);
+    }
+    free((void *)ptr_shard->buckets);
+    lockprof_mutex_destroy(&ptr_shard->mutex);
+  }
+  free((void *)ptr_cache->shards);
+  free((void *)ptr_cache);
+}
+
+uint64_t cache_hash(const char * hostname)
+{
+  uint64_t hash = FNV_OFFSET_BASIS;
+
+  for(const unsigned char * c = (const unsigned char *)hostname; *c != '\0'; c++)
+  {
+    hash ^= tolower(*c);
+    hash *= FNV_PRIME;
+  }
+
+  return hash;
+}
+
+/**
+ * @brief Pick the shard for a hash
+ */
+static cache_shard_t * cache_shard(cache_t * ptr_cache, uint64_t hash)
+{
+  return &ptr_cache->shards[hash & (ptr_cache->num_shards - 1)];
+}
+
+/**
+ * @brief Pick the bucket for a hash within a shard
+ */
+static cache_entry_t ** cache_bucket(cache_shard_t * ptr_shard, uint64_t hash)
+{
+  return &ptr_shard->buckets[(hash >> 32) & (ptr_shard->num_buckets - 1)];
+}
+
+/**
+ * @brief Find the link pointing at a hostname's entry, shard must be locked
+ */
+static cache_entry_t ** cache_find(cache_shard_t * ptr_shard, uint64_t hash, const char * hostname)
+{
+  cache_entry_t ** ptr_link;
+
+  for(ptr_link = cache_bucket(ptr_shard, hash); *ptr_link != NULL; ptr_link = &(*ptr_link)->hash_next)
+  {
+    if((*ptr_link)->hash == hash && strcasecmp((*ptr_link)->name, hostname) == 0)
+    {
+      break;
+    }
+  }
+
+  return ptr_link;
+}
+
+/**
+ * @brief Pick the LRU list an entry belongs to
+ */
+static cache_lru_t * cache_entry_lru(cache_shard_t * ptr_shard, cache_entry_t * ptr_entry)
+{
+  return ptr_entry->negative_f ? &ptr_shard->negative_lru : &ptr_shard->lru;
+}
+
+/**
+ * @brief Unlink an entry from its LRU list, shard must be locked
+ */
+static void cache_lru_remove(cache_lru_t * ptr_lru, cache_entry_t * ptr_entry)
+{
+  if(ptr_entry->lru_prev != NULL) ptr_entry->lru_prev->lru_next = ptr_entry->lru_next;
+  else ptr_lru->ptr_newest = ptr_entry->lru_next;
+  if(ptr_entry->lru_next != NULL) ptr_entry->lru_next->lru_prev = ptr_entry->lru_prev;
+  else ptr_lru->ptr_oldest = ptr_entry->lru_prev;
+}
+
+/**
+ * @brief Link an entry at the newest end of an LRU list, shard must be locked
+ */
+static void cache_lru_push(cache_lru_t * ptr_lru, cache_entry_t * ptr_entry)
+{
+  ptr_entry->lru_prev = NULL;
+  ptr_entry->lru_next = ptr_lru->ptr_newest;
+  if(ptr_lru->ptr_newest != NULL) ptr_lru->ptr_newest->lru_prev = ptr_entry;
+  else ptr_lru->ptr_oldest = ptr_entry;
+  ptr_lru->ptr_newest = ptr_entry;
+}
+
+/**
+ * @brief Remove and free the entry a link points at, shard must be locked
+ */
+static void cache_remove(cache_shard_t * ptr_shard, cache_entry_t ** ptr_link)
+{
+  cache_entry_t * ptr_entry = *ptr_link;
+  cache_lru_t * ptr_lru = cache_entry_lru(ptr_shard, ptr_entry);
+
+  *ptr_link = ptr_entry->hash_next;
+  cache_lru_remove(ptr_lru, ptr_entry);
+  ptr_lru->num_entries--;
+  ptr_lru->bytes -= ptr_entry->size;
+  free((void *)ptr_entry);
+}
+
+/**
+ * @brief Double the number of buckets in a shard, shard must be locked
+ *
+ * Leaves the table as it is if the larger one cannot be allocated.
+ */
+static void cache_grow(cache_shard_t * ptr_shard)
+{
+  cache_entry_t ** old_buckets = ptr_shard->buckets;
+  size_t old_num_buckets = ptr_shard->num_buckets;
+  cache_entry_t * ptr_entry;
+  cache_entry_t ** ptr_bucket;
+
+  if( (ptr_shard->buckets = (cache_entry_t **)calloc(old_num_buckets * 2, sizeof(cache_entry_t *))) == NULL )
+  {
+    ptr_shard->buckets = old_buckets;
+    return;
+  }
+  ptr_shard->num_buckets = old_num_buckets * 2;
+
+  for(size_t i = 0; i < old_num_buckets; i++)
+  {
+    while( (ptr_entry = old_buckets[i]) != NULL )
+    {
+      old_buckets[i] = ptr_entry->hash_next;
+      ptr_bucket = cache_bucket(ptr_shard, ptr_entry->hash);
+      ptr_entry->hash_next = *ptr_bucket;
+      *ptr_bucket = ptr_entry;
+    }
+  }
+  free((void *)old_buckets);
+}
+
+/**
+ * @brief Store an entry, replacing any older one for the hostname, shard
+ *        must not be locked
+ *
+ * With ptr_addrs NULL the entry is negative and goes on the shard's
+ * negative LRU list, which is trimmed to make room for it instead of the
+ * list of resolved names.
+ */
+static void cache_insert(cache_t * ptr_cache, const char * hostname, const addr_set_t * ptr_addrs, int ttl_s)
+{
+  uint64_t hash = cache_hash(hostname);
+  cache_shard_t * ptr_shard = cache_shard(ptr_cache, hash);
+  cache_lru_t * ptr_lru = ptr_addrs != NULL ? &ptr_shard->lru : &ptr_shard->negative_lru;
+  size_t name_size = strlen(hostname) + 1;
+  size_t size = sizeof(cache_entry_t) + name_size;
+  cache_entry_t ** ptr_link;
+  cache_entry_t ** ptr_bucket;
+  cache_entry_t * ptr_entry;
+
+  // an entry larger than the whole shard would only evict everything else
+  if(ttl_s <= 0 || size > ptr_lru->max_bytes)
+  {
+    return;
+  }
+
+  // build the entry before taking the lock
+  if( (ptr_entry = (cache_entry_t *)malloc(size)) == NULL )
+  {
+    return;
+  }
+  ptr_entry->hash = hash;
+  ptr_entry->size = size;
+  ptr_entry->expires_ms = now_ms() + (long long)ttl_s * 1000;
+  ptr_entry->ttl_s = ttl_s;
+  ptr_entry->negative_f = ptr_addrs == NULL;
+  if(ptr_addrs != NULL)
+  {
+    ptr_entry->addrs = *ptr_addrs;
+  }
+  else
+  {
+    ptr_entry->addrs.count = 0;
+  }
+  memcpy(ptr_entry->name, hostname, name_size);
+
+  lockprof_lock(&ptr_shard->mutex);
+
+  // replace any older entry for the name
+  ptr_link = cache_find(ptr_shard, hash, hostname);
+  if(*ptr_link != NULL)
+  {
+    cache_remove(ptr_shard, ptr_link);
+  }
+
+  // make room by dropping the least recently used entries
+  while(ptr_lru->bytes + size > ptr_lru->max_bytes && ptr_lru->ptr_oldest != NULL)
+  {
+    ptr_link = cache_find(ptr_shard, ptr_lru->ptr_oldest->hash, ptr_lru->ptr_oldest->name);
+    cache_remove(ptr_shard, ptr_link);
+    if(ptr_addrs != NULL) ptr_shard->evictions++;
+    else ptr_shard->negative_evictions++;
+  }
+
+  if(ptr_shard->lru.num_entries + ptr_shard->negative_lru.num_entries >= ptr_shard->num_buckets)
+  {
+    cache_grow(ptr_shard);
+  }
+
+  ptr_bucket = cache_bucket(ptr_shard, hash);
+  ptr_entry->hash_next = *ptr_bucket;
+  *ptr_bucket = ptr_entry;
+  cache_lru_push(ptr_lru, ptr_entry);
+  ptr_lru->num_entries++;
+  ptr_lru->bytes += size;
+
+  lockprof_unlock(&ptr_shard->mutex);
+}
+
+/**
+ * @brief Drop one reference to a flight, freeing it with the last one
+ */
+static void cache_flight_release(cache_flight_t * ptr_flight)
+{
+  if( atomic_fetch_sub(&ptr_flight->refs, 1) == 1 )
+  {
+    pthread_cond_destroy(&ptr_flight->cond);
+    free((void *)ptr_flight);
+  }
+}
+
+/**
+ * @brief Copy the result of a finished flight
+ */
+static int cache_flight_result(cache_flight_t * ptr_flight, addr_set_t * ptr_addrs)
+{
+  if(ptr_flight->status != 0)
+  {
+    return CACHE_FAILED;
+  }
+  *ptr_addrs = ptr_flight->addrs;
+
+  return CACHE_HIT;
+}
+
+int cache_claim(cache_t * ptr_cache, const char * hostname, addr_set_t * ptr_addrs, cache_flight_t ** ptr_flight)
+{
+  uint64_t hash = cache_hash(hostname);
+  cache_shard_t * ptr_shard = cache_shard(ptr_cache, hash);
+  size_t name_size = strlen(hostname) + 1;
+  cache_entry_t ** ptr_link;
+  cache_entry_t * ptr_entry;
+  cache_flight_t * ptr_new_flight;
+  cache_flight_t * ptr_curr_flight;
+  int ret;
+
+  lockprof_lock(&ptr_shard->mutex);
+
+  ptr_link = cache_find(ptr_shard, hash, hostname);
+  if( (ptr_entry = *ptr_link) != NULL )
+  {
+    if(ptr_entry->expires_ms > now_ms())
+    {
+      // move to the newest end so it is evicted last
+      cache_lru_remove(cache_entry_lru(ptr_shard, ptr_entry), ptr_entry);
+      cache_lru_push(cache_entry_lru(ptr_shard, ptr_entry), ptr_entry);
+      if(ptr_entry->negative_f)
+      {
+        // a name that failed recently fails again without a lookup
+        ptr_shard->negative_hits++;
+        lockprof_unlock(&ptr_shard->mutex);
+        return CACHE_FAILED;
+      }
+      *ptr_addrs = ptr_entry->addrs;
+      ptr_shard->hits++;
+      lockprof_unlock(&ptr_shard->mutex);
+      return CACHE_HIT;
+    }
+    cache_remove(ptr_shard, ptr_link);
+    ptr_shard->expirations++;
+  }
+  ptr_shard->misses++;
+
+  // share a lookup that is already in flight
+  for(ptr_curr_flight = ptr_shard->flights; ptr_curr_flight != NULL; ptr_curr_flight = ptr_curr_flight->next)
+  {
+    if(ptr_curr_flight->hash == hash && strcasecmp(ptr_curr_flight->name, hostname) == 0)
+    {
+      break;
+    }
+  }
+  if(ptr_curr_flight != NULL)
+  {
+    ptr_shard->coalesced++;
+    atomic_fetch_add(&ptr_curr_flight->refs, 1);
+    if(ptr_flight != NULL)
+    {
+      lockprof_unlock(&ptr_shard->mutex);
+      *ptr_flight = ptr_curr_flight;
+      return CACHE_PENDING;
+    }
+    while( !atomic_load(&ptr_curr_flight->done_f) )
+    {
+      lockprof_cond_wait(&ptr_curr_flight->cond, &ptr_shard->mutex);
+    }
+    lockprof_unlock(&ptr_shard->mutex);
+    ret = cache_flight_result(ptr_curr_flight, ptr_addrs);
+    cache_flight_release(ptr_curr_flight);
+    return ret;
+  }
+
+  // first to ask, claim the name; without memory it is simply not shared
+  if( (ptr_new_flight = (cache_flight_t *)malloc(sizeof(cache_flight_t) + name_size)) != NULL )
+  {
+    ptr_new_flight->hash = hash;
+    atomic_init(&ptr_new_flight->refs, 1);
+    atomic_init(&ptr_new_flight->done_f, 0);
+    pthread_cond_init(&ptr_new_flight->cond, NULL);
+    memcpy(ptr_new_flight->name, hostname, name_size);
+    ptr_new_flight->next = ptr_shard->flights;
+    ptr_shard->flights = ptr_new_flight;
+  }
+
+  lockprof_unlock(&ptr_shard->mutex);
+
+  return CACHE_CLAIMED;
+}
+
+void cache_complete(cache_t * ptr_cache, const char * hostname, int status, const addr_set_t * ptr_addrs, int ttl_s)
+{
+  uint64_t hash = cache_hash(hostname);
+  cache_shard_t * ptr_shard = cache_shard(ptr_cache, hash);
+  cache_flight_t ** ptr_link;
+  cache_flight_t * ptr_flight;
+
+  if(status == 0)
+  {
+    cache_put(ptr_cache, hostname, ptr_addrs, ttl_s);
+  }
+  else
+  {
+    cache_insert(ptr_cache, hostname, NULL, ptr_cache->negative_ttl_s);
+  }
+
+  lockprof_lock(&ptr_shard->mutex);
+  for(ptr_link = &ptr_shard->flights; *ptr_link != NULL; ptr_link = &(*ptr_link)->next)
+  {
+    if((*ptr_link)->hash == hash && strcasecmp((*ptr_link)->name, hostname) == 0)
+    {
+      break;
+    }
+  }
+  if( (ptr_flight = *ptr_link) == NULL )
+  {
+    lockprof_unlock(&ptr_shard->mutex);
+    return;
+  }
+
+  // later callers find the cache entry, current waiters get the result
+  *ptr_link = ptr_flight->next;
+  ptr_flight->status = status;
+  if(status == 0)
+  {
+    ptr_flight->addrs = *ptr_addrs;
+  }
+  atomic_store(&ptr_flight->done_f, 1);
+  pthread_cond_broadcast(&ptr_flight->cond);
+  lockprof_unlock(&ptr_shard->mutex);
+
+  cache_flight_release(ptr_flight);
+}
+
+int cache_flight_poll(cache_flight_t * ptr_flight, addr_set_t * ptr_addrs)
+{
+  int ret;
+
+  if( !atomic_load(&ptr_flight->done_f) )
+  {
+    return CACHE_PENDING;
+  }
+  ret = cache_flight_result(ptr_flight, ptr_addrs);
+  cache_flight_release(ptr_flight);
+
+  return ret;
+}
+
+void cache_put(cache_t * ptr_cache, const char * hostname, const addr_set_t * ptr_addrs, int ttl_s)
+{
+  cache_insert(ptr_cache, hostname, ptr_addrs, ttl_s);
+}
+
+void cache_foreach(cache_t * ptr_cache, cache_visit_t visit, void * ptr_user)
+{
+  cache_shard_t * ptr_shard;
+  long long now = now_ms();
+
+  for(int i = 0; i < ptr_cache->num_shards; i++)
+  {
+    ptr_shard = &ptr_cache->shards[i];
+    lockprof_lock(&ptr_shard->mutex);
+    for(cache_entry_t * ptr_entry = ptr_shard->lru.ptr_newest; ptr_entry != NULL; ptr_entry = ptr_entry->lru_next)
+    {
+      if(ptr_entry->expires_ms > now)
+      {
+        visit(ptr_user, ptr_entry->name, &ptr_entry->addrs,
+              ptr_entry->expires_ms - (long long)ptr_entry->ttl_s * 1000, ptr_entry->ttl_s);
+      }
+    }
+    lockprof_unlock(&ptr_shard->mutex);
+  }
+}
+
+void cache_stats(cache_t * ptr_cache, cache_stats_t * ptr_stats)
+{
+  cache_shard_t * ptr_shard;
+
+  memset(ptr_stats, 0, sizeof(cache_stats_t));
+  for(int i = 0; i < ptr_cache->num_shards; i++)
+  {
+    ptr_shard = &ptr_cache->shards[i];
+    lockprof_lock(&ptr_shard->mutex);
+    ptr_stats->hits += ptr_shard->hits;
+    ptr_stats->negative_hits += ptr_shard->negative_hits;
+    ptr_stats->misses += ptr_shard->misses;
+    ptr_stats->evictions += ptr_shard->evictions;
+    ptr_stats->negative_evictions += ptr_shard->negative_evictions;
+    ptr_stats->expirations += ptr_shard->expirations;
+    ptr_stats->coalesced += ptr_shard->coalesced;
+    ptr_stats->entries += ptr_shard->lru.num_entries;
+    ptr_stats->bytes += ptr_shard->lru.bytes;
+    ptr_stats->negative_entries += ptr_shard->negative_lru.num_entries;
+    ptr_stats->negative_bytes += ptr_shard->negative_lru.bytes;
+    lockprof_unlock(&ptr_shard->mutex);
+  }
+}
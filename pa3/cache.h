@@ -0,0 +1,254 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file cache.h
+ * @brief Concurrent in-memory cache of resolved hostnames
+ *
+ * Definitions and declarations for a hash cache split into shards by
+ * hostname hash, each with its own lock, hash table and LRU lists. Entries
+ * expire after their TTL, and the least recently used entries of a shard
+ * are evicted once it holds more than its share of the memory bound.
+ * Failed lookups are cached as negative entries in the same table, but
+ * with their own shorter TTL, LRU list and memory bound, so a flood of
+ * dead names never evicts the addresses of live ones.
+ * Each shard also tracks the lookups in flight for its names, so that
+ * threads asking for a name that is already being looked up wait for
+ * that result instead of starting their own lookup.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "lockprof.h"
+#include "queue.h"
+#include "addr.h"
+
+#define CACHE_DEFAULT_SIZE (16 * 1024 * 1024)
+#define CACHE_DEFAULT_SHARDS (16)
+#define CACHE_DEFAULT_TTL (300)
+#define CACHE_DEFAULT_NEGATIVE_SIZE (1024 * 1024)
+#define CACHE_DEFAULT_NEGATIVE_TTL (30)
+#define CACHE_INITIAL_BUCKETS (64)
+
+#define CACHE_HIT (0)
+#define CACHE_FAILED (1)
+#define CACHE_CLAIMED (2)
+#define CACHE_PENDING (3)
+
+typedef struct cache_entry
+{
+  struct cache_entry * hash_next;
+  struct cache_entry * lru_prev;
+  struct cache_entry * lru_next;
+  uint64_t hash;
+  long long expires_ms;
+  int ttl_s;
+  int negative_f;
+  size_t size;
+  addr_set_t addrs;
+  char name[];
+} cache_entry_t;
+
+typedef struct
+{
+  cache_entry_t * ptr_newest;
+  cache_entry_t * ptr_oldest;
+  size_t num_entries;
+  size_t bytes;
+  size_t max_bytes;
+} cache_lru_t;
+
+typedef struct cache_flight
+{
+  struct cache_flight * next;
+  uint64_t hash;
+  atomic_int refs;
+  atomic_int done_f;
+  int status;
+  addr_set_t addrs;
+  pthread_cond_t cond;
+  char name[];
+} cache_flight_t;
+
+typedef struct
+{
+  _Alignas(CACHE_LINE_SIZE) lockprof_mutex_t mutex;
+  cache_flight_t * flights;
+  cache_entry_t ** buckets;
+  size_t num_buckets;
+  cache_lru_t lru;
+  cache_lru_t negative_lru;
+  unsigned long hits;
+  unsigned long negative_hits;
+  unsigned long misses;
+  unsigned long evictions;
+  unsigned long negative_evictions;
+  unsigned long expirations;
+  unsigned long coalesced;
+} cache_shard_t;
+
+typedef struct
+{
+  cache_shard_t * shards;
+  int num_shards;
+  int negative_ttl_s;
+} cache_t;
+
+typedef struct
+{
+  unsigned long hits;
+  unsigned long negative_hits;
+  unsigned long misses;
+  unsigned long evictions;
+  unsigned long negative_evictions;
+  unsigned long expirations;
+  unsigned long coalesced;
+  size_t entries;
+  size_t bytes;
+  size_t negative_entries;
+  size_t negative_bytes;
+} cache_stats_t;
+
+/**
+ * @brief Called once for each live entry by cache_foreach()
+ *
+ * @param ptr_user The pointer given to cache_foreach()
+ * @param hostname The hostname
+ * @param ptr_addrs The addresses it resolved to
+ * @param resolved_ms When it was stored, on the monotonic clock
+ * @param ttl_s How long it was valid for from then in seconds
+ */
+typedef void (* cache_visit_t)(void * ptr_user, const char * hostname, const addr_set_t * ptr_addrs,
+                               long long resolved_ms, int ttl_s);
+
+/**
+ * @brief Create a cache
+ *
+ * @param ptr_cache A pointer to the uninitialized cache pointer
+ * @param max_bytes The most memory the entries may use, split evenly
+ *                  between the shards, 0 to only coalesce lookups
+ * @param num_shards The number of shards, rounded up to a power of two
+ * @param max_negative_bytes The most memory failed lookups may use on top
+ *                           of max_bytes, 0 to never cache failures
+ * @param negative_ttl_s How long a failed lookup is cached in seconds
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int cache_init(cache_t ** ptr_cache, size_t max_bytes, int num_shards, size_t max_negative_bytes, int negative_ttl_s);
+
+/**
+ * @brief Free a cache and all its entries from the heap
+ *
+ * @param ptr_cache A pointer to the cache
+ */
+void cache_free(cache_t * ptr_cache);
+
+/**
+ * @brief Hash a hostname, ignoring case
+ *
+ * @param hostname The hostname
+ *
+ * @return The 64-bit FNV-1a hash of the lower-cased hostname
+ */
+uint64_t cache_hash(const char * hostname);
+
+/**
+ * @brief Look up a hostname, or claim the right to resolve it
+ *
+ * On a miss the first caller claims the name and must resolve it and
+ * pass the result to cache_complete(). Later callers for the same name
+ * share that result. With ptr_flight NULL they sleep until it is ready,
+ * otherwise they get a handle to poll with cache_flight_poll().
+ *
+ * @param ptr_cache A pointer to the cache
+ * @param hostname The hostname
+ * @param ptr_addrs Where the addresses are copied on CACHE_HIT
+ * @param ptr_flight NULL to wait, or where a handle to the lookup in
+ *                   flight is stored on CACHE_PENDING
+ *
+ * @return CACHE_HIT if addresses were found, CACHE_FAILED if the name
+ *         recently failed or the shared lookup failed, CACHE_CLAIMED if
+ *         the caller must resolve the name, or CACHE_PENDING if another
+ *         thread is resolving it
+ */
+int cache_claim(cache_t * ptr_cache, const char * hostname, addr_set_t * ptr_addrs, cache_flight_t ** ptr_flight);
+
+/**
+ * @brief Publish the result of a claimed lookup
+ *
+ * Caches the result, a failure as a negative entry with the cache's
+ * negative TTL, and hands it to every thread waiting on the name.
+ *
+ * @param ptr_cache A pointer to the cache
+ * @param hostname The hostname claimed with cache_claim()
+ * @param status 0 if the lookup found addresses, -1 otherwise
+ * @param ptr_addrs The addresses it resolved to, unused on failure
+ * @param ttl_s How long the addresses stay valid in seconds, unused on failure
+ */
+void cache_complete(cache_t * ptr_cache, const char * hostname, int status, const addr_set_t * ptr_addrs, int ttl_s);
+
+/**
+ * @brief Check whether a shared lookup has finished
+ *
+ * Once it returns a result the handle has been released and must not be
+ * used again.
+ *
+ * @param ptr_flight The handle from cache_claim()
+ * @param ptr_addrs Where the addresses are copied on CACHE_HIT
+ *
+ * @return CACHE_HIT or CACHE_FAILED once finished, CACHE_PENDING before
+ */
+int cache_flight_poll(cache_flight_t * ptr_flight, addr_set_t * ptr_addrs);
+
+/**
+ * @brief Store a resolved hostname
+ *
+ * Replaces any entry already held for the hostname, then evicts the
+ * least recently used entries while the shard is over its memory bound.
+ *
+ * @param ptr_cache A pointer to the cache
+ * @param hostname The hostname
+ * @param ptr_addrs The addresses it resolved to
+ * @param ttl_s How long the entry stays valid in seconds
+ */
+void cache_put(cache_t * ptr_cache, const char * hostname, const addr_set_t * ptr_addrs, int ttl_s);
+
+/**
+ * @brief Visit every resolved entry that has not expired
+ *
+ * Negative entries are left out.
+ *
+ * Each shard is locked while it is visited, so the callback must not
+ * use the cache.
+ *
+ * @param ptr_cache A pointer to the cache
+ * @param visit The function called for each entry
+ * @param ptr_user A pointer handed to every call
+ */
+void cache_foreach(cache_t * ptr_cache, cache_visit_t visit, void * ptr_user);
+
+/**
+ * @brief Sum the counters of every shard
+ *
+ * @param ptr_cache A pointer to the cache
+ * @param ptr_stats A pointer to where the totals are stored
+ */
+void cache_stats(cache_t * ptr_cache, cache_stats_t * ptr_stats);
+
+#endif /* __CACHE_H__ */
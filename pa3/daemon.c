@@ -0,0 +1,372 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file daemon.c
+ * @brief Long-running input sources that stream results back
+ *
+ * Implementations for the daemon. A client is reference counted by the
+ * thread reading it and by each of its requests still being looked up.
+ * Stopping shuts down the listening socket and the read side of every
+ * connected client, which wakes any thread blocked on them while leaving
+ * the write side open for the results still to come.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "daemon.h"
+#include "tokenize.h"
+
+/**
+ * @brief Wait for SIGINT or SIGTERM, then stop the daemon
+ */
+static void * daemon_signal_thread(void * arg)
+{
+  daemon_t * ptr_daemon = (daemon_t *)arg;
+  int sig;
+
+  sigwait(&ptr_daemon->signals, &sig);
+  daemon_stop(ptr_daemon);
+  return NULL;
+}
+
+int daemon_init(daemon_t ** ptr_daemon, const char * spec)
+{
+  daemon_t * ptr_d;
+  struct sockaddr_un addr;
+
+  if( (ptr_d = (daemon_t *)calloc(1, sizeof(daemon_t))) == NULL )
+  {
+    return -1;
+  }
+  ptr_d->listen_fd = -1;
+  lockprof_mutex_init(&ptr_d->mutex, "daemon");
+  atomic_init(&ptr_d->connections, 0);
+  atomic_init(&ptr_d->requests, 0);
+
+  // a client that goes away only loses its own results
+  signal(SIGPIPE, SIG_IGN);
+
+  if(strcmp(spec, "stdin") == 0)
+  {
+    *ptr_daemon = ptr_d;
+    return 0;
+  }
+
+  if(strncmp(spec, "unix:", 5) != 0 || spec[5] == '\0' || strlen(spec + 5) >= sizeof(addr.sun_path) ||
+     (ptr_d->path = strdup(spec + 5)) == NULL)
+  {
+    lockprof_mutex_destroy(&ptr_d->mutex);
+    free(ptr_d);
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, ptr_d->path);
+  unlink(ptr_d->path);
+  if( (ptr_d->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1 ||
+      bind(ptr_d->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+      listen(ptr_d->listen_fd, DAEMON_BACKLOG) == -1 )
+  {
+    if(ptr_d->listen_fd != -1)
+    {
+      close(ptr_d->listen_fd);
+    }
+    lockprof_mutex_destroy(&ptr_d->mutex);
+    free(ptr_d->path);
+    free(ptr_d);
+    return -1;
+  }
+
+  // every thread created from here on leaves the signals to the signal thread
+  sigemptyset(&ptr_d->signals);
+  sigaddset(&ptr_d->signals, SIGINT);
+  sigaddset(&ptr_d->signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &ptr_d->signals, NULL);
+  if( pthread_create(&ptr_d->signal_thread, NULL, daemon_signal_thread, ptr_d) == 0 )
+  {
+    ptr_d->signal_f = 1;
+  }
+
+  *ptr_daemon = ptr_d;
+  return 0;
+}
+
+void daemon_free(daemon_t * ptr_daemon)
+{
+  if(ptr_daemon->signal_f)
+  {
+    // wake the signal thread if no signal ever came
+    pthread_kill(ptr_daemon->signal_thread, SIGTERM);
+    pthread_join(ptr_daemon->signal_thread, NULL);
+  }
+  if(ptr_daemon->listen_fd != -1)
+  {
+    close(ptr_daemon->listen_fd);
+    unlink(ptr_daemon->path);
+  }
+  lockprof_mutex_destroy(&ptr_daemon->mutex);
+  free(ptr_daemon->path);
+  free(ptr_daemon);
+}
+
+/**
+ * @brief Create a client and add it to the connected list
+ *
+ * @return A pointer to the client, or NULL if stopped or malloc fails
+ */
+static daemon_client_t * daemon_client_add(daemon_t * ptr_daemon, int in_fd, int out_fd, int socket_f)
+{
+  daemon_client_t * ptr_client;
+
+  if( (ptr_client = (daemon_client_t *)malloc(sizeof(daemon_client_t))) == NULL )
+  {
+    return NULL;
+  }
+  ptr_client->prev = NULL;
+  ptr_client->in_fd = in_fd;
+  ptr_client->out_fd = out_fd;
+  ptr_client->socket_f = socket_f;
+  ptr_client->failed_f = 0;
+  ptr_client->eof_f = 0;
+  atomic_init(&ptr_client->refs, 1);
+  lockprof_mutex_init(&ptr_client->mutex, "daemon client");
+  ptr_client->len = 0;
+  ptr_client->ready = 0;
+  ptr_client->pos = 0;
+
+  lockprof_lock(&ptr_daemon->mutex);
+  if(ptr_daemon->stopped_f)
+  {
+    lockprof_unlock(&ptr_daemon->mutex);
+    lockprof_mutex_destroy(&ptr_client->mutex);
+    free(ptr_client);
+    return NULL;
+  }
+  ptr_client->next = ptr_daemon->clients;
+  if(ptr_daemon->clients != NULL)
+  {
+    ptr_daemon->clients->prev = ptr_client;
+  }
+  ptr_daemon->clients = ptr_client;
+  lockprof_unlock(&ptr_daemon->mutex);
+
+  atomic_fetch_add_explicit(&ptr_daemon->connections, 1, memory_order_relaxed);
+  return ptr_client;
+}
+
+/**
+ * @brief Drop a reference to a client, closing it with the last one
+ */
+static void daemon_client_release(daemon_client_t * ptr_client)
+{
+  if(atomic_fetch_sub_explicit(&ptr_client->refs, 1, memory_order_acq_rel) == 1)
+  {
+    if(ptr_client->socket_f)
+    {
+      close(ptr_client->in_fd);
+    }
+    lockprof_mutex_destroy(&ptr_client->mutex);
+    free(ptr_client);
+  }
+}
+
+daemon_client_t * daemon_accept(daemon_t * ptr_daemon)
+{
+  daemon_client_t * ptr_client;
+  int fd;
+
+  if(ptr_daemon->listen_fd == -1)
+  {
+    lockprof_lock(&ptr_daemon->mutex);
+    if(ptr_daemon->stdin_taken_f)
+    {
+      lockprof_unlock(&ptr_daemon->mutex);
+      return NULL;
+    }
+    ptr_daemon->stdin_taken_f = 1;
+    lockprof_unlock(&ptr_daemon->mutex);
+    return daemon_client_add(ptr_daemon, STDIN_FILENO, STDOUT_FILENO, 0);
+  }
+
+  while(1)
+  {
+    if( (fd = accept(ptr_daemon->listen_fd, NULL, NULL)) == -1 )
+    {
+      // keep going past clients that hang up while being accepted
+      if(errno == EINTR || errno == ECONNABORTED)
+      {
+        continue;
+      }
+      return NULL;
+    }
+    if( (ptr_client = daemon_client_add(ptr_daemon, fd, fd, 1)) == NULL )
+    {
+      close(fd);
+      lockprof_lock(&ptr_daemon->mutex);
+      if(ptr_daemon->stopped_f)
+      {
+        lockprof_unlock(&ptr_daemon->mutex);
+        return NULL;
+      }
+      lockprof_unlock(&ptr_daemon->mutex);
+      continue;
+    }
+    return ptr_client;
+  }
+}
+
+int daemon_next(daemon_client_t * ptr_client, const char ** ptr_token, int * ptr_token_len)
+{
+  ssize_t num_read;
+  size_t end;
+
+  while(1)
+  {
+    if( tokenize_next(ptr_client->buf, ptr_client->ready, &ptr_client->pos, ptr_token, ptr_token_len) == 0 )
+    {
+      return 0;
+    }
+    if(ptr_client->eof_f)
+    {
+      return -1;
+    }
+
+    // keep the unfinished line and read more after it
+    memmove(ptr_client->buf, ptr_client->buf + ptr_client->ready, ptr_client->len - ptr_client->ready);
+    ptr_client->len -= ptr_client->ready;
+    ptr_client->ready = 0;
+    ptr_client->pos = 0;
+    if( (num_read = read(ptr_client->in_fd, ptr_client->buf + ptr_client->len,
+                         DAEMON_READ_SIZE - ptr_client->len)) == -1 && errno == EINTR )
+    {
+      continue;
+    }
+    if(num_read <= 0)
+    {
+      ptr_client->eof_f = 1;
+      ptr_client->ready = ptr_client->len;
+      continue;
+    }
+    ptr_client->len += num_read;
+
+    // only whole lines are ready, unless one line fills the buffer
+    for(end = ptr_client->len; end > 0 && ptr_client->buf[end - 1] != '\n'; end--);
+    ptr_client->ready = (end == 0 && ptr_client->len == DAEMON_READ_SIZE) ? ptr_client->len : end;
+  }
+}
+
+char * daemon_request(daemon_t * ptr_daemon, daemon_client_t * ptr_client, const char * token, int token_len)
+{
+  daemon_request_t * ptr_request;
+
+  if( (ptr_request = (daemon_request_t *)malloc(sizeof(daemon_request_t) + token_len + 1)) == NULL )
+  {
+    return NULL;
+  }
+  atomic_fetch_add_explicit(&ptr_client->refs, 1, memory_order_relaxed);
+  ptr_request->ptr_client = ptr_client;
+  memcpy(ptr_request->name, token, token_len);
+  ptr_request->name[token_len] = '\0';
+  atomic_fetch_add_explicit(&ptr_daemon->requests, 1, memory_order_relaxed);
+  return ptr_request->name;
+}
+
+void daemon_reply(char * hostname, const char * const * pieces, int num_pieces)
+{
+  daemon_request_t * ptr_request = (daemon_request_t *)(hostname - offsetof(daemon_request_t, name));
+  daemon_client_t * ptr_client = ptr_request->ptr_client;
+  char line[DAEMON_LINE_MAX];
+  size_t len = 0;
+  size_t piece_len;
+  ssize_t written;
+
+  for(int i = 0; i < num_pieces; i++)
+  {
+    piece_len = strlen(pieces[i]);
+    if(len + piece_len >= sizeof(line) - 1)
+    {
+      piece_len = sizeof(line) - 1 - len;
+    }
+    memcpy(line + len, pieces[i], piece_len);
+    len += piece_len;
+  }
+  line[len++] = '\n';
+
+  // one write per result so lines from different resolvers never mix
+  lockprof_lock(&ptr_client->mutex);
+  for(size_t done = 0; !ptr_client->failed_f && done < len; done += written)
+  {
+    if( (written = write(ptr_client->out_fd, line + done, len - done)) == -1 )
+    {
+      if(errno != EINTR)
+      {
+        ptr_client->failed_f = 1;
+      }
+      written = 0;
+    }
+  }
+  lockprof_unlock(&ptr_client->mutex);
+
+  free(ptr_request);
+  daemon_client_release(ptr_client);
+}
+
+void daemon_done(daemon_t * ptr_daemon, daemon_client_t * ptr_client)
+{
+  lockprof_lock(&ptr_daemon->mutex);
+  if(ptr_client->prev != NULL)
+  {
+    ptr_client->prev->next = ptr_client->next;
+  }
+  else
+  {
+    ptr_daemon->clients = ptr_client->next;
+  }
+  if(ptr_client->next != NULL)
+  {
+    ptr_client->next->prev = ptr_client->prev;
+  }
+  lockprof_unlock(&ptr_daemon->mutex);
+
+  daemon_client_release(ptr_client);
+}
+
+void daemon_stop(daemon_t * ptr_daemon)
+{
+  lockprof_lock(&ptr_daemon->mutex);
+  if(!ptr_daemon->stopped_f)
+  {
+    ptr_daemon->stopped_f = 1;
+    if(ptr_daemon->listen_fd != -1)
+    {
+      shutdown(ptr_daemon->listen_fd, SHUT_RDWR);
+    }
+    for(daemon_client_t * ptr_client = ptr_daemon->clients; ptr_client != NULL; ptr_client = ptr_client->next)
+    {
+      if(ptr_client->socket_f)
+      {
+        shutdown(ptr_client->in_fd, SHUT_RD);
+      }
+    }
+  }
+  lockprof_unlock(&ptr_daemon->mutex);
+}
@@ -0,0 +1,172 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file daemon.h
+ * @brief Long-running input sources that stream results back
+ *
+ * Definitions and declarations for serving hostnames that arrive while
+ * the program runs, from stdin or from clients of a Unix domain socket.
+ * Each hostname is copied into a request that remembers its client, so
+ * whichever resolver finishes the lookup can write the result straight
+ * back. A client stays open until its last result has been written.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __DAEMON_H__
+#define __DAEMON_H__
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "lockprof.h"
+#include <signal.h>
+
+#define DAEMON_READ_SIZE (64 * 1024)
+#define DAEMON_LINE_MAX (2048)
+#define DAEMON_BACKLOG (64)
+
+typedef struct daemon_client
+{
+  struct daemon_client * prev;
+  struct daemon_client * next;
+  int in_fd;
+  int out_fd;
+  int socket_f;
+  int failed_f;
+  int eof_f;
+  atomic_int refs;
+  lockprof_mutex_t mutex;
+  size_t len;
+  size_t ready;
+  size_t pos;
+  char buf[DAEMON_READ_SIZE];
+} daemon_client_t;
+
+typedef struct
+{
+  daemon_client_t * ptr_client;
+  char name[];
+} daemon_request_t;
+
+typedef struct
+{
+  int listen_fd;
+  char * path;
+  int stdin_taken_f;
+  int stopped_f;
+  daemon_client_t * clients;
+  lockprof_mutex_t mutex;
+  pthread_t signal_thread;
+  int signal_f;
+  sigset_t signals;
+  atomic_ulong connections;
+  atomic_ulong requests;
+} daemon_t;
+
+/**
+ * @brief Start listening for hostnames
+ *
+ * Must be called before any other thread is created. For a socket, any
+ * file already at the path is replaced, and SIGINT and SIGTERM stop the
+ * daemon instead of killing the process so queued lookups still finish.
+ *
+ * @param ptr_daemon A pointer to the uninitialized daemon pointer
+ * @param spec stdin, or unix:PATH to listen on a Unix domain socket
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int daemon_init(daemon_t ** ptr_daemon, const char * spec);
+
+/**
+ * @brief Stop listening and free the daemon from the heap
+ *
+ * Every client must have been released.
+ *
+ * @param ptr_daemon A pointer to the daemon
+ */
+void daemon_free(daemon_t * ptr_daemon);
+
+/**
+ * @brief Wait for the next client
+ *
+ * stdin is a single client handed to the first caller only.
+ *
+ * @param ptr_daemon A pointer to the daemon
+ *
+ * @return A pointer to the client, or NULL once there will be no more
+ */
+daemon_client_t * daemon_accept(daemon_t * ptr_daemon);
+
+/**
+ * @brief Read the next hostname sent by a client
+ *
+ * Only whole lines are split into hostnames, so a name is never cut
+ * where a read happens to end.
+ *
+ * @param ptr_client A pointer to the client
+ * @param ptr_token Where a pointer to the hostname is stored, valid until
+ *                  the next call
+ * @param ptr_token_len Where the length of the hostname is stored
+ *
+ * @return 0 if a hostname was read, -1 once the client has sent everything
+ */
+int daemon_next(daemon_client_t * ptr_client, const char ** ptr_token, int * ptr_token_len);
+
+/**
+ * @brief Copy a hostname into a request that will be answered to its client
+ *
+ * @param ptr_daemon A pointer to the daemon
+ * @param ptr_client A pointer to the client that sent the hostname
+ * @param token The hostname
+ * @param token_len The length of the hostname
+ *
+ * @return The NUL terminated hostname inside the request, or NULL if
+ *         malloc fails
+ */
+char * daemon_request(daemon_t * ptr_daemon, daemon_client_t * ptr_client, const char * token, int token_len);
+
+/**
+ * @brief Write the result of a request back to its client and free it
+ *
+ * The pieces are joined and ended with a newline. A client that can no
+ * longer be written to is skipped.
+ *
+ * @param hostname The hostname returned by daemon_request()
+ * @param pieces The pieces of the line
+ * @param num_pieces The number of pieces
+ */
+void daemon_reply(char * hostname, const char * const * pieces, int num_pieces);
+
+/**
+ * @brief Finish reading from a client
+ *
+ * The client is closed once the results of its requests have been
+ * written.
+ *
+ * @param ptr_daemon A pointer to the daemon
+ * @param ptr_client A pointer to the client
+ */
+void daemon_done(daemon_t * ptr_daemon, daemon_client_t * ptr_client);
+
+/**
+ * @brief Stop accepting clients and stop reading from the connected ones
+ *
+ * Results of hostnames already read are still written back.
+ *
+ * @param ptr_daemon A pointer to the daemon
+ */
+void daemon_stop(daemon_t * ptr_daemon);
+
+#endif /* __DAEMON_H__ */
@@ -0,0 +1,426 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file diskcache.c
+ * @brief Persistent cache of resolved hostnames shared between runs
+ *
+ * Implementations for the cache file. Records are checked against the
+ * size of the mapping as they are read, so a damaged file can only cause
+ * misses. Saving builds the whole new file in memory first, which lets
+ * names be deduplicated against the table as it fills.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "diskcache.h"
+#include "timing.h"
+
+#define DISKCACHE_ALIGN (8)
+
+typedef struct
+{
+  char * buf;
+  size_t len;
+  size_t cap;
+  uint32_t num_slots;
+  uint64_t num_entries;
+  time_t now_s;
+  long long now_ms;
+  int failed_f;
+} diskcache_image_t;
+
+/**
+ * @brief Find a record in a mapped file, checking it lies within the file
+ *
+ * @return A pointer to the record, or NULL if it is out of bounds
+ */
+static const diskcache_record_t * diskcache_record(const char * map, size_t size, uint64_t offset)
+{
+  const diskcache_record_t * ptr_record;
+
+  if(offset % DISKCACHE_ALIGN != 0 || offset > size || size - offset < sizeof(diskcache_record_t))
+  {
+    return NULL;
+  }
+  ptr_record = (const diskcache_record_t *)(map + offset);
+  if(ptr_record->num_addrs > ADDR_SET_MAX ||
+     size - offset - sizeof(diskcache_record_t) < ptr_record->num_addrs * sizeof(addr_t) + ptr_record->name_len)
+  {
+    return NULL;
+  }
+  return ptr_record;
+}
+
+/**
+ * @brief The hostname stored in a record, which is not NUL terminated
+ */
+static const char * diskcache_record_name(const diskcache_record_t * ptr_record)
+{
+  return (const char *)(ptr_record + 1) + ptr_record->num_addrs * sizeof(addr_t);
+}
+
+/**
+ * @brief Copy the addresses stored in a record
+ */
+static void diskcache_record_addrs(const diskcache_record_t * ptr_record, addr_set_t * ptr_addrs)
+{
+  ptr_addrs->count = ptr_record->num_addrs;
+  memcpy(ptr_addrs->addrs, ptr_record + 1, ptr_record->num_addrs * sizeof(addr_t));
+}
+
+int diskcache_open(diskcache_t ** ptr_diskcache, const char * path)
+{
+  diskcache_t * ptr_dc;
+  const diskcache_header_t * ptr_header;
+  struct stat st;
+  void * map;
+  int fd;
+
+  if( (ptr_dc = (diskcache_t *)malloc(sizeof(diskcache_t))) == NULL )
+  {
+    return -1;
+  }
+  if( (ptr_dc->path = strdup(path)) == NULL )
+  {
+    free(ptr_dc);
+    return -1;
+  }
+  ptr_dc->map = NULL;
+  ptr_dc->size = 0;
+  ptr_dc->ptr_header = NULL;
+  ptr_dc->slots = NULL;
+  atomic_init(&ptr_dc->hits, 0);
+  ptr_dc->saved = 0;
+  *ptr_diskcache = ptr_dc;
+
+  // anything that is not a whole cache file starts an empty cache
+  if( (fd = open(path, O_RDONLY)) == -1 )
+  {
+    return 0;
+  }
+  if(fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(diskcache_header_t))
+  {
+    close(fd);
+    return 0;
+  }
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED)
+  {
+    return 0;
+  }
+
+  ptr_header = (const diskcache_header_t *)map;
+  if(memcmp(ptr_header->magic, DISKCACHE_MAGIC, sizeof(ptr_header->magic)) != 0 ||
+     ptr_header->version != DISKCACHE_VERSION ||
+     ptr_header->num_slots == 0 ||
+     (ptr_header->num_slots & (ptr_header->num_slots - 1)) != 0 ||
+     ptr_header->size != (uint64_t)st.st_size ||
+     (st.st_size - sizeof(diskcache_header_t)) / sizeof(diskcache_slot_t) < ptr_header->num_slots)
+  {
+    munmap(map, st.st_size);
+    return 0;
+  }
+
+  ptr_dc->map = (const char *)map;
+  ptr_dc->size = st.st_size;
+  ptr_dc->ptr_header = ptr_header;
+  ptr_dc->slots = (const diskcache_slot_t *)(ptr_header + 1);
+  return 0;
+}
+
+void diskcache_free(diskcache_t * ptr_diskcache)
+{
+  if(ptr_diskcache->map != NULL)
+  {
+    munmap((void *)ptr_diskcache->map, ptr_diskcache->size);
+  }
+  free(ptr_diskcache->path);
+  free(ptr_diskcache);
+}
+
+int diskcache_get(diskcache_t * ptr_diskcache, const char * hostname, addr_set_t * ptr_addrs, int * ptr_ttl_s)
+{
+  const diskcache_record_t * ptr_record;
+  const diskcache_slot_t * ptr_slot;
+  size_t name_len = strlen(hostname);
+  uint64_t hash;
+  uint32_t mask;
+  uint32_t i;
+  int64_t remaining;
+
+  if(ptr_diskcache->ptr_header == NULL)
+  {
+    return -1;
+  }
+
+  hash = cache_hash(hostname);
+  mask = ptr_diskcache->ptr_header->num_slots - 1;
+  i = hash & mask;
+  for(uint32_t probes = 0; probes <= mask; probes++, i = (i + 1) & mask)
+  {
+    ptr_slot = &ptr_diskcache->slots[i];
+    if(ptr_slot->offset == 0)
+    {
+      return -1;
+    }
+    if(ptr_slot->hash != hash ||
+       (ptr_record = diskcache_record(ptr_diskcache->map, ptr_diskcache->size, ptr_slot->offset)) == NULL ||
+       ptr_record->name_len != name_len ||
+       strncasecmp(diskcache_record_name(ptr_record), hostname, name_len) != 0)
+    {
+      continue;
+    }
+
+    remaining = ptr_record->resolved_s + (int64_t)ptr_record->ttl_s - (int64_t)time(NULL);
+    if(remaining <= 0)
+    {
+      return -1;
+    }
+    diskcache_record_addrs(ptr_record, ptr_addrs);
+    *ptr_ttl_s = remaining;
+    atomic_fetch_add_explicit(&ptr_diskcache->hits, 1, memory_order_relaxed);
+    return 0;
+  }
+  return -1;
+}
+
+size_t diskcache_entries(diskcache_t * ptr_diskcache)
+{
+  if(ptr_diskcache->ptr_header == NULL)
+  {
+    return 0;
+  }
+  return ptr_diskcache->ptr_header->num_entries;
+}
+
+/**
+ * @brief Add an entry to a file image unless its name is already there
+ */
+static void diskcache_image_add(diskcache_image_t * ptr_image, uint64_t hash, const char * name, size_t name_len,
+                                const addr_set_t * ptr_addrs, int64_t resolved_s, uint32_t ttl_s)
+{
+  diskcache_slot_t * slots;
+  diskcache_record_t * ptr_record;
+  const diskcache_record_t * ptr_other;
+  size_t record_size;
+  size_t cap;
+  char * buf;
+  uint32_t mask = ptr_image->num_slots - 1;
+  uint32_t i = hash & mask;
+
+  if(ptr_image->failed_f || name_len > UINT16_MAX || ptr_image->num_entries * 2 >= ptr_image->num_slots)
+  {
+    return;
+  }
+
+  slots = (diskcache_slot_t *)(ptr_image->buf + sizeof(diskcache_header_t));
+  while(slots[i].offset != 0)
+  {
+    ptr_other = (const diskcache_record_t *)(ptr_image->buf + slots[i].offset);
+    if(slots[i].hash == hash && ptr_other->name_len == name_len &&
+       strncasecmp(diskcache_record_name(ptr_other), name, name_len) == 0)
+    {
+      return;
+    }
+    i = (i + 1) & mask;
+  }
+
+  record_size = sizeof(diskcache_record_t) + ptr_addrs->count * sizeof(addr_t) + name_len;
+  record_size = (record_size + DISKCACHE_ALIGN - 1) & ~(size_t)(DISKCACHE_ALIGN - 1);
+  if(ptr_image->len + record_size > ptr_image->cap)
+  {
+    cap = ptr_image->cap * 2;
+    while(ptr_image->len + record_size > cap)
+    {
+      cap *= 2;
+    }
+    if( (buf = (char *)realloc(ptr_image->buf, cap)) == NULL )
+    {
+      ptr_image->failed_f = 1;
+      return;
+    }
+    ptr_image->buf = buf;
+    ptr_image->cap = cap;
+    slots = (diskcache_slot_t *)(buf + sizeof(diskcache_header_t));
+  }
+
+  ptr_record = (diskcache_record_t *)(ptr_image->buf + ptr_image->len);
+  memset(ptr_record, 0, record_size);
+  ptr_record->resolved_s = resolved_s;
+  ptr_record->ttl_s = ttl_s;
+  ptr_record->name_len = name_len;
+  ptr_record->num_addrs = ptr_addrs->count;
+  memcpy(ptr_record + 1, ptr_addrs->addrs, ptr_addrs->count * sizeof(addr_t));
+  memcpy((char *)(ptr_record + 1) + ptr_addrs->count * sizeof(addr_t), name, name_len);
+
+  slots[i].hash = hash;
+  slots[i].offset = ptr_image->len;
+  ptr_image->len += record_size;
+  ptr_image->num_entries++;
+}
+
+/**
+ * @brief Add an in-memory cache entry to a file image
+ *
+ * The resolution time is moved from the monotonic clock to the wall
+ * clock, rounding back a second so the entry never outlives its TTL.
+ */
+static void diskcache_visit(void * ptr_user, const char * hostname, const addr_set_t * ptr_addrs,
+                            long long resolved_ms, int ttl_s)
+{
+  diskcache_image_t * ptr_image = (diskcache_image_t *)ptr_user;
+  long long age_ms = ptr_image->now_ms - resolved_ms;
+
+  diskcache_image_add(ptr_image, cache_hash(hostname), hostname, strlen(hostname), ptr_addrs,
+                      (int64_t)ptr_image->now_s - (age_ms + 999) / 1000, ttl_s);
+}
+
+/**
+ * @brief Write a whole buffer to a file descriptor
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+static int diskcache_write_all(int fd, const char * buf, size_t len)
+{
+  ssize_t written;
+
+  while(len > 0)
+  {
+    if( (written = write(fd, buf, len)) == -1 )
+    {
+      return -1;
+    }
+    buf += written;
+    len -= written;
+  }
+  return 0;
+}
+
+int diskcache_save(diskcache_t * ptr_diskcache, cache_t ** caches, int num_caches)
+{
+  diskcache_image_t image;
+  diskcache_header_t * ptr_header;
+  const diskcache_record_t * ptr_record;
+  const diskcache_slot_t * ptr_slot;
+  cache_stats_t stats;
+  addr_set_t addrs;
+  char * tmp_path;
+  size_t tmp_len;
+  uint64_t bound;
+  int fd;
+  int ret;
+
+  // size the table for everything that could be kept, at most half full
+  bound = diskcache_entries(ptr_diskcache);
+  for(int i = 0; i < num_caches; i++)
+  {
+    cache_stats(caches[i], &stats);
+    bound += stats.entries;
+  }
+  image.num_slots = DISKCACHE_MIN_SLOTS;
+  while(image.num_slots < bound * 2)
+  {
+    image.num_slots *= 2;
+  }
+  image.len = sizeof(diskcache_header_t) + (size_t)image.num_slots * sizeof(diskcache_slot_t);
+  image.cap = image.len * 2;
+  image.num_entries = 0;
+  image.now_s = time(NULL);
+  image.now_ms = now_ms();
+  image.failed_f = 0;
+  if( (image.buf = (char *)calloc(1, image.cap)) == NULL )
+  {
+    return -1;
+  }
+
+  // entries resolved during this run are newer than those in the file
+  for(int i = 0; i < num_caches; i++)
+  {
+    cache_foreach(caches[i], diskcache_visit, &image);
+  }
+  for(uint32_t i = 0; ptr_diskcache->ptr_header != NULL && i < ptr_diskcache->ptr_header->num_slots; i++)
+  {
+    ptr_slot = &ptr_diskcache->slots[i];
+    if(ptr_slot->offset == 0 ||
+       (ptr_record = diskcache_record(ptr_diskcache->map, ptr_diskcache->size, ptr_slot->offset)) == NULL ||
+       ptr_record->resolved_s + (int64_t)ptr_record->ttl_s <= (int64_t)image.now_s)
+    {
+      continue;
+    }
+    diskcache_record_addrs(ptr_record, &addrs);
+    diskcache_image_add(&image, ptr_slot->hash, diskcache_record_name(ptr_record), ptr_record->name_len, &addrs,
+                        ptr_record->resolved_s, ptr_record->ttl_s);
+  }
+  if(image.failed_f)
+  {
+    free(image.buf);
+    return -1;
+  }
+
+  ptr_header = (diskcache_header_t *)image.buf;
+  memcpy(ptr_header->magic, DISKCACHE_MAGIC, sizeof(ptr_header->magic));
+  ptr_header->version = DISKCACHE_VERSION;
+  ptr_header->num_slots = image.num_slots;
+  ptr_header->num_entries = image.num_entries;
+  ptr_header->size = image.len;
+
+  // write beside the old file and rename over it so readers only ever
+  // see a whole file
+  tmp_len = strlen(ptr_diskcache->path) + 32;
+  if( (tmp_path = (char *)malloc(tmp_len)) == NULL )
+  {
+    free(image.buf);
+    return -1;
+  }
+  snprintf(tmp_path, tmp_len, "%s.tmp.%ld", ptr_diskcache->path, (long)getpid());
+
+  ret = -1;
+  if( (fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) != -1 )
+  {
+    if(diskcache_write_all(fd, image.buf, image.len) == 0 && fsync(fd) == 0)
+    {
+      ret = 0;
+    }
+    if(close(fd) == -1)
+    {
+      ret = -1;
+    }
+    if(ret == 0 && rename(tmp_path, ptr_diskcache->path) == -1)
+    {
+      ret = -1;
+    }
+    if(ret == -1)
+    {
+      unlink(tmp_path);
+    }
+  }
+  if(ret == 0)
+  {
+    ptr_diskcache->saved = image.num_entries;
+  }
+
+  free(tmp_path);
+  free(image.buf);
+  return ret;
+}
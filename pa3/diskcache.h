@@ -0,0 +1,135 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file diskcache.h
+ * @brief Persistent cache of resolved hostnames shared between runs
+ *
+ * Definitions and declarations for a cache file that is mapped into
+ * memory as it is and searched in place, so loading it costs no more
+ * than the pages a run actually touches. The file is an open-addressing
+ * table of hostname hashes pointing at records that hold the addresses,
+ * the wall-clock time they were resolved and their TTL. Entries that
+ * have expired are never served and never written back.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __DISKCACHE_H__
+#define __DISKCACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "cache.h"
+#include "addr.h"
+
+#define DISKCACHE_MAGIC ("MLCACHE\0")
+#define DISKCACHE_VERSION (1)
+#define DISKCACHE_MIN_SLOTS (16)
+
+typedef struct
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t num_slots;
+  uint64_t num_entries;
+  uint64_t size;
+} diskcache_header_t;
+
+typedef struct
+{
+  uint64_t hash;
+  uint64_t offset;
+} diskcache_slot_t;
+
+typedef struct
+{
+  int64_t resolved_s;
+  uint32_t ttl_s;
+  uint16_t name_len;
+  uint8_t num_addrs;
+  uint8_t reserved;
+} diskcache_record_t;
+
+typedef struct
+{
+  char * path;
+  const char * map;
+  size_t size;
+  const diskcache_header_t * ptr_header;
+  const diskcache_slot_t * slots;
+  atomic_ulong hits;
+  size_t saved;
+} diskcache_t;
+
+/**
+ * @brief Open a cache file
+ *
+ * A file that is missing or not a valid cache file is treated as an
+ * empty cache and replaced when the cache is saved.
+ *
+ * @param ptr_diskcache A pointer to the uninitialized cache pointer
+ * @param path The name of the cache file
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int diskcache_open(diskcache_t ** ptr_diskcache, const char * path);
+
+/**
+ * @brief Unmap a cache file and free the cache from the heap
+ *
+ * @param ptr_diskcache A pointer to the cache
+ */
+void diskcache_free(diskcache_t * ptr_diskcache);
+
+/**
+ * @brief Look up a hostname in the cache file
+ *
+ * Safe to call from any number of threads at once.
+ *
+ * @param ptr_diskcache A pointer to the cache
+ * @param hostname The hostname
+ * @param ptr_addrs Where the addresses are copied if found
+ * @param ptr_ttl_s Where the seconds left before the entry expires are
+ *                  stored if found
+ *
+ * @return 0 if an unexpired entry was found, -1 otherwise
+ */
+int diskcache_get(diskcache_t * ptr_diskcache, const char * hostname, addr_set_t * ptr_addrs, int * ptr_ttl_s);
+
+/**
+ * @brief Number of entries in the loaded cache file
+ *
+ * @param ptr_diskcache A pointer to the cache
+ */
+size_t diskcache_entries(diskcache_t * ptr_diskcache);
+
+/**
+ * @brief Write the cache file back
+ *
+ * Merges the unexpired entries of the in-memory caches with the unexpired
+ * entries of the loaded file, preferring the in-memory one when a name is
+ * in both. The new file is written beside the old one and renamed over it,
+ * so a run that is interrupted never leaves a partly written cache file.
+ * No threads may use either cache while it is saved.
+ *
+ * @param ptr_diskcache A pointer to the cache
+ * @param caches The in-memory caches, which hold different names
+ * @param num_caches The number of in-memory caches
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int diskcache_save(diskcache_t * ptr_diskcache, cache_t ** caches, int num_caches);
+
+#endif /* __DISKCACHE_H__ */
@@ -0,0 +1,687 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file dns.c
+ * @brief Non-blocking DNS client
+ *
+ * Implementations for the event-driven DNS engine. Every query gets a
+ * random transaction ID that no other outstanding query holds, and an
+ * answer is only taken if its ID and question name both match, so a
+ * spoofed or late datagram cannot finish the wrong query. Queries are
+ * found by ID through a small hash table. An A query and its AAAA query
+ * are paired, and whichever is answered first leaves its result with the
+ * other, which reports both. Every query waits the same
+ * timeout, so the outstanding queries are kept in a list ordered by
+ * deadline and only the oldest ones ever need to be checked for expiry.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/random.h>
+#include "dns.h"
+#include "timing.h"
+
+#define DNS_HEADER_LEN (12)
+#define DNS_TYPE_A (1)
+#define DNS_TYPE_AAAA (28)
+#define DNS_CLASS_IN (1)
+#define DNS_FLAG_QR (0x8000)
+#define DNS_FLAG_TC (0x0200)
+#define DNS_FLAG_RD (0x0100)
+#define DNS_RCODE_MASK (0x000F)
+#define DNS_MAX_POINTERS (16)
+
+/**
+ * @brief Parse an address and optional port into a socket address
+ */
+static int dns_addr_parse(const char * host, const char * port, struct sockaddr_storage * ptr_addr, socklen_t * ptr_addr_len)
+{
+  struct sockaddr_in * ptr_in = (struct sockaddr_in *)ptr_addr;
+  struct sockaddr_in6 * ptr_in6 = (struct sockaddr_in6 *)ptr_addr;
+  int port_num = DNS_PORT;
+
+  if(port != NULL && (sscanf(port, "%d", &port_num) != 1 || port_num < 1 || port_num > 65535))
+  {
+    return -1;
+  }
+
+  memset(ptr_addr, 0, sizeof(*ptr_addr));
+  if( inet_pton(AF_INET, host, &ptr_in->sin_addr) == 1 )
+  {
+    ptr_in->sin_family = AF_INET;
+    ptr_in->sin_port = htons(port_num);
+    *ptr_addr_len = sizeof(struct sockaddr_in);
+    return 0;
+  }
+  if( inet_pton(AF_INET6, host, &ptr_in6->sin6_addr) == 1 )
+  {
+    ptr_in6->sin6_family = AF_INET6;
+    ptr_in6->sin6_port = htons(port_num);
+    *ptr_addr_len = sizeof(struct sockaddr_in6);
+    return 0;
+  }
+
+  return -1;
+}
+
+int dns_server_parse(const char * str, struct sockaddr_storage * ptr_addr, socklen_t * ptr_addr_len)
+{
+  char host[INET6_ADDRSTRLEN + 1];
+  char line[256];
+  const char * port = NULL;
+  const char * end;
+  FILE * ptr_file;
+
+  // default to the system resolver
+  if(str == NULL)
+  {
+    if( (ptr_file = fopen(DNS_RESOLV_CONF, "r")) == NULL )
+    {
+      return -1;
+    }
+    while( fgets(line, sizeof(line), ptr_file) != NULL )
+    {
+      if( sscanf(line, " nameserver %46s", host) == 1 && dns_addr_parse(host, NULL, ptr_addr, ptr_addr_len) == 0 )
+      {
+        fclose(ptr_file);
+        return 0;
+      }
+    }
+    fclose(ptr_file);
+    return -1;
+  }
+
+  if(str[0] == '[')
+  {
+    // bracketed IPv6 address with optional port
+    if( (end = strchr(str, ']')) == NULL || end - str - 1 > INET6_ADDRSTRLEN )
+    {
+      return -1;
+    }
+    memcpy(host, str + 1, end - str - 1);
+    host[end - str - 1] = '\0';
+    if(end[1] == ':') port = end + 2;
+    else if(end[1] != '\0') return -1;
+  }
+  else
+  {
+    // IPv4 address with optional port, or bare IPv6 address
+    if( strlen(str) > INET6_ADDRSTRLEN )
+    {
+      return -1;
+    }
+    strcpy(host, str);
+    if( (end = strchr(host, ':')) != NULL && strchr(end + 1, ':') == NULL )
+    {
+      host[end - host] = '\0';
+      port = str + (end - host) + 1;
+    }
+  }
+
+  return dns_addr_parse(host, port, ptr_addr, ptr_addr_len);
+}
+
+int dns_engine_init(dns_engine_t ** ptr_engine, const struct sockaddr * ptr_server, socklen_t server_len,
+                    int max_inflight, int timeout_ms, int retries, int ipv6_f)
+{
+  struct epoll_event event;
+  int num_slots;
+
+  // every hostname takes a slot, and a transaction ID, per question
+  num_slots = max_inflight * (ipv6_f ? 2 : 1);
+  if(max_inflight < 1 || num_slots > DNS_MAX_INFLIGHT)
+  {
+    return -1;
+  }
+
+  if( (*ptr_engine = (dns_engine_t *)calloc(1, sizeof(dns_engine_t))) == NULL )
+  {
+    return -1;
+  }
+  (*ptr_engine)->timeout_ms = timeout_ms;
+  (*ptr_engine)->retries = retries;
+  (*ptr_engine)->max_inflight = max_inflight;
+  (*ptr_engine)->ipv6_f = ipv6_f;
+
+  // query table doubles as the free list
+  if( ((*ptr_engine)->queries = (dns_query_t *)calloc(num_slots, sizeof(dns_query_t))) == NULL )
+  {
+    free((void *)*ptr_engine);
+    return -1;
+  }
+  for(int i = 0; i < num_slots - 1; i++)
+  {
+    (*ptr_engine)->queries[i].next = &(*ptr_engine)->queries[i + 1];
+  }
+  (*ptr_engine)->ptr_free = (*ptr_engine)->queries;
+
+  // outstanding queries are found by ID, about one per bucket when full
+  for((*ptr_engine)->id_mask = 1; (*ptr_engine)->id_mask < num_slots; (*ptr_engine)->id_mask <<= 1);
+  if( ((*ptr_engine)->id_buckets = (dns_query_t **)calloc((*ptr_engine)->id_mask, sizeof(dns_query_t *))) == NULL )
+  {
+    free((void *)(*ptr_engine)->queries);
+    free((void *)*ptr_engine);
+    return -1;
+  }
+  (*ptr_engine)->id_mask--;
+
+  // connected socket only receives datagrams from the server
+  if( ((*ptr_engine)->sock_fd = socket(ptr_server->sa_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0 )
+  {
+    free((void *)(*ptr_engine)->id_buckets);
+    free((void *)(*ptr_engine)->queries);
+    free((void *)*ptr_engine);
+    return -1;
+  }
+  if( connect((*ptr_engine)->sock_fd, ptr_server, server_len) != 0 )
+  {
+    close((*ptr_engine)->sock_fd);
+    free((void *)(*ptr_engine)->id_buckets);
+    free((void *)(*ptr_engine)->queries);
+    free((void *)*ptr_engine);
+    return -1;
+  }
+
+  if( ((*ptr_engine)->epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0 )
+  {
+    close((*ptr_engine)->sock_fd);
+    free((void *)(*ptr_engine)->id_buckets);
+    free((void *)(*ptr_engine)->queries);
+    free((void *)*ptr_engine);
+    return -1;
+  }
+  event.events = EPOLLIN;
+  event.data.fd = (*ptr_engine)->sock_fd;
+  if( epoll_ctl((*ptr_engine)->epoll_fd, EPOLL_CTL_ADD, (*ptr_engine)->sock_fd, &event) != 0 )
+  {
+    close((*ptr_engine)->epoll_fd);
+    close((*ptr_engine)->sock_fd);
+    free((void *)(*ptr_engine)->id_buckets);
+    free((void *)(*ptr_engine)->queries);
+    free((void *)*ptr_engine);
+    return -1;
+  }
+
+  return 0;
+}
+
+void dns_engine_free(dns_engine_t * ptr_engine)
+{
+  close(ptr_engine->epoll_fd);
+  close(ptr_engine->sock_fd);
+  free((void *)ptr_engine->id_buckets);
+  free((void *)ptr_engine->queries);
+  free((void *)ptr_engine);
+}
+
+/**
+ * @brief Add a query to the newest end of the deadline list
+ */
+static void dns_list_append(dns_engine_t * ptr_engine, dns_query_t * ptr_query)
+{
+  ptr_query->next = NULL;
+  ptr_query->prev = ptr_engine->ptr_newest;
+  if(ptr_engine->ptr_newest != NULL) ptr_engine->ptr_newest->next = ptr_query;
+  else ptr_engine->ptr_oldest = ptr_query;
+  ptr_engine->ptr_newest = ptr_query;
+}
+
+/**
+ * @brief Remove a query from the deadline list
+ */
+static void dns_list_remove(dns_engine_t * ptr_engine, dns_query_t * ptr_query)
+{
+  if(ptr_query->prev != NULL) ptr_query->prev->next = ptr_query->next;
+  else ptr_engine->ptr_oldest = ptr_query->next;
+  if(ptr_query->next != NULL) ptr_query->next->prev = ptr_query->prev;
+  else ptr_engine->ptr_newest = ptr_query->prev;
+}
+
+/**
+ * @brief Find the outstanding query holding a transaction ID
+ *
+ * @return The query, or NULL if no query holds the ID
+ */
+static dns_query_t * dns_id_find(dns_engine_t * ptr_engine, uint16_t id)
+{
+  dns_query_t * ptr_query;
+
+  for(ptr_query = ptr_engine->id_buckets[id & ptr_engine->id_mask]; ptr_query != NULL && ptr_query->id != id;
+      ptr_query = ptr_query->id_next);
+
+  return ptr_query;
+}
+
+/**
+ * @brief Give a query a random transaction ID no outstanding query holds
+ *
+ * IDs come from the kernel's random source a batch at a time. Should it
+ * fail, the clock is mixed in instead, which is still not the slot
+ * number a spoofer could guess.
+ */
+static void dns_id_assign(dns_engine_t * ptr_engine, dns_query_t * ptr_query)
+{
+  dns_query_t ** ptr_bucket;
+  uint16_t id;
+
+  do
+  {
+    if(ptr_engine->num_random_ids == 0)
+    {
+      if( getrandom(ptr_engine->random_ids, sizeof(ptr_engine->random_ids), 0) != (ssize_t)sizeof(ptr_engine->random_ids) )
+      {
+        unsigned long long seed = (unsigned long long)now_ns() * 0x9E3779B97F4A7C15ULL;
+        for(int i = 0; i < DNS_RANDOM_BATCH; i++)
+        {
+          seed ^= seed >> 29;
+          seed *= 0xBF58476D1CE4E5B9ULL;
+          ptr_engine->random_ids[i] = (uint16_t)(seed >> 48);
+        }
+      }
+      ptr_engine->num_random_ids = DNS_RANDOM_BATCH;
+    }
+    id = ptr_engine->random_ids[--ptr_engine->num_random_ids];
+  } while( dns_id_find(ptr_engine, id) != NULL );
+
+  ptr_query->id = id;
+  ptr_bucket = &ptr_engine->id_buckets[id & ptr_engine->id_mask];
+  ptr_query->id_next = *ptr_bucket;
+  *ptr_bucket = ptr_query;
+}
+
+/**
+ * @brief Give up a query's transaction ID
+ */
+static void dns_id_release(dns_engine_t * ptr_engine, dns_query_t * ptr_query)
+{
+  dns_query_t ** ptr_link = &ptr_engine->id_buckets[ptr_query->id & ptr_engine->id_mask];
+
+  while(*ptr_link != ptr_query)
+  {
+    ptr_link = &(*ptr_link)->id_next;
+  }
+  *ptr_link = ptr_query->id_next;
+}
+
+/**
+ * @brief Encode and send a query, restarting its timeout
+ *
+ * A failed send is not retried right away, the query simply times out
+ * and is resent like a lost datagram.
+ */
+static void dns_send(dns_engine_t * ptr_engine, dns_query_t * ptr_query)
+{
+  unsigned char packet[DNS_HEADER_LEN + DNS_MAX_NAME_LEN + 6];
+  uint16_t id = ptr_query->id;
+  int len = DNS_HEADER_LEN;
+  const char * label = ptr_query->name;
+  const char * dot;
+
+  // header: id, recursion desired, one question
+  memset(packet, 0, DNS_HEADER_LEN);
+  packet[0] = id >> 8;
+  packet[1] = id & 0xFF;
+  packet[2] = DNS_FLAG_RD >> 8;
+  packet[5] = 1;
+
+  // question name as length-prefixed labels
+  while(*label != '\0')
+  {
+    if( (dot = strchr(label, '.')) == NULL ) dot = label + strlen(label);
+    packet[len++] = dot - label;
+    memcpy(&packet[len], label, dot - label);
+    len += dot - label;
+    label = (*dot == '.') ? dot + 1 : dot;
+  }
+  packet[len++] = 0;
+
+  // question type and class
+  packet[len++] = ptr_query->type >> 8;
+  packet[len++] = ptr_query->type & 0xFF;
+  packet[len++] = 0;
+  packet[len++] = DNS_CLASS_IN;
+
+  send(ptr_engine->sock_fd, packet, len, 0);
+
+  ptr_query->tries++;
+  ptr_query->deadline_ms = now_ms() + ptr_engine->timeout_ms;
+  dns_list_append(ptr_engine, ptr_query);
+}
+
+/**
+ * @brief Take a query slot from the free list and send a question for a hostname
+ */
+static dns_query_t * dns_start(dns_engine_t * ptr_engine, const char * hostname, int name_len, int type, void * ctx)
+{
+  dns_query_t * ptr_query = ptr_engine->ptr_free;
+
+  ptr_engine->ptr_free = ptr_query->next;
+
+  memcpy(ptr_query->name, hostname, name_len);
+  ptr_query->name[name_len] = '\0';
+  ptr_query->name_len = name_len;
+  ptr_query->type = type;
+  ptr_query->ctx = ctx;
+  ptr_query->tries = 0;
+  ptr_query->ptr_pair = NULL;
+  ptr_query->merge_f = 0;
+  ptr_query->start_ns = now_ns();
+  dns_id_assign(ptr_engine, ptr_query);
+  dns_send(ptr_engine, ptr_query);
+
+  return ptr_query;
+}
+
+int dns_engine_submit(dns_engine_t * ptr_engine, const char * hostname, void * ctx)
+{
+  dns_query_t * ptr_query;
+  dns_query_t * ptr_pair;
+  int name_len = strlen(hostname);
+  const char * label;
+  const char * dot;
+
+  // a hostname takes a slot for each question asked about it
+  if(ptr_engine->ptr_free == NULL || (ptr_engine->ipv6_f && ptr_engine->ptr_free->next == NULL))
+  {
+    return -1;
+  }
+
+  // drop one trailing dot, then check every label fits in a length byte
+  if(name_len > 0 && hostname[name_len - 1] == '.') name_len--;
+  if(name_len == 0 || name_len > DNS_MAX_NAME_LEN - 2)
+  {
+    return -1;
+  }
+  for(label = hostname; label < hostname + name_len; label = dot + 1)
+  {
+    if( (dot = memchr(label, '.', hostname + name_len - label)) == NULL ) dot = hostname + name_len;
+    if(dot == label || dot - label > 63)
+    {
+      return -1;
+    }
+  }
+
+  ptr_engine->num_inflight++;
+  ptr_query = dns_start(ptr_engine, hostname, name_len, DNS_TYPE_A, ctx);
+  if(ptr_engine->ipv6_f)
+  {
+    ptr_pair = dns_start(ptr_engine, hostname, name_len, DNS_TYPE_AAAA, ctx);
+    ptr_pair->start_ns = ptr_query->start_ns;
+    ptr_query->ptr_pair = ptr_pair;
+    ptr_pair->ptr_pair = ptr_query;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Release a query and report its result
+ *
+ * The first of a pair to finish only leaves its result with the other.
+ * The second merges both, IPv4 first, and succeeds if either found an
+ * address.
+ *
+ * @return 1 if the hostname was reported, 0 if its pair is still waiting
+ */
+static int dns_finish(dns_engine_t * ptr_engine, dns_query_t * ptr_query, int status, const addr_set_t * ptr_addrs,
+                      int ttl_s, dns_callback_t callback, void * ptr_user)
+{
+  void * ctx = ptr_query->ctx;
+  dns_query_t * ptr_pair = ptr_query->ptr_pair;
+  const addr_set_t * ptr_first;
+  const addr_set_t * ptr_second;
+  addr_set_t merged;
+
+  dns_list_remove(ptr_engine, ptr_query);
+  dns_id_release(ptr_engine, ptr_query);
+  ptr_query->next = ptr_engine->ptr_free;
+  ptr_engine->ptr_free = ptr_query;
+  ptr_query->tries = 0;
+
+  if(ptr_pair != NULL)
+  {
+    ptr_pair->ptr_pair = NULL;
+    ptr_pair->merge_f = 1;
+    ptr_pair->merge_status = status;
+    ptr_pair->merge_ttl_s = ttl_s;
+    if(status == 0)
+    {
+      ptr_pair->merge_addrs = *ptr_addrs;
+    }
+    return 0;
+  }
+
+  if(ptr_query->merge_f && ptr_query->merge_status == 0)
+  {
+    if(status != 0)
+    {
+      status = 0;
+      ptr_addrs = &ptr_query->merge_addrs;
+      ttl_s = ptr_query->merge_ttl_s;
+    }
+    else
+    {
+      ptr_first = ptr_query->type == DNS_TYPE_A ? ptr_addrs : &ptr_query->merge_addrs;
+      ptr_second = ptr_query->type == DNS_TYPE_A ? &ptr_query->merge_addrs : ptr_addrs;
+      merged = *ptr_first;
+      for(int i = 0; i < ptr_second->count; i++)
+      {
+        addr_set_add(&merged, ptr_second->addrs[i].family, ptr_second->addrs[i].bytes);
+      }
+      ptr_addrs = &merged;
+      if(ptr_query->merge_ttl_s < ttl_s) ttl_s = ptr_query->merge_ttl_s;
+    }
+  }
+  ptr_engine->num_inflight--;
+  ptr_engine->last_elapsed_ns = now_ns() - ptr_query->start_ns;
+
+  callback(ptr_user, ctx, status, ptr_addrs, ttl_s);
+  return 1;
+}
+
+/**
+ * @brief Decode a possibly compressed name from a packet
+ *
+ * @return The offset just past the name in the packet, -1 if malformed
+ */
+static int dns_read_name(const unsigned char * packet, int len, int offset, char * name)
+{
+  int end = -1;
+  int name_len = 0;
+  int pointers = 0;
+
+  while(offset < len)
+  {
+    if(packet[offset] == 0)
+    {
+      if(end < 0) end = offset + 1;
+      if(name_len > 0) name_len--;
+      name[name_len] = '\0';
+      return end;
+    }
+    else if((packet[offset] & 0xC0) == 0xC0)
+    {
+      // pointer to an earlier name, bounded to reject loops
+      if(offset + 1 >= len || ++pointers > DNS_MAX_POINTERS)
+      {
+        return -1;
+      }
+      if(end < 0) end = offset + 2;
+      offset = ((packet[offset] & 0x3F) << 8) | packet[offset + 1];
+    }
+    else if((packet[offset] & 0xC0) == 0)
+    {
+      if(offset + 1 + packet[offset] > len || name_len + packet[offset] + 1 > DNS_MAX_NAME_LEN)
+      {
+        return -1;
+      }
+      memcpy(&name[name_len], &packet[offset + 1], packet[offset]);
+      name_len += packet[offset];
+      name[name_len++] = '.';
+      offset += 1 + packet[offset];
+    }
+    else
+    {
+      return -1;
+    }
+  }
+
+  return -1;
+}
+
+/**
+ * @brief Match an answer to its query and finish the query
+ */
+static int dns_handle_answer(dns_engine_t * ptr_engine, const unsigned char * packet, int len,
+                             dns_callback_t callback, void * ptr_user)
+{
+  char name[DNS_MAX_NAME_LEN + 1];
+  addr_set_t addrs;
+  long min_ttl_s = INT32_MAX;
+  dns_query_t * ptr_query;
+  int id, flags, num_questions, num_answers;
+  int type, class, rdata_len;
+  long ttl_s;
+  int offset;
+
+  if(len < DNS_HEADER_LEN)
+  {
+    return 0;
+  }
+  id = (packet[0] << 8) | packet[1];
+  flags = (packet[2] << 8) | packet[3];
+  num_questions = (packet[4] << 8) | packet[5];
+  num_answers = (packet[6] << 8) | packet[7];
+
+  // ignore anything that does not answer an outstanding query, both by
+  // its ID and by the name it asks about
+  if(!(flags & DNS_FLAG_QR) || num_questions != 1 || (ptr_query = dns_id_find(ptr_engine, id)) == NULL)
+  {
+    return 0;
+  }
+  if( (offset = dns_read_name(packet, len, DNS_HEADER_LEN, name)) < 0 || strcasecmp(name, ptr_query->name) != 0 )
+  {
+    return 0;
+  }
+  offset += 4;
+
+  // any error code, such as a missing name, fails right away, and so does
+  // a truncated answer, whose records cannot be trusted to be complete
+  if(flags & (DNS_RCODE_MASK | DNS_FLAG_TC))
+  {
+    return dns_finish(ptr_engine, ptr_query, -1, NULL, 0, callback, ptr_user);
+  }
+
+  // collect every address record, skipping aliases, valid for as long as
+  // the shortest lived of them
+  addrs.count = 0;
+  for(int i = 0; i < num_answers; i++)
+  {
+    if( (offset = dns_read_name(packet, len, offset, name)) < 0 || offset + 10 > len )
+    {
+      break;
+    }
+    type = (packet[offset] << 8) | packet[offset + 1];
+    class = (packet[offset + 2] << 8) | packet[offset + 3];
+    ttl_s = ((long)packet[offset + 4] << 24) | (packet[offset + 5] << 16) | (packet[offset + 6] << 8) | packet[offset + 7];
+    rdata_len = (packet[offset + 8] << 8) | packet[offset + 9];
+    offset += 10;
+    if(offset + rdata_len > len)
+    {
+      break;
+    }
+    if(class == DNS_CLASS_IN && ((type == DNS_TYPE_A && rdata_len == 4) || (type == DNS_TYPE_AAAA && rdata_len == 16)))
+    {
+      addr_set_add(&addrs, type == DNS_TYPE_A ? ADDR_V4 : ADDR_V6, &packet[offset]);
+      if(ttl_s < min_ttl_s) min_ttl_s = ttl_s;
+    }
+    offset += rdata_len;
+  }
+
+  if(addrs.count == 0)
+  {
+    return dns_finish(ptr_engine, ptr_query, -1, NULL, 0, callback, ptr_user);
+  }
+  return dns_finish(ptr_engine, ptr_query, 0, &addrs, (int)min_ttl_s, callback, ptr_user);
+}
+
+/**
+ * @brief Resend or fail every query whose deadline has passed
+ */
+static int dns_expire(dns_engine_t * ptr_engine, dns_callback_t callback, void * ptr_user)
+{
+  long long now = now_ms();
+  dns_query_t * ptr_query;
+  int num_done = 0;
+
+  while( (ptr_query = ptr_engine->ptr_oldest) != NULL && ptr_query->deadline_ms <= now )
+  {
+    if(ptr_query->tries > ptr_engine->retries)
+    {
+      num_done += dns_finish(ptr_engine, ptr_query, -1, NULL, 0, callback, ptr_user);
+    }
+    else
+    {
+      dns_list_remove(ptr_engine, ptr_query);
+      dns_send(ptr_engine, ptr_query);
+    }
+  }
+
+  return num_done;
+}
+
+int dns_engine_poll(dns_engine_t * ptr_engine, int wait_ms, dns_callback_t callback, void * ptr_user)
+{
+  unsigned char packet[DNS_MAX_PACKET_LEN];
+  struct epoll_event event;
+  int num_done;
+  int timeout;
+  ssize_t len;
+
+  num_done = dns_expire(ptr_engine, callback, ptr_user);
+
+  // sleep until an answer arrives or the oldest query expires
+  timeout = wait_ms;
+  if(ptr_engine->ptr_oldest != NULL)
+  {
+    long long until = ptr_engine->ptr_oldest->deadline_ms - now_ms();
+    if(until < 0) until = 0;
+    if(timeout < 0 || until < timeout) timeout = until;
+  }
+  if(num_done > 0) timeout = 0;
+
+  if( epoll_wait(ptr_engine->epoll_fd, &event, 1, timeout) < 0 && errno != EINTR )
+  {
+    return -1;
+  }
+
+  // drain every datagram waiting on the socket
+  while( (len = recv(ptr_engine->sock_fd, packet, sizeof(packet), 0)) >= 0 || errno == ECONNREFUSED )
+  {
+    if(len >= 0) num_done += dns_handle_answer(ptr_engine, packet, len, callback, ptr_user);
+  }
+
+  num_done += dns_expire(ptr_engine, callback, ptr_user);
+
+  return num_done;
+}
@@ -0,0 +1,171 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file dns.h
+ * @brief Non-blocking DNS client
+ *
+ * Definitions and declarations for an event-driven DNS engine. Queries
+ * are sent over one non-blocking UDP socket and answers are collected
+ * with epoll, so a single thread can keep many lookups in flight instead
+ * of blocking in getaddrinfo for each one. Unanswered queries are resent
+ * after a timeout and fail once their retries run out. When IPv6 is
+ * wanted, every hostname is sent as an A and an AAAA query, and the two
+ * answers are merged, IPv4 first, before the hostname is reported.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __DNS_H__
+#define __DNS_H__
+
+#include <stdint.h>
+#include <sys/socket.h>
+#include "addr.h"
+
+#define DNS_PORT (53)
+#define DNS_MAX_NAME_LEN (255)
+#define DNS_MAX_PACKET_LEN (1500)
+#define DNS_MAX_INFLIGHT (65536)
+#define DNS_RESOLV_CONF ("/etc/resolv.conf")
+
+#define DNS_DEFAULT_INFLIGHT (512)
+#define DNS_DEFAULT_TIMEOUT_MS (2000)
+#define DNS_DEFAULT_RETRIES (2)
+
+// transaction IDs drawn from the kernel at once, so few queries pay for a system call
+#define DNS_RANDOM_BATCH (256)
+
+/**
+ * @brief Called once for each finished query
+ *
+ * @param ptr_user The pointer given to dns_engine_poll()
+ * @param ctx The context pointer given when the query was submitted
+ * @param status 0 if an address was found, -1 otherwise
+ * @param ptr_addrs Every address in the answer, only valid during the call
+ * @param ttl_s The shortest time to live of the address records in seconds
+ *
+ * The engine's last_elapsed_ns holds how long the query took, from its
+ * submission to now, for the duration of the call.
+ */
+typedef void (* dns_callback_t)(void * ptr_user, void * ctx, int status, const addr_set_t * ptr_addrs, int ttl_s);
+
+typedef struct dns_query
+{
+  char name[DNS_MAX_NAME_LEN + 1];
+  int name_len;
+  void * ctx;
+  int tries;
+  int type;
+  uint16_t id;
+  long long start_ns;
+  long long deadline_ms;
+  struct dns_query * next;
+  struct dns_query * prev;
+  struct dns_query * id_next;
+  struct dns_query * ptr_pair;
+  int merge_f;
+  int merge_status;
+  int merge_ttl_s;
+  addr_set_t merge_addrs;
+} dns_query_t;
+
+typedef struct
+{
+  int sock_fd;
+  int epoll_fd;
+  int timeout_ms;
+  int retries;
+  int max_inflight;
+  int num_inflight;
+  int ipv6_f;
+  dns_query_t * queries;
+  dns_query_t * ptr_free;
+  dns_query_t * ptr_oldest;
+  dns_query_t * ptr_newest;
+  dns_query_t ** id_buckets;
+  int id_mask;
+  uint16_t random_ids[DNS_RANDOM_BATCH];
+  int num_random_ids;
+  long long last_elapsed_ns;
+} dns_engine_t;
+
+/**
+ * @brief Parse a DNS server address
+ *
+ * Accepts "a.b.c.d", "a.b.c.d:port", "x::y" or "[x::y]:port". A NULL
+ * string selects the first nameserver in /etc/resolv.conf.
+ *
+ * @param str The address string, or NULL
+ * @param ptr_addr A pointer to where the address is stored
+ * @param ptr_addr_len A pointer to where the address length is stored
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int dns_server_parse(const char * str, struct sockaddr_storage * ptr_addr, socklen_t * ptr_addr_len);
+
+/**
+ * @brief Create a DNS engine
+ *
+ * @param ptr_engine A pointer to the uninitialized engine pointer
+ * @param ptr_server The address of the DNS server to query
+ * @param server_len The length of the server address
+ * @param max_inflight The most hostnames outstanding at once
+ * @param timeout_ms How long to wait for an answer before resending
+ * @param retries How many times a query is resent before it fails
+ * @param ipv6_f 1 to also ask for the IPv6 addresses of every hostname,
+ *               which takes two query slots per hostname
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int dns_engine_init(dns_engine_t ** ptr_engine, const struct sockaddr * ptr_server, socklen_t server_len,
+                    int max_inflight, int timeout_ms, int retries, int ipv6_f);
+
+/**
+ * @brief Free a DNS engine from the heap
+ *
+ * Queries still in flight are dropped without calling back.
+ *
+ * @param ptr_engine A pointer to the engine
+ */
+void dns_engine_free(dns_engine_t * ptr_engine);
+
+/**
+ * @brief Send a query for the IPv4 address of a hostname, and its IPv6
+ *        address if the engine asks for both
+ *
+ * @param ptr_engine A pointer to the engine
+ * @param hostname The hostname to resolve
+ * @param ctx A pointer handed back to the callback
+ *
+ * @return 0 if the query was sent, -1 if the engine is full or the name
+ *         cannot be encoded
+ */
+int dns_engine_submit(dns_engine_t * ptr_engine, const char * hostname, void * ctx);
+
+/**
+ * @brief Wait for answers and expire timed out queries
+ *
+ * Calls the callback for every query that finishes. Returns early once
+ * at least one query has finished.
+ *
+ * @param ptr_engine A pointer to the engine
+ * @param wait_ms The longest time to wait for an answer, -1 for no limit
+ * @param callback The function called for every finished query
+ * @param ptr_user A pointer handed to every callback
+ *
+ * @return The number of queries that finished, -1 on error
+ */
+int dns_engine_poll(dns_engine_t * ptr_engine, int wait_ms, dns_callback_t callback, void * ptr_user);
+
+#endif /* __DNS_H__ */
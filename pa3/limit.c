@@ -0,0 +1,208 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file limit.c
+ * @brief Adaptive limit on the lookups outstanding at once
+ *
+ * Implementations for the lookup limit. Every change happens under its
+ * mutex, which is taken once to start and once to finish each lookup.
+ * The limit only grows while at least half of it was in use during the
+ * window, so a limit the resolvers never reach does not drift up to its
+ * maximum and let a sudden burst through all at once.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#include <stdlib.h>
+#include "limit.h"
+
+int limit_init(limit_t ** ptr_limit, int max, int adaptive_f)
+{
+  limit_t * ptr_l;
+
+  if( (ptr_l = (limit_t *)malloc(sizeof(limit_t))) == NULL )
+  {
+    return -1;
+  }
+
+  lockprof_mutex_init(&ptr_l->mutex, "limit");
+  pthread_cond_init(&ptr_l->cond, NULL);
+  ptr_l->adaptive_f = adaptive_f;
+  ptr_l->slow_start_f = 1;
+  ptr_l->min = 1;
+  ptr_l->max = max;
+  ptr_l->limit = adaptive_f && LIMIT_INITIAL < max ? LIMIT_INITIAL : max;
+  ptr_l->inflight = 0;
+  ptr_l->waiters = 0;
+  ptr_l->base_ns = 0.0;
+  ptr_l->base_fail_rate = -1.0;
+  ptr_l->window_sum_ns = 0;
+  ptr_l->window_count = 0;
+  ptr_l->window_fails = 0;
+  ptr_l->window_used = 0;
+  ptr_l->peak = (int)ptr_l->limit;
+  ptr_l->decreases = 0;
+  ptr_l->waits = 0;
+
+  *ptr_limit = ptr_l;
+  return 0;
+}
+
+void limit_free(limit_t * ptr_limit)
+{
+  lockprof_mutex_destroy(&ptr_limit->mutex);
+  pthread_cond_destroy(&ptr_limit->cond);
+  free((void *)ptr_limit);
+}
+
+void limit_acquire(limit_t * ptr_limit)
+{
+  lockprof_lock(&ptr_limit->mutex);
+  if(ptr_limit->inflight >= (int)ptr_limit->limit)
+  {
+    ptr_limit->waits++;
+    ptr_limit->waiters++;
+    while(ptr_limit->inflight >= (int)ptr_limit->limit)
+    {
+      lockprof_cond_wait(&ptr_limit->cond, &ptr_limit->mutex);
+    }
+    ptr_limit->waiters--;
+  }
+  ptr_limit->inflight++;
+  lockprof_unlock(&ptr_limit->mutex);
+}
+
+int limit_try_acquire(limit_t * ptr_limit)
+{
+  int ret = -1;
+
+  lockprof_lock(&ptr_limit->mutex);
+  if(ptr_limit->inflight < (int)ptr_limit->limit)
+  {
+    ptr_limit->inflight++;
+    ret = 0;
+  }
+  lockprof_unlock(&ptr_limit->mutex);
+
+  return ret;
+}
+
+/**
+ * @brief Count one finished lookup, and at the end of a window move the
+ *        baselines and the limit
+ *
+ * Must be called with the limit's mutex held.
+ */
+static void limit_update(limit_t * ptr_limit, long long latency_ns, int failed_f, int used)
+{
+  double mean_ns, rate;
+  int congested_f;
+
+  ptr_limit->window_sum_ns += latency_ns;
+  ptr_limit->window_fails += failed_f;
+  if(used > ptr_limit->window_used)
+  {
+    ptr_limit->window_used = used;
+  }
+  if(++ptr_limit->window_count < LIMIT_WINDOW || ptr_limit->window_count < (int)ptr_limit->limit)
+  {
+    return;
+  }
+
+  mean_ns = (double)ptr_limit->window_sum_ns / ptr_limit->window_count;
+  rate = (double)ptr_limit->window_fails / ptr_limit->window_count;
+  if(ptr_limit->base_fail_rate < 0.0)
+  {
+    ptr_limit->base_ns = mean_ns;
+    ptr_limit->base_fail_rate = rate;
+  }
+  congested_f = (mean_ns > LIMIT_SLOW_NS && mean_ns > ptr_limit->base_ns * LIMIT_TOLERANCE) ||
+    rate > ptr_limit->base_fail_rate + LIMIT_ERROR_RISE;
+
+  // follow an upstream that got slower or fails more names, slowly enough
+  // that an overload still stands out against the average before it
+  ptr_limit->base_ns += (mean_ns - ptr_limit->base_ns) / LIMIT_DRIFT;
+  ptr_limit->base_fail_rate += (rate - ptr_limit->base_fail_rate) / LIMIT_DRIFT;
+
+  if(congested_f)
+  {
+    ptr_limit->limit *= LIMIT_BACKOFF;
+    if(ptr_limit->limit < ptr_limit->min)
+    {
+      ptr_limit->limit = ptr_limit->min;
+    }
+    ptr_limit->slow_start_f = 0;
+    ptr_limit->decreases++;
+  }
+  else if(ptr_limit->slow_start_f && mean_ns > LIMIT_SLOW_NS && mean_ns > ptr_limit->base_ns * LIMIT_SLOW_START_TOLERANCE)
+  {
+    // the upstream has started to queue, so stop doubling before it drops queries
+    ptr_limit->slow_start_f = 0;
+  }
+  else if(ptr_limit->window_used * 2 >= (int)ptr_limit->limit)
+  {
+    // one more per round trip, or double every round trip until the upstream slows
+    ptr_limit->limit += ptr_limit->slow_start_f ? ptr_limit->limit : (double)ptr_limit->window_count / ptr_limit->limit;
+    if(ptr_limit->limit > ptr_limit->max)
+    {
+      ptr_limit->limit = ptr_limit->max;
+    }
+    if((int)ptr_limit->limit > ptr_limit->peak)
+    {
+      ptr_limit->peak = (int)ptr_limit->limit;
+    }
+  }
+
+  ptr_limit->window_sum_ns = 0;
+  ptr_limit->window_count = 0;
+  ptr_limit->window_fails = 0;
+  ptr_limit->window_used = 0;
+}
+
+void limit_release(limit_t * ptr_limit, long long latency_ns, int failed_f)
+{
+  int old_limit;
+
+  lockprof_lock(&ptr_limit->mutex);
+  old_limit = (int)ptr_limit->limit;
+  if(ptr_limit->adaptive_f)
+  {
+    limit_update(ptr_limit, latency_ns, failed_f != 0, ptr_limit->inflight);
+  }
+  ptr_limit->inflight--;
+  if(ptr_limit->waiters > 0)
+  {
+    // a grown limit may have room for more than the one slot given back
+    if((int)ptr_limit->limit > old_limit)
+    {
+      pthread_cond_broadcast(&ptr_limit->cond);
+    }
+    else
+    {
+      pthread_cond_signal(&ptr_limit->cond);
+    }
+  }
+  lockprof_unlock(&ptr_limit->mutex);
+}
+
+void limit_cancel(limit_t * ptr_limit)
+{
+  lockprof_lock(&ptr_limit->mutex);
+  ptr_limit->inflight--;
+  if(ptr_limit->waiters > 0)
+  {
+    pthread_cond_signal(&ptr_limit->cond);
+  }
+  lockprof_unlock(&ptr_limit->mutex);
+}
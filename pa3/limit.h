@@ -0,0 +1,127 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file limit.h
+ * @brief Adaptive limit on the lookups outstanding at once
+ *
+ * Definitions and declarations for a limit shared by every resolver
+ * thread on how many lookups may be waiting on the upstream resolver at
+ * the same time. A fixed limit never changes. An adaptive limit is moved
+ * by AIMD once every window of about a round trip of lookups: it grows by
+ * one while they stay as fast as usual, and is halved when their mean
+ * latency rises well above its long-run average or more of them fail than
+ * usually do. This keeps the outstanding lookups near the point where the
+ * upstream stops answering faster, without having to pick a thread count
+ * by hand.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __LIMIT_H__
+#define __LIMIT_H__
+
+#include <pthread.h>
+#include "lockprof.h"
+
+#define LIMIT_INITIAL (8)
+// fewest completions in a window, which is otherwise as long as the limit
+#define LIMIT_WINDOW (16)
+// a window this much slower than the baseline means the upstream is queueing
+#define LIMIT_TOLERANCE (2.0)
+// doubling the limit stops once a window is this much slower than the baseline
+#define LIMIT_SLOW_START_TOLERANCE (1.25)
+// windows faster than this never count as slow, however fast the baseline
+#define LIMIT_SLOW_NS (1000000)
+// a window failing this much more often than the baseline means queries are dropped
+#define LIMIT_ERROR_RISE (0.05)
+#define LIMIT_BACKOFF (0.5)
+// baselines move by this fraction of the difference every window
+#define LIMIT_DRIFT (8)
+
+typedef struct
+{
+  lockprof_mutex_t mutex;
+  pthread_cond_t cond;
+  int adaptive_f;
+  int slow_start_f;
+  double limit;
+  int min;
+  int max;
+  int inflight;
+  int waiters;
+  double base_ns;
+  double base_fail_rate;
+  long long window_sum_ns;
+  int window_count;
+  int window_fails;
+  int window_used;
+  int peak;
+  unsigned long decreases;
+  unsigned long waits;
+} limit_t;
+
+/**
+ * @brief Create a limit
+ *
+ * An adaptive limit starts at LIMIT_INITIAL and doubles every round trip
+ * until lookups first slow down.
+ *
+ * @param ptr_limit A pointer to the uninitialized limit pointer
+ * @param max The fixed limit, or the most an adaptive limit may grow to
+ * @param adaptive_f Whether the limit adapts to the upstream
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int limit_init(limit_t ** ptr_limit, int max, int adaptive_f);
+
+/**
+ * @brief Free a limit from the heap
+ *
+ * @param ptr_limit A pointer to the limit
+ */
+void limit_free(limit_t * ptr_limit);
+
+/**
+ * @brief Take a lookup slot, sleeping until one is free
+ *
+ * @param ptr_limit A pointer to the limit
+ */
+void limit_acquire(limit_t * ptr_limit);
+
+/**
+ * @brief Take a lookup slot if one is free
+ *
+ * @param ptr_limit A pointer to the limit
+ *
+ * @return 0 if a slot was taken, -1 otherwise
+ */
+int limit_try_acquire(limit_t * ptr_limit);
+
+/**
+ * @brief Give back the slot of a finished lookup and adapt the limit
+ *
+ * @param ptr_limit A pointer to the limit
+ * @param latency_ns How long the lookup took
+ * @param failed_f Whether the lookup failed
+ */
+void limit_release(limit_t * ptr_limit, long long latency_ns, int failed_f);
+
+/**
+ * @brief Give back a slot that was not used for a lookup
+ *
+ * @param ptr_limit A pointer to the limit
+ */
+void limit_cancel(limit_t * ptr_limit);
+
+#endif /* __LIMIT_H__ */
@@ -0,0 +1,141 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file lockprof.c
+ * @brief Mutexes that can profile their own contention
+ *
+ * Implementations for the named lock registry and the report. Names are
+ * looked up only when a mutex is created, so locking never searches the
+ * registry.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "lockprof.h"
+
+atomic_int lockprof_enabled_f = 0;
+
+static pthread_mutex_t classes_mutex = PTHREAD_MUTEX_INITIALIZER;
+static lockprof_class_t * classes = NULL;
+// counts locks whose counters could not be allocated
+static lockprof_class_t other_class = {.name = "other"};
+
+void lockprof_enable(void)
+{
+  atomic_store(&lockprof_enabled_f, 1);
+}
+
+void lockprof_mutex_init(lockprof_mutex_t * ptr_mutex, const char * name)
+{
+  lockprof_class_t * ptr_class;
+
+  pthread_mutex_init(&ptr_mutex->mutex, NULL);
+  ptr_mutex->acquired_ns = 0;
+
+  pthread_mutex_lock(&classes_mutex);
+  for(ptr_class = classes; ptr_class != NULL && strcmp(ptr_class->name, name) != 0; ptr_class = ptr_class->next);
+  if( ptr_class == NULL && (ptr_class = (lockprof_class_t *)calloc(1, sizeof(lockprof_class_t))) != NULL )
+  {
+    ptr_class->name = name;
+    ptr_class->next = classes;
+    classes = ptr_class;
+  }
+  pthread_mutex_unlock(&classes_mutex);
+
+  ptr_mutex->ptr_class = ptr_class != NULL ? ptr_class : &other_class;
+}
+
+void lockprof_mutex_destroy(lockprof_mutex_t * ptr_mutex)
+{
+  pthread_mutex_destroy(&ptr_mutex->mutex);
+}
+
+/**
+ * @brief Order lock counters by total wait, then by total hold, longest first
+ */
+static int lockprof_compare(const void * ptr_a, const void * ptr_b)
+{
+  lockprof_class_t * ptr_class_a = *(lockprof_class_t * const *)ptr_a;
+  lockprof_class_t * ptr_class_b = *(lockprof_class_t * const *)ptr_b;
+  unsigned long long a = atomic_load(&ptr_class_a->wait_ns);
+  unsigned long long b = atomic_load(&ptr_class_b->wait_ns);
+
+  if(a == b)
+  {
+    a = atomic_load(&ptr_class_a->hold_ns);
+    b = atomic_load(&ptr_class_b->hold_ns);
+  }
+  return (a < b) - (a > b);
+}
+
+void lockprof_report(FILE * ptr_file)
+{
+  lockprof_class_t ** sorted;
+  lockprof_class_t * ptr_class;
+  unsigned long acquisitions;
+  unsigned long contended;
+  size_t num_classes = 1;
+
+  pthread_mutex_lock(&classes_mutex);
+  for(ptr_class = classes; ptr_class != NULL; ptr_class = ptr_class->next)
+  {
+    num_classes++;
+  }
+  if( (sorted = (lockprof_class_t **)malloc(sizeof(lockprof_class_t *) * num_classes)) == NULL )
+  {
+    pthread_mutex_unlock(&classes_mutex);
+    return;
+  }
+  num_classes = 0;
+  for(ptr_class = classes; ptr_class != NULL; ptr_class = ptr_class->next)
+  {
+    sorted[num_classes++] = ptr_class;
+  }
+  if(atomic_load(&other_class.acquisitions) > 0)
+  {
+    sorted[num_classes++] = &other_class;
+  }
+  pthread_mutex_unlock(&classes_mutex);
+  qsort(sorted, num_classes, sizeof(lockprof_class_t *), lockprof_compare);
+
+  fprintf(ptr_file, "Locks:\n  %-16s %12s %12s %9s %12s %12s %12s\n", "name", "acquired", "contended", "rate",
+          "wait ms", "hold ms", "max wait us");
+  for(size_t i = 0; i < num_classes; i++)
+  {
+    ptr_class = sorted[i];
+    acquisitions = atomic_load(&ptr_class->acquisitions);
+    contended = atomic_load(&ptr_class->contended);
+    fprintf(ptr_file, "  %-16s %12lu %12lu %8.2f%% %12.3f %12.3f %12.1f\n", ptr_class->name, acquisitions, contended,
+            acquisitions > 0 ? 100.0 * contended / acquisitions : 0.0,
+            atomic_load(&ptr_class->wait_ns) / 1e6, atomic_load(&ptr_class->hold_ns) / 1e6,
+            atomic_load(&ptr_class->max_wait_ns) / 1e3);
+  }
+  free(sorted);
+}
+
+void lockprof_free(void)
+{
+  lockprof_class_t * ptr_next;
+
+  pthread_mutex_lock(&classes_mutex);
+  while(classes != NULL)
+  {
+    ptr_next = classes->next;
+    free(classes);
+    classes = ptr_next;
+  }
+  pthread_mutex_unlock(&classes_mutex);
+}
@@ -0,0 +1,181 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file lockprof.h
+ * @brief Mutexes that can profile their own contention
+ *
+ * Definitions and declarations for a thin layer over pthread mutexes.
+ * Every mutex is given a name when it is created, and mutexes with the
+ * same name, such as the shards of the cache, share one set of counters.
+ * Once profiling is enabled each lock records whether it had to wait,
+ * for how long, and how long it was then held. Without profiling a lock
+ * costs one extra load and branch.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __LOCKPROF_H__
+#define __LOCKPROF_H__
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "timing.h"
+
+typedef struct lockprof_class
+{
+  const char * name;
+  atomic_ulong acquisitions;
+  atomic_ulong contended;
+  atomic_ullong wait_ns;
+  atomic_ullong hold_ns;
+  atomic_ullong max_wait_ns;
+  struct lockprof_class * next;
+} lockprof_class_t;
+
+typedef struct
+{
+  pthread_mutex_t mutex;
+  lockprof_class_t * ptr_class;
+  long long acquired_ns;
+} lockprof_mutex_t;
+
+extern atomic_int lockprof_enabled_f;
+
+/**
+ * @brief Start profiling every lock
+ *
+ * Must be called before any lock is shared between threads.
+ */
+void lockprof_enable(void);
+
+/**
+ * @brief Create a mutex
+ *
+ * @param ptr_mutex A pointer to the uninitialized mutex
+ * @param name The name it is reported under, which must outlive the
+ *             program's use of the profiler
+ */
+void lockprof_mutex_init(lockprof_mutex_t * ptr_mutex, const char * name);
+
+/**
+ * @brief Destroy a mutex, keeping its counters for the report
+ *
+ * @param ptr_mutex A pointer to the mutex
+ */
+void lockprof_mutex_destroy(lockprof_mutex_t * ptr_mutex);
+
+/**
+ * @brief Print every named lock, most waited on first
+ *
+ * @param ptr_file Where the report is printed
+ */
+void lockprof_report(FILE * ptr_file);
+
+/**
+ * @brief Free the counters of every named lock
+ *
+ * No mutex may be used afterwards.
+ */
+void lockprof_free(void);
+
+/**
+ * @brief Lock a mutex, counting the wait when it is already held
+ */
+static inline void lockprof_lock(lockprof_mutex_t * ptr_mutex)
+{
+  lockprof_class_t * ptr_class = ptr_mutex->ptr_class;
+  unsigned long long max;
+  long long start_ns;
+  long long wait_ns;
+
+  if(!atomic_load_explicit(&lockprof_enabled_f, memory_order_relaxed))
+  {
+    pthread_mutex_lock(&ptr_mutex->mutex);
+    return;
+  }
+
+  // only a lock that is already held counts as contended
+  if(pthread_mutex_trylock(&ptr_mutex->mutex) == 0)
+  {
+    ptr_mutex->acquired_ns = now_ns();
+  }
+  else
+  {
+    start_ns = now_ns();
+    pthread_mutex_lock(&ptr_mutex->mutex);
+    ptr_mutex->acquired_ns = now_ns();
+    wait_ns = ptr_mutex->acquired_ns - start_ns;
+    atomic_fetch_add_explicit(&ptr_class->contended, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&ptr_class->wait_ns, wait_ns, memory_order_relaxed);
+    max = atomic_load_explicit(&ptr_class->max_wait_ns, memory_order_relaxed);
+    while( (unsigned long long)wait_ns > max &&
+           !atomic_compare_exchange_weak_explicit(&ptr_class->max_wait_ns, &max, wait_ns,
+                                                  memory_order_relaxed, memory_order_relaxed) );
+  }
+  atomic_fetch_add_explicit(&ptr_class->acquisitions, 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Unlock a mutex, counting how long it was held
+ */
+static inline void lockprof_unlock(lockprof_mutex_t * ptr_mutex)
+{
+  if(atomic_load_explicit(&lockprof_enabled_f, memory_order_relaxed))
+  {
+    atomic_fetch_add_explicit(&ptr_mutex->ptr_class->hold_ns, now_ns() - ptr_mutex->acquired_ns, memory_order_relaxed);
+  }
+  pthread_mutex_unlock(&ptr_mutex->mutex);
+}
+
+/**
+ * @brief Wait on a condition variable
+ *
+ * The time asleep counts as neither holding nor waiting for the lock.
+ */
+static inline int lockprof_cond_wait(pthread_cond_t * ptr_cond, lockprof_mutex_t * ptr_mutex)
+{
+  int ret;
+
+  if(!atomic_load_explicit(&lockprof_enabled_f, memory_order_relaxed))
+  {
+    return pthread_cond_wait(ptr_cond, &ptr_mutex->mutex);
+  }
+  atomic_fetch_add_explicit(&ptr_mutex->ptr_class->hold_ns, now_ns() - ptr_mutex->acquired_ns, memory_order_relaxed);
+  ret = pthread_cond_wait(ptr_cond, &ptr_mutex->mutex);
+  ptr_mutex->acquired_ns = now_ns();
+  return ret;
+}
+
+/**
+ * @brief Wait on a condition variable until a deadline
+ *
+ * The time asleep counts as neither holding nor waiting for the lock.
+ */
+static inline int lockprof_cond_timedwait(pthread_cond_t * ptr_cond, lockprof_mutex_t * ptr_mutex,
+                                          const struct timespec * ptr_deadline)
+{
+  int ret;
+
+  if(!atomic_load_explicit(&lockprof_enabled_f, memory_order_relaxed))
+  {
+    return pthread_cond_timedwait(ptr_cond, &ptr_mutex->mutex, ptr_deadline);
+  }
+  atomic_fetch_add_explicit(&ptr_mutex->ptr_class->hold_ns, now_ns() - ptr_mutex->acquired_ns, memory_order_relaxed);
+  ret = pthread_cond_timedwait(ptr_cond, &ptr_mutex->mutex, ptr_deadline);
+  ptr_mutex->acquired_ns = now_ns();
+  return ret;
+}
+
+#endif /* __LOCKPROF_H__ */
@@ -0,0 +1,151 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file logbuf.c
+ * @brief Per-thread buffered writer for a shared log file
+ *
+ * Implementations for the buffered log writer. A line too long for the
+ * buffer is written on its own, still in one locked write.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "logbuf.h"
+#include "timing.h"
+
+int logbuf_init(logbuf_t * ptr_log, int fd, lockprof_mutex_t * ptr_mutex, size_t size)
+{
+  if( (ptr_log->buf = (char *)malloc(size)) == NULL )
+  {
+    return -1;
+  }
+  ptr_log->fd = fd;
+  ptr_log->ptr_mutex = ptr_mutex;
+  ptr_log->len = 0;
+  ptr_log->size = size;
+  ptr_log->ptr_metrics = NULL;
+
+  return 0;
+}
+
+void logbuf_free(logbuf_t * ptr_log)
+{
+  logbuf_flush(ptr_log);
+  free((void *)ptr_log->buf);
+}
+
+/**
+ * @brief Write a whole buffer to a file descriptor under its lock
+ */
+static int logbuf_write(logbuf_t * ptr_log, const char * buf, size_t len)
+{
+  ssize_t written;
+  int ret = 0;
+  long long start_ns = 0;
+  long long locked_ns = 0;
+
+  if(ptr_log->ptr_metrics != NULL)
+  {
+    start_ns = now_ns();
+  }
+  lockprof_lock(ptr_log->ptr_mutex);
+  if(ptr_log->ptr_metrics != NULL)
+  {
+    locked_ns = now_ns();
+    metrics_add(&ptr_log->ptr_metrics->lock_wait_ns, locked_ns - start_ns);
+  }
+  while(len > 0)
+  {
+    if( (written = write(ptr_log->fd, buf, len)) < 0 )
+    {
+      if(errno == EINTR) continue;
+      ret = -1;
+      break;
+    }
+    buf += written;
+    len -= written;
+  }
+  lockprof_unlock(ptr_log->ptr_mutex);
+  if(ptr_log->ptr_metrics != NULL)
+  {
+    metrics_record(ptr_log->ptr_metrics, METRICS_LOG_WRITE, now_ns() - locked_ns);
+  }
+
+  return ret;
+}
+
+int logbuf_flush(logbuf_t * ptr_log)
+{
+  int ret;
+
+  if(ptr_log->len == 0)
+  {
+    return 0;
+  }
+  ret = logbuf_write(ptr_log, ptr_log->buf, ptr_log->len);
+  ptr_log->len = 0;
+
+  return ret;
+}
+
+int logbuf_line(logbuf_t * ptr_log, const char * const * pieces, int num_pieces)
+{
+  size_t lens[num_pieces];
+  size_t line_len = 1;
+  char * line;
+  int ret;
+
+  for(int i = 0; i < num_pieces; i++)
+  {
+    lens[i] = strlen(pieces[i]);
+    line_len += lens[i];
+  }
+
+  if(ptr_log->len + line_len > ptr_log->size && logbuf_flush(ptr_log) != 0)
+  {
+    return -1;
+  }
+
+  // a line larger than the whole buffer goes out by itself
+  if(line_len > ptr_log->size)
+  {
+    if( (line = (char *)malloc(line_len)) == NULL )
+    {
+      return -1;
+    }
+    line_len = 0;
+    for(int i = 0; i < num_pieces; i++)
+    {
+      memcpy(line + line_len, pieces[i], lens[i]);
+      line_len += lens[i];
+    }
+    line[line_len++] = '\n';
+    ret = logbuf_write(ptr_log, line, line_len);
+    free((void *)line);
+    return ret;
+  }
+
+  for(int i = 0; i < num_pieces; i++)
+  {
+    memcpy(ptr_log->buf + ptr_log->len, pieces[i], lens[i]);
+    ptr_log->len += lens[i];
+  }
+  ptr_log->buf[ptr_log->len++] = '\n';
+
+  return 0;
+}
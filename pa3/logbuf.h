@@ -0,0 +1,89 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file logbuf.h
+ * @brief Per-thread buffered writer for a shared log file
+ *
+ * Definitions and declarations for a buffer that one thread fills with
+ * complete lines and flushes to a shared file descriptor with a single
+ * write() per batch. The file's lock is only held for that write, and
+ * since only whole lines are ever buffered, lines from different threads
+ * never interleave.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __LOGBUF_H__
+#define __LOGBUF_H__
+
+#include <stddef.h>
+#include <pthread.h>
+#include "lockprof.h"
+#include "metrics.h"
+
+#define LOGBUF_DEFAULT_SIZE (64 * 1024)
+
+typedef struct
+{
+  int fd;
+  lockprof_mutex_t * ptr_mutex;
+  char * buf;
+  size_t len;
+  size_t size;
+  metrics_thread_t * ptr_metrics;
+} logbuf_t;
+
+/**
+ * @brief Create a log buffer
+ *
+ * @param ptr_log A pointer to the log buffer
+ * @param fd The file descriptor of the shared log
+ * @param ptr_mutex The mutex guarding writes to the shared log
+ * @param size The size of the buffer in bytes
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int logbuf_init(logbuf_t * ptr_log, int fd, lockprof_mutex_t * ptr_mutex, size_t size);
+
+/**
+ * @brief Flush and free a log buffer
+ *
+ * @param ptr_log A pointer to the log buffer
+ */
+void logbuf_free(logbuf_t * ptr_log);
+
+/**
+ * @brief Write everything buffered to the shared log
+ *
+ * @param ptr_log A pointer to the log buffer
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int logbuf_flush(logbuf_t * ptr_log);
+
+/**
+ * @brief Add one line to the buffer, built from pieces
+ *
+ * The pieces are joined with no separator and a newline is added. The
+ * buffer is flushed first if the line does not fit.
+ *
+ * @param ptr_log A pointer to the log buffer
+ * @param pieces The strings making up the line
+ * @param num_pieces The number of strings
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int logbuf_line(logbuf_t * ptr_log, const char * const * pieces, int num_pieces);
+
+#endif /* __LOGBUF_H__ */
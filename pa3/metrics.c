@@ -0,0 +1,587 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file metrics.c
+ * @brief Latency histograms and per-thread pipeline counters
+ *
+ * Implementations for writing the metrics. Each dump is one JSON object
+ * on its own line, so periodic dumps append to the file as a series that
+ * ends with the object marked final. Percentiles are the highest value
+ * of the bucket they fall in, capped by the largest value recorded.
+ * Scrapes are answered one at a time by a server thread that only reads
+ * the slots, so a slow or frequent scraper never holds up the pipeline.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "metrics.h"
+#include "timing.h"
+
+static const char * hist_names[METRICS_NUM_HISTS] = {"queue_residency_ns", "lookup_ns", "log_write_ns"};
+static const double percentiles[] = {50.0, 90.0, 99.0, 99.9};
+static const char * percentile_names[] = {"p50", "p90", "p99", "p999"};
+static const char * prometheus_quantiles[] = {"0.5", "0.9", "0.99", "0.999"};
+static const char * prometheus_hist_names[METRICS_NUM_HISTS] =
+{
+  "multilookup_queue_residency_seconds", "multilookup_lookup_seconds", "multilookup_log_write_seconds"
+};
+static const char * prometheus_hist_help[METRICS_NUM_HISTS] =
+{
+  "Time hostnames waited in the queue.",
+  "Time taken by lookups through the backend or the asynchronous engine.",
+  "Time taken by writes to the resolver log."
+};
+
+/**
+ * @brief Lowest value held by a histogram bucket
+ */
+static unsigned long long metrics_bucket_low(int idx)
+{
+  int group = idx / METRICS_SUB_COUNT;
+
+  if(group == 0)
+  {
+    return idx;
+  }
+  return (unsigned long long)(METRICS_SUB_COUNT + idx % METRICS_SUB_COUNT) << (group - 1);
+}
+
+/**
+ * @brief Highest value held by a histogram bucket
+ */
+static unsigned long long metrics_bucket_high(int idx)
+{
+  int group = idx / METRICS_SUB_COUNT;
+
+  if(group == 0)
+  {
+    return idx;
+  }
+  return metrics_bucket_low(idx) + (1ULL << (group - 1)) - 1;
+}
+
+int metrics_init(metrics_t ** ptr_metrics, const char * file_name, int interval_s, int num_requesters, int num_resolvers)
+{
+  metrics_t * ptr_m;
+  pthread_condattr_t cond_attr;
+
+  if( (ptr_m = (metrics_t *)malloc(sizeof(metrics_t))) == NULL )
+  {
+    return -1;
+  }
+  // slots are cache line aligned so threads never share one
+  if( (ptr_m->requesters = (metrics_thread_t *)aligned_alloc(CACHE_LINE_SIZE,
+                                                             sizeof(metrics_thread_t) * num_requesters)) == NULL )
+  {
+    free(ptr_m);
+    return -1;
+  }
+  if( (ptr_m->resolvers = (metrics_thread_t *)aligned_alloc(CACHE_LINE_SIZE,
+                                                            sizeof(metrics_thread_t) * num_resolvers)) == NULL )
+  {
+    free(ptr_m->requesters);
+    free(ptr_m);
+    return -1;
+  }
+  ptr_m->ptr_file = NULL;
+  if( file_name != NULL && (ptr_m->ptr_file = fopen(file_name, "w")) == NULL )
+  {
+    free(ptr_m->requesters);
+    free(ptr_m->resolvers);
+    free(ptr_m);
+    return -1;
+  }
+  memset(ptr_m->requesters, 0, sizeof(metrics_thread_t) * num_requesters);
+  memset(ptr_m->resolvers, 0, sizeof(metrics_thread_t) * num_resolvers);
+  ptr_m->num_requesters = num_requesters;
+  ptr_m->num_resolvers = num_resolvers;
+  ptr_m->interval_s = interval_s;
+  ptr_m->start_ns = now_ns();
+  ptr_m->thread_f = 0;
+  ptr_m->stop_f = 0;
+  ptr_m->listen_fd = -1;
+  ptr_m->path = NULL;
+  ptr_m->gauges = NULL;
+  ptr_m->server_f = 0;
+
+  lockprof_mutex_init(&ptr_m->mutex, "metrics");
+  pthread_condattr_init(&cond_attr);
+  pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&ptr_m->cond, &cond_attr);
+  pthread_condattr_destroy(&cond_attr);
+
+  *ptr_metrics = ptr_m;
+  return 0;
+}
+
+void metrics_free(metrics_t * ptr_metrics)
+{
+  if(ptr_metrics->ptr_file != NULL)
+  {
+    fclose(ptr_metrics->ptr_file);
+  }
+  if(ptr_metrics->listen_fd != -1)
+  {
+    close(ptr_metrics->listen_fd);
+    unlink(ptr_metrics->path);
+    free(ptr_metrics->path);
+  }
+  lockprof_mutex_destroy(&ptr_metrics->mutex);
+  pthread_cond_destroy(&ptr_metrics->cond);
+  free(ptr_metrics->requesters);
+  free(ptr_metrics->resolvers);
+  free(ptr_metrics);
+}
+
+/**
+ * @brief Write the metrics every interval until stopped
+ */
+static void * metrics_thread(void * arg)
+{
+  metrics_t * ptr_metrics = (metrics_t *)arg;
+  struct timespec deadline;
+  long long next_ns = now_ns();
+
+  lockprof_lock(&ptr_metrics->mutex);
+  while(!ptr_metrics->stop_f)
+  {
+    next_ns += (long long)ptr_metrics->interval_s * 1000000000;
+    deadline.tv_sec = next_ns / 1000000000;
+    deadline.tv_nsec = next_ns % 1000000000;
+    while( !ptr_metrics->stop_f &&
+           lockprof_cond_timedwait(&ptr_metrics->cond, &ptr_metrics->mutex, &deadline) != ETIMEDOUT );
+    if(!ptr_metrics->stop_f)
+    {
+      metrics_dump(ptr_metrics, 0);
+    }
+  }
+  lockprof_unlock(&ptr_metrics->mutex);
+
+  return NULL;
+}
+
+/**
+ * @brief Send all of a buffer to a scrape client
+ *
+ * @return 0 if successful, -1 if the client stopped reading
+ */
+static int metrics_send(int fd, const char * buf, size_t len)
+{
+  ssize_t num_sent;
+
+  while(len > 0)
+  {
+    if( (num_sent = send(fd, buf, len, MSG_NOSIGNAL)) <= 0 )
+    {
+      return -1;
+    }
+    buf += num_sent;
+    len -= num_sent;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Answer one scrape client with a snapshot
+ */
+static void metrics_serve(metrics_t * ptr_metrics, int fd)
+{
+  struct timeval timeout = {METRICS_CLIENT_MS / 1000, (METRICS_CLIENT_MS % 1000) * 1000};
+  struct pollfd pfd = {fd, POLLIN, 0};
+  char request[4];
+  char header[160];
+  ssize_t num_read = 0;
+  FILE * ptr_body;
+  char * body;
+  size_t body_len;
+  int header_len;
+
+  // a client that sends nothing, such as nc -U, gets the bare text
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  if( poll(&pfd, 1, METRICS_REQUEST_MS) == 1 )
+  {
+    num_read = recv(fd, request, sizeof(request), MSG_WAITALL);
+  }
+
+  if( (ptr_body = open_memstream(&body, &body_len)) == NULL )
+  {
+    return;
+  }
+  metrics_write_prometheus(ptr_metrics, ptr_body);
+  fclose(ptr_body);
+
+  if(num_read == sizeof(request) && memcmp(request, "GET ", sizeof(request)) == 0)
+  {
+    header_len = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                          "Content-Length: %zu\r\nConnection: close\r\n\r\n", body_len);
+    if( metrics_send(fd, header, header_len) != 0 )
+    {
+      free(body);
+      return;
+    }
+  }
+  metrics_send(fd, body, body_len);
+  free(body);
+}
+
+/**
+ * @brief Answer scrape clients one at a time until stopped
+ */
+static void * metrics_server(void * arg)
+{
+  metrics_t * ptr_metrics = (metrics_t *)arg;
+  int fd;
+
+  // stopping shuts the socket down, which fails the accept
+  while( (fd = accept(ptr_metrics->listen_fd, NULL, NULL)) != -1 || errno == EINTR || errno == ECONNABORTED )
+  {
+    if(fd != -1)
+    {
+      metrics_serve(ptr_metrics, fd);
+      close(fd);
+    }
+  }
+
+  return NULL;
+}
+
+int metrics_listen(metrics_t * ptr_metrics, const char * path, metrics_gauges_t gauges, void * ptr_user)
+{
+  struct sockaddr_un addr;
+
+  if(path[0] == '\0' || strlen(path) >= sizeof(addr.sun_path) || (ptr_metrics->path = strdup(path)) == NULL)
+  {
+    return -1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  unlink(path);
+  if( (ptr_metrics->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1 ||
+      bind(ptr_metrics->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+      listen(ptr_metrics->listen_fd, METRICS_BACKLOG) == -1 )
+  {
+    if(ptr_metrics->listen_fd != -1)
+    {
+      close(ptr_metrics->listen_fd);
+      ptr_metrics->listen_fd = -1;
+    }
+    free(ptr_metrics->path);
+    ptr_metrics->path = NULL;
+    return -1;
+  }
+  ptr_metrics->gauges = gauges;
+  ptr_metrics->ptr_gauges_user = ptr_user;
+
+  return 0;
+}
+
+int metrics_start(metrics_t * ptr_metrics)
+{
+  if(ptr_metrics->interval_s > 0 && ptr_metrics->ptr_file != NULL)
+  {
+    if( pthread_create(&ptr_metrics->thread, NULL, metrics_thread, ptr_metrics) != 0 )
+    {
+      return -1;
+    }
+    ptr_metrics->thread_f = 1;
+  }
+  if(ptr_metrics->listen_fd != -1)
+  {
+    if( pthread_create(&ptr_metrics->server, NULL, metrics_server, ptr_metrics) != 0 )
+    {
+      return -1;
+    }
+    ptr_metrics->server_f = 1;
+  }
+  return 0;
+}
+
+void metrics_stop(metrics_t * ptr_metrics)
+{
+  if(ptr_metrics->thread_f)
+  {
+    lockprof_lock(&ptr_metrics->mutex);
+    ptr_metrics->stop_f = 1;
+    pthread_cond_signal(&ptr_metrics->cond);
+    lockprof_unlock(&ptr_metrics->mutex);
+    pthread_join(ptr_metrics->thread, NULL);
+    ptr_metrics->thread_f = 0;
+  }
+  if(ptr_metrics->server_f)
+  {
+    shutdown(ptr_metrics->listen_fd, SHUT_RDWR);
+    pthread_join(ptr_metrics->server, NULL);
+    ptr_metrics->server_f = 0;
+  }
+  metrics_dump(ptr_metrics, 1);
+}
+
+/**
+ * @brief Add one histogram of every slot in a pool to a running total
+ */
+static void metrics_sum(const metrics_thread_t * threads, int num_threads, int hist, unsigned long long * counts,
+                        unsigned long long * ptr_total, unsigned long long * ptr_sum, unsigned long long * ptr_max)
+{
+  const metrics_hist_t * ptr_hist;
+  unsigned long long max;
+
+  for(int i = 0; i < num_threads; i++)
+  {
+    ptr_hist = &threads[i].hists[hist];
+    for(int j = 0; j < METRICS_BUCKETS; j++)
+    {
+      counts[j] += atomic_load_explicit(&ptr_hist->counts[j], memory_order_relaxed);
+    }
+    *ptr_total += atomic_load_explicit(&ptr_hist->total, memory_order_relaxed);
+    *ptr_sum += atomic_load_explicit(&ptr_hist->sum_ns, memory_order_relaxed);
+    if( (max = atomic_load_explicit(&ptr_hist->max_ns, memory_order_relaxed)) > *ptr_max )
+    {
+      *ptr_max = max;
+    }
+  }
+}
+
+/**
+ * @brief Sum one histogram over every thread
+ *
+ * @return The number of values counted
+ */
+static unsigned long long metrics_snapshot(metrics_t * ptr_metrics, int hist, unsigned long long * counts,
+                                           unsigned long long * ptr_sum, unsigned long long * ptr_max)
+{
+  unsigned long long total = 0;
+
+  metrics_sum(ptr_metrics->requesters, ptr_metrics->num_requesters, hist, counts, &total, ptr_sum, ptr_max);
+  metrics_sum(ptr_metrics->resolvers, ptr_metrics->num_resolvers, hist, counts, &total, ptr_sum, ptr_max);
+
+  // threads still recording may have counted a bucket but not the total yet
+  total = 0;
+  for(int idx = 0; idx < METRICS_BUCKETS; idx++)
+  {
+    total += counts[idx];
+  }
+
+  return total;
+}
+
+/**
+ * @brief Value at a percentile of a summed histogram
+ */
+static unsigned long long metrics_percentile(const unsigned long long * counts, unsigned long long total,
+                                             unsigned long long max, double percentile)
+{
+  unsigned long long seen = 0;
+  unsigned long long value = 0;
+
+  for(int idx = 0; total > 0 && idx < METRICS_BUCKETS; idx++)
+  {
+    seen += counts[idx];
+    if(seen * 100.0 >= percentile * total)
+    {
+      value = metrics_bucket_high(idx);
+      break;
+    }
+  }
+
+  return value < max ? value : max;
+}
+
+/**
+ * @brief Write one histogram, summed over every thread, as a JSON object
+ */
+static void metrics_write_hist(metrics_t * ptr_metrics, int hist)
+{
+  FILE * ptr_file = ptr_metrics->ptr_file;
+  unsigned long long counts[METRICS_BUCKETS] = {0};
+  unsigned long long total;
+  unsigned long long sum = 0;
+  unsigned long long max = 0;
+  int first_f = 1;
+  int idx;
+
+  total = metrics_snapshot(ptr_metrics, hist, counts, &sum, &max);
+
+  for(idx = 0; idx < METRICS_BUCKETS && counts[idx] == 0; idx++);
+  fprintf(ptr_file, "\"%s\":{\"count\":%llu,\"min\":%llu,\"mean\":%.1f,", hist_names[hist], total,
+          idx < METRICS_BUCKETS ? metrics_bucket_low(idx) : 0, total > 0 ? (double)sum / total : 0.0);
+  for(size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++)
+  {
+    fprintf(ptr_file, "\"%s\":%llu,", percentile_names[i], metrics_percentile(counts, total, max, percentiles[i]));
+  }
+  fprintf(ptr_file, "\"max\":%llu,\"buckets\":[", max);
+  for(idx = 0; idx < METRICS_BUCKETS; idx++)
+  {
+    if(counts[idx] > 0)
+    {
+      fprintf(ptr_file, "%s[%llu,%llu]", first_f ? "" : ",", metrics_bucket_low(idx), counts[idx]);
+      first_f = 0;
+    }
+  }
+  fprintf(ptr_file, "]}");
+}
+
+/**
+ * @brief Write the counters of every thread in a pool that has run
+ */
+static void metrics_write_threads(metrics_t * ptr_metrics, const char * role, const metrics_thread_t * threads,
+                                  int num_threads, int * ptr_first_f)
+{
+  for(int i = 0; i < num_threads; i++)
+  {
+    if(!atomic_load_explicit(&threads[i].used_f, memory_order_relaxed))
+    {
+      continue;
+    }
+    fprintf(ptr_metrics->ptr_file, "%s{\"role\":\"%s\",\"index\":%d,\"names\":%llu,\"idle_ns\":%llu,\"lock_wait_ns\":%llu}",
+            *ptr_first_f ? "" : ",", role, i,
+            atomic_load_explicit(&threads[i].names, memory_order_relaxed),
+            atomic_load_explicit(&threads[i].idle_ns, memory_order_relaxed),
+            atomic_load_explicit(&threads[i].lock_wait_ns, memory_order_relaxed));
+    *ptr_first_f = 0;
+  }
+}
+
+void metrics_dump(metrics_t * ptr_metrics, int final_f)
+{
+  FILE * ptr_file = ptr_metrics->ptr_file;
+  int first_f = 1;
+
+  if(ptr_file == NULL)
+  {
+    return;
+  }
+
+  fprintf(ptr_file, "{\"final\":%s,\"elapsed_s\":%.3f,\"histograms\":{", final_f ? "true" : "false",
+          (now_ns() - ptr_metrics->start_ns) / 1e9);
+  for(int i = 0; i < METRICS_NUM_HISTS; i++)
+  {
+    if(i > 0)
+    {
+      fputc(',', ptr_file);
+    }
+    metrics_write_hist(ptr_metrics, i);
+  }
+  fprintf(ptr_file, "},\"threads\":[");
+  metrics_write_threads(ptr_metrics, "requester", ptr_metrics->requesters, ptr_metrics->num_requesters, &first_f);
+  metrics_write_threads(ptr_metrics, "resolver", ptr_metrics->resolvers, ptr_metrics->num_resolvers, &first_f);
+  fprintf(ptr_file, "]}\n");
+  fflush(ptr_file);
+}
+
+/**
+ * @brief Write one metric with its help and type lines
+ */
+static void metrics_write_metric(FILE * ptr_out, const char * name, const char * type, const char * help,
+                                 unsigned long long value)
+{
+  fprintf(ptr_out, "# HELP %s %s\n# TYPE %s %s\n%s %llu\n", name, help, name, type, name, value);
+}
+
+void metrics_write_prometheus(metrics_t * ptr_metrics, FILE * ptr_out)
+{
+  unsigned long long counts[METRICS_BUCKETS];
+  unsigned long long total;
+  unsigned long long sum;
+  unsigned long long max;
+  unsigned long long names_read = 0;
+  unsigned long long names_done = 0;
+  unsigned long long failed = 0;
+  unsigned long long hits = 0;
+  unsigned long long misses = 0;
+  int requesters = 0;
+  int resolvers = 0;
+  const metrics_thread_t * ptr_thread;
+
+  for(int i = 0; i < ptr_metrics->num_requesters; i++)
+  {
+    ptr_thread = &ptr_metrics->requesters[i];
+    names_read += atomic_load_explicit(&ptr_thread->names, memory_order_relaxed);
+    requesters += atomic_load_explicit(&ptr_thread->running_f, memory_order_relaxed);
+  }
+  for(int i = 0; i < ptr_metrics->num_resolvers; i++)
+  {
+    ptr_thread = &ptr_metrics->resolvers[i];
+    names_done += atomic_load_explicit(&ptr_thread->names, memory_order_relaxed);
+    failed += atomic_load_explicit(&ptr_thread->failed, memory_order_relaxed);
+    hits += atomic_load_explicit(&ptr_thread->cache_hits, memory_order_relaxed);
+    misses += atomic_load_explicit(&ptr_thread->cache_misses, memory_order_relaxed);
+    resolvers += atomic_load_explicit(&ptr_thread->running_f, memory_order_relaxed);
+  }
+  // a result may be counted before its failure is
+  failed = failed < names_done ? failed : names_done;
+
+  fprintf(ptr_out, "# HELP multilookup_uptime_seconds Time since the run started.\n"
+          "# TYPE multilookup_uptime_seconds gauge\nmultilookup_uptime_seconds %.3f\n",
+          (now_ns() - ptr_metrics->start_ns) / 1e9);
+  metrics_write_metric(ptr_out, "multilookup_names_read_total", "counter",
+                       "Hostnames read and queued by the requesters.", names_read);
+  metrics_write_metric(ptr_out, "multilookup_names_resolved_total", "counter",
+                       "Hostnames resolved to an address.", names_done - failed);
+  metrics_write_metric(ptr_out, "multilookup_names_failed_total", "counter",
+                       "Hostnames that could not be resolved.", failed);
+  metrics_write_metric(ptr_out, "multilookup_cache_hits_total", "counter",
+                       "Hostnames answered by the cache or by a lookup already in flight.", hits);
+  metrics_write_metric(ptr_out, "multilookup_cache_misses_total", "counter",
+                       "Hostnames a resolver had to look up itself.", misses);
+  fprintf(ptr_out, "# HELP multilookup_cache_hit_ratio Fraction of hostnames answered without a lookup of their own.\n"
+          "# TYPE multilookup_cache_hit_ratio gauge\nmultilookup_cache_hit_ratio %.4f\n",
+          hits + misses > 0 ? (double)hits / (hits + misses) : 0.0);
+  fprintf(ptr_out, "# HELP multilookup_threads Threads running in each pool, including parked ones.\n"
+          "# TYPE multilookup_threads gauge\nmultilookup_threads{role=\"requester\"} %d\n"
+          "multilookup_threads{role=\"resolver\"} %d\n", requesters, resolvers);
+
+  for(int hist = 0; hist < METRICS_NUM_HISTS; hist++)
+  {
+    memset(counts, 0, sizeof(counts));
+    sum = 0;
+    max = 0;
+    total = metrics_snapshot(ptr_metrics, hist, counts, &sum, &max);
+    fprintf(ptr_out, "# HELP %s %s\n# TYPE %s summary\n", prometheus_hist_names[hist], prometheus_hist_help[hist],
+            prometheus_hist_names[hist]);
+    for(size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++)
+    {
+      fprintf(ptr_out, "%s{quantile=\"%s\"} %.9f\n", prometheus_hist_names[hist], prometheus_quantiles[i],
+              metrics_percentile(counts, total, max, percentiles[i]) / 1e9);
+    }
+    fprintf(ptr_out, "%s_sum %.9f\n%s_count %llu\n", prometheus_hist_names[hist], sum / 1e9,
+            prometheus_hist_names[hist], total);
+  }
+
+  if(ptr_metrics->gauges != NULL)
+  {
+    ptr_metrics->gauges(ptr_metrics->ptr_gauges_user, ptr_out);
+  }
+}
+
+unsigned long long metrics_quantile(metrics_t * ptr_metrics, int hist, double percentile)
+{
+  unsigned long long counts[METRICS_BUCKETS] = {0};
+  unsigned long long total;
+  unsigned long long sum = 0;
+  unsigned long long max = 0;
+
+  total = metrics_snapshot(ptr_metrics, hist, counts, &sum, &max);
+
+  return metrics_percentile(counts, total, max, percentile);
+}
@@ -0,0 +1,247 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file metrics.h
+ * @brief Latency histograms and per-thread pipeline counters
+ *
+ * Definitions and declarations for the metrics written with --metrics.
+ * Every thread owns a slot with its own counters and histograms, so
+ * recording never shares a cache line or takes a lock. Histograms use
+ * HDR-style buckets, linear below METRICS_SUB_COUNT nanoseconds and then
+ * METRICS_SUB_COUNT buckets per power of two, which keeps every value
+ * within about 3% however large it is. Slots are summed only when the
+ * metrics are written out, either to a file as JSON or to clients of a
+ * Unix domain socket in the Prometheus text format while the run goes on.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __METRICS_H__
+#define __METRICS_H__
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "lockprof.h"
+#include "queue.h"
+
+#define METRICS_SUB_BITS (5)
+#define METRICS_SUB_COUNT (1 << METRICS_SUB_BITS)
+// values from 2^METRICS_MAX_EXP ns, about 18 minutes, share the last bucket
+#define METRICS_MAX_EXP (40)
+#define METRICS_BUCKETS ((METRICS_MAX_EXP - METRICS_SUB_BITS + 2) * METRICS_SUB_COUNT)
+
+#define METRICS_QUEUE (0)
+#define METRICS_LOOKUP (1)
+#define METRICS_LOG_WRITE (2)
+#define METRICS_NUM_HISTS (3)
+
+#define METRICS_BACKLOG (16)
+// time a scrape client has to start its request before it is sent bare text
+#define METRICS_REQUEST_MS (100)
+// time a scrape client has to finish its request or read the reply
+#define METRICS_CLIENT_MS (1000)
+
+typedef struct
+{
+  atomic_ullong counts[METRICS_BUCKETS];
+  atomic_ullong total;
+  atomic_ullong sum_ns;
+  atomic_ullong max_ns;
+} metrics_hist_t;
+
+typedef struct
+{
+  _Alignas(CACHE_LINE_SIZE) atomic_int used_f;
+  atomic_int running_f;
+  atomic_ullong names;
+  atomic_ullong failed;
+  atomic_ullong cache_hits;
+  atomic_ullong cache_misses;
+  atomic_ullong idle_ns;
+  atomic_ullong lock_wait_ns;
+  metrics_hist_t hists[METRICS_NUM_HISTS];
+} metrics_thread_t;
+
+/**
+ * @brief Called by every scrape to add gauges the metrics do not keep
+ *
+ * Runs on the metrics server thread while the pipeline is running, so it
+ * must only read values that can be read without a lock.
+ *
+ * @param ptr_user The pointer given to metrics_listen()
+ * @param ptr_out Where to write lines in the Prometheus text format
+ */
+typedef void (* metrics_gauges_t)(void * ptr_user, FILE * ptr_out);
+
+typedef struct
+{
+  FILE * ptr_file;
+  int interval_s;
+  long long start_ns;
+  metrics_thread_t * requesters;
+  int num_requesters;
+  metrics_thread_t * resolvers;
+  int num_resolvers;
+  lockprof_mutex_t mutex;
+  pthread_cond_t cond;
+  pthread_t thread;
+  int thread_f;
+  int stop_f;
+  int listen_fd;
+  char * path;
+  metrics_gauges_t gauges;
+  void * ptr_gauges_user;
+  pthread_t server;
+  int server_f;
+} metrics_t;
+
+/**
+ * @brief Create the metrics and open the file they are written to
+ *
+ * @param ptr_metrics A pointer to the uninitialized metrics pointer
+ * @param file_name The file the metrics are written to, NULL to only serve them
+ * @param interval_s Seconds between periodic dumps, 0 for only at exit
+ * @param num_requesters The most requester threads there can be
+ * @param num_resolvers The most resolver threads there can be
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int metrics_init(metrics_t ** ptr_metrics, const char * file_name, int interval_s, int num_requesters, int num_resolvers);
+
+/**
+ * @brief Close the metrics file and socket and free the metrics from the heap
+ *
+ * @param ptr_metrics A pointer to the metrics
+ */
+void metrics_free(metrics_t * ptr_metrics);
+
+/**
+ * @brief Listen for scrapes on a Unix domain socket
+ *
+ * Any file already at the path is replaced. Each client is sent one
+ * snapshot and disconnected. A client that starts with an HTTP GET is
+ * answered with an HTTP response, so curl --unix-socket or a Prometheus
+ * behind a socket proxy can scrape it, and any other client gets the
+ * bare text.
+ *
+ * @param ptr_metrics A pointer to the metrics
+ * @param path The path of the socket
+ * @param gauges The function adding the caller's gauges to each scrape
+ * @param ptr_user A pointer handed to every call of gauges
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int metrics_listen(metrics_t * ptr_metrics, const char * path, metrics_gauges_t gauges, void * ptr_user);
+
+/**
+ * @brief Start writing the metrics every interval and serving scrapes
+ *
+ * @param ptr_metrics A pointer to the metrics
+ *
+ * @return 0 if successful or there is nothing to start, -1 otherwise
+ */
+int metrics_start(metrics_t * ptr_metrics);
+
+/**
+ * @brief Stop the periodic dumps and scrapes, and write the final metrics
+ *
+ * @param ptr_metrics A pointer to the metrics
+ */
+void metrics_stop(metrics_t * ptr_metrics);
+
+/**
+ * @brief Write the metrics as one line of JSON
+ *
+ * Safe to call while threads are still recording.
+ *
+ * @param ptr_metrics A pointer to the metrics
+ * @param final_f 1 if this is the last dump of the run
+ */
+void metrics_dump(metrics_t * ptr_metrics, int final_f);
+
+/**
+ * @brief Write a snapshot in the Prometheus text format
+ *
+ * Only reads counters, so it never waits on a thread that is recording
+ * and no thread ever waits on it.
+ *
+ * @param ptr_metrics A pointer to the metrics
+ * @param ptr_out Where to write the snapshot
+ */
+void metrics_write_prometheus(metrics_t * ptr_metrics, FILE * ptr_out);
+
+/**
+ * @brief Value at a percentile of one histogram, summed over every thread
+ *
+ * @param ptr_metrics A pointer to the metrics
+ * @param hist METRICS_QUEUE, METRICS_LOOKUP or METRICS_LOG_WRITE
+ * @param percentile The percentile from 0 to 100
+ *
+ * @return The value in nanoseconds, within the bucket error, or 0 if nothing was recorded
+ */
+unsigned long long metrics_quantile(metrics_t * ptr_metrics, int hist, double percentile);
+
+/**
+ * @brief Add to a counter of the calling thread's own slot
+ *
+ * Only the owning thread writes a slot, so this needs no atomic
+ * read-modify-write.
+ */
+static inline void metrics_add(atomic_ullong * ptr_counter, long long value)
+{
+  atomic_store_explicit(ptr_counter, atomic_load_explicit(ptr_counter, memory_order_relaxed) + value,
+                        memory_order_relaxed);
+}
+
+/**
+ * @brief Index of the histogram bucket holding a value
+ */
+static inline int metrics_bucket(long long value)
+{
+  int exp;
+
+  if(value < METRICS_SUB_COUNT)
+  {
+    return value < 0 ? 0 : (int)value;
+  }
+  exp = 63 - __builtin_clzll((unsigned long long)value);
+  if(exp > METRICS_MAX_EXP)
+  {
+    return METRICS_BUCKETS - 1;
+  }
+  return (exp - METRICS_SUB_BITS + 1) * METRICS_SUB_COUNT + (int)((value >> (exp - METRICS_SUB_BITS)) - METRICS_SUB_COUNT);
+}
+
+/**
+ * @brief Record a duration in one of the calling thread's histograms
+ *
+ * @param ptr_thread The calling thread's slot
+ * @param hist METRICS_QUEUE, METRICS_LOOKUP or METRICS_LOG_WRITE
+ * @param value_ns The duration in nanoseconds
+ */
+static inline void metrics_record(metrics_thread_t * ptr_thread, int hist, long long value_ns)
+{
+  metrics_hist_t * ptr_hist = &ptr_thread->hists[hist];
+
+  metrics_add(&ptr_hist->counts[metrics_bucket(value_ns)], 1);
+  metrics_add(&ptr_hist->total, 1);
+  metrics_add(&ptr_hist->sum_ns, value_ns);
+  if((unsigned long long)value_ns > atomic_load_explicit(&ptr_hist->max_ns, memory_order_relaxed))
+  {
+    atomic_store_explicit(&ptr_hist->max_ns, value_ns, memory_order_relaxed);
+  }
+}
+
+#endif /* __METRICS_H__ */
@@ -21,16 +21,137 @@
  * @date 2018-03-11
  */
 
+#include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/syscall.h>
 #include <unistd.h>
 #include "multi-lookup.h"
 #include "util.h"
+#include "dns.h"
+#include "tokenize.h"
+#include "timing.h"
+
+/**
+ * @brief Parse a byte count with an optional K, M or G suffix
+ *
+ * Signs, anything after the suffix and counts too large for a size_t are
+ * rejected rather than wrapped.
+ */
+static int parse_size(const char * str, size_t * ptr_size)
+{
+  unsigned long long value;
+  char * ptr_end;
+  int shift = 0;
+
+  // strtoull would accept and negate a sign
+  if( *str < '0' || *str > '9' )
+  {
+    return -1;
+  }
+  errno = 0;
+  value = strtoull(str, &ptr_end, 10);
+  if( errno != 0 )
+  {
+    return -1;
+  }
+  switch(*ptr_end)
+  {
+    case '\0': break;
+    case 'K': case 'k': shift = 10; ptr_end++; break;
+    case 'M': case 'm': shift = 20; ptr_end++; break;
+    case 'G': case 'g': shift = 30; ptr_end++; break;
+    default: return -1;
+  }
+  if( *ptr_end != '\0' || value > (SIZE_MAX >> shift) )
+  {
+    return -1;
+  }
+  *ptr_size = (size_t)value << shift;
+
+  return 0;
+}
+
+/**
+ * @brief Parse a thread count, or auto for a pool sized while running
+ *
+ * A fixed count sets both bounds. For auto, the bounds already set by
+ * options are kept, with the upper one defaulting to a number per CPU.
+ */
+static int parse_pool(const char * str, const char * name, int * ptr_min, int * ptr_max, int per_cpu)
+{
+  int temp_int;
+  long num_cpus;
+
+  if( strcmp(str, "auto") == 0 )
+  {
+    if(*ptr_max == 0)
+    {
+      num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+      *ptr_max = num_cpus > 0 ? num_cpus * per_cpu : per_cpu;
+      if(*ptr_max > AUTOSCALE_MAX_THREADS) *ptr_max = AUTOSCALE_MAX_THREADS;
+      if(*ptr_max < *ptr_min) *ptr_max = *ptr_min;
+    }
+    if(*ptr_min > *ptr_max)
+    {
+      printf("%s minimum %d is more than its maximum %d\n", name, *ptr_min, *ptr_max);
+      return -1;
+    }
+    return 0;
+  }
+
+  // convert from string
+  if( sscanf(str, "%d", &temp_int) != 1 )
+  {
+    printf("%s should be an integer or auto\n", name);
+    return -1;
+  }
+
+  // verify value
+  if( temp_int < 1 || temp_int > AUTOSCALE_MAX_THREADS )
+  {
+    printf("%s should be from 1 to %d, got %d\n", name, AUTOSCALE_MAX_THREADS, temp_int);
+    return -1;
+  }
+
+  // store
+  *ptr_min = temp_int;
+  *ptr_max = temp_int;
+
+  return 0;
+}
+
+/**
+ * @brief Parse a thread count, or a range of them as LO-HI, for --sweep
+ */
+static int parse_range(const char * str, const char * name, int * ptr_min, int * ptr_max)
+{
+  int num;
+
+  // convert from string, a single count is a range of one
+  num = sscanf(str, "%d-%d", ptr_min, ptr_max);
+  if(num == 1)
+  {
+    *ptr_max = *ptr_min;
+  }
+
+  // verify values
+  if( num < 1 || *ptr_min < 1 || *ptr_max > AUTOSCALE_MAX_THREADS || *ptr_min > *ptr_max )
+  {
+    printf("%s should be an integer or a range LO-HI from 1 to %d with --sweep, got %s\n", name, AUTOSCALE_MAX_THREADS, str);
+    return -1;
+  }
+
+  return 0;
+}
 
 int process_inputs(int argc, char ** argv, lookup_params_t ** ptr_lookup_params)
 {
@@ -41,58 +162,461 @@ int process_inputs(int argc, char ** argv, lookup_params_t ** ptr_lookup_params)
   int num_input_files = 0;
   FILE * temp;
   int temp_int;
-  pthread_mutex_t * ptr_temp_mutex;
+  lockprof_mutex_t * ptr_temp_mutex;
+  struct stat file_stat;
+  int opt;
+  int opt_idx;
+  static const struct option long_options[] =
+  {
+    {"queue-size", required_argument, NULL, OPT_QUEUE_SIZE},
+    {"async", no_argument, NULL, OPT_ASYNC},
+    {"dns-server", required_argument, NULL, OPT_DNS_SERVER},
+    {"max-inflight", required_argument, NULL, OPT_MAX_INFLIGHT},
+    {"dns-timeout", required_argument, NULL, OPT_DNS_TIMEOUT},
+    {"dns-retries", required_argument, NULL, OPT_DNS_RETRIES},
+    {"cache-size", required_argument, NULL, OPT_CACHE_SIZE},
+    {"cache-shards", required_argument, NULL, OPT_CACHE_SHARDS},
+    {"cache-ttl", required_argument, NULL, OPT_CACHE_TTL},
+    {"negative-cache-size", required_argument, NULL, OPT_NEGATIVE_CACHE_SIZE},
+    {"negative-ttl", required_argument, NULL, OPT_NEGATIVE_TTL},
+    {"mmap", no_argument, NULL, OPT_MMAP},
+    {"chunk-size", required_argument, NULL, OPT_CHUNK_SIZE},
+    {"log-buffer", required_argument, NULL, OPT_LOG_BUFFER},
+    {"min-requesters", required_argument, NULL, OPT_MIN_REQUESTERS},
+    {"max-requesters", required_argument, NULL, OPT_MAX_REQUESTERS},
+    {"min-resolvers", required_argument, NULL, OPT_MIN_RESOLVERS},
+    {"max-resolvers", required_argument, NULL, OPT_MAX_RESOLVERS},
+    {"autoscale-ms", required_argument, NULL, OPT_AUTOSCALE_MS},
+    {"backend", required_argument, NULL, OPT_BACKEND},
+    {"mock-latency", required_argument, NULL, OPT_MOCK_LATENCY},
+    {"mock-fail", required_argument, NULL, OPT_MOCK_FAIL},
+    {"all-addresses", no_argument, NULL, OPT_ALL_ADDRESSES},
+    {"cache-file", required_argument, NULL, OPT_CACHE_FILE},
+    {"daemon", required_argument, NULL, OPT_DAEMON},
+    {"metrics", required_argument, NULL, OPT_METRICS},
+    {"metrics-interval", required_argument, NULL, OPT_METRICS_INTERVAL},
+    {"lock-profile", no_argument, NULL, OPT_LOCK_PROFILE},
+    {"batch", required_argument, NULL, OPT_BATCH},
+    {"requester-cpus", required_argument, NULL, OPT_REQUESTER_CPUS},
+    {"resolver-cpus", required_argument, NULL, OPT_RESOLVER_CPUS},
+    {"concurrency-limit", required_argument, NULL, OPT_CONCURRENCY_LIMIT},
+    {"lowercase", no_argument, NULL, OPT_LOWERCASE},
+    {"scalar-tokenizer", no_argument, NULL, OPT_SCALAR_TOKENIZER},
+    {"partition", no_argument, NULL, OPT_PARTITION},
+    {"metrics-socket", required_argument, NULL, OPT_METRICS_SOCKET},
+    {"record", required_argument, NULL, OPT_RECORD},
+    {"sweep", required_argument, NULL, OPT_SWEEP},
+    {"sweep-reps", required_argument, NULL, OPT_SWEEP_REPS},
+    {"stats", no_argument, NULL, OPT_STATS},
+    {NULL, 0, NULL, 0}
+  };
 
   // create main struct for parameters
   if( (*ptr_lookup_params = (lookup_params_t *)calloc(1, sizeof(lookup_params_t))) == NULL )
   {
     return -1;
   }
+  (*ptr_lookup_params)->queue_size = QUEUE_DEFAULT_CAPACITY;
+  (*ptr_lookup_params)->max_inflight = DNS_DEFAULT_INFLIGHT;
+  (*ptr_lookup_params)->dns_timeout_ms = DNS_DEFAULT_TIMEOUT_MS;
+  (*ptr_lookup_params)->dns_retries = DNS_DEFAULT_RETRIES;
+  (*ptr_lookup_params)->cache_size = CACHE_DEFAULT_SIZE;
+  (*ptr_lookup_params)->cache_shards = CACHE_DEFAULT_SHARDS;
+  (*ptr_lookup_params)->cache_ttl = CACHE_DEFAULT_TTL;
+  (*ptr_lookup_params)->negative_cache_size = CACHE_DEFAULT_NEGATIVE_SIZE;
+  (*ptr_lookup_params)->negative_ttl = CACHE_DEFAULT_NEGATIVE_TTL;
+  (*ptr_lookup_params)->chunk_size = CHUNK_DEFAULT_SIZE;
+  (*ptr_lookup_params)->log_buffer = LOGBUF_DEFAULT_SIZE;
+  (*ptr_lookup_params)->batch_size = BATCH_DEFAULT_SIZE;
+  (*ptr_lookup_params)->min_requester = 1;
+  (*ptr_lookup_params)->min_resolver = 1;
+  (*ptr_lookup_params)->autoscale_ms = AUTOSCALE_DEFAULT_INTERVAL_MS;
+  (*ptr_lookup_params)->backend_spec = BACKEND_DEFAULT;
+  (*ptr_lookup_params)->mock_latency = BACKEND_DEFAULT_LATENCY;
+  (*ptr_lookup_params)->sweep_reps = 1;
 
   /*
-   * Number of requester threads
+   * Options
    */
-  // convert from string
-  if( sscanf(argv[PARAM_NUM_REQUESTERS], "%d", &temp_int) != 1 )
+  // options come before the positional parameters
+  while( (opt = getopt_long(argc, argv, "+", long_options, &opt_idx)) != -1 )
+  {
+    switch(opt)
+    {
+      case OPT_QUEUE_SIZE:
+        if( sscanf(optarg, "%d", &temp_int) != 1 || temp_int < 1 )
+        {
+          printf("--queue-size should be an integer more than 0, got %s\n", optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        (*ptr_lookup_params)->queue_size = temp_int;
+        break;
+
+      case OPT_ASYNC:
+        (*ptr_lookup_params)->async_f = 1;
+        break;
+
+      case OPT_DNS_SERVER:
+        (*ptr_lookup_params)->dns_server_str = optarg;
+        break;
+
+      case OPT_MAX_INFLIGHT:
+        if( sscanf(optarg, "%d", &temp_int) != 1 || temp_int < 1 || temp_int > DNS_MAX_INFLIGHT )
+        {
+          printf("--max-inflight should be an integer from 1 to %d, got %s\n", DNS_MAX_INFLIGHT, optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        (*ptr_lookup_params)->max_inflight = temp_int;
+        break;
+
+      case OPT_DNS_TIMEOUT:
+        if( sscanf(optarg, "%d", &temp_int) != 1 || temp_int < 1 )
+        {
+          printf("--dns-timeout should be an integer more than 0, got %s\n", optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        (*ptr_lookup_params)->dns_timeout_ms = temp_int;
+        break;
+
+      case OPT_DNS_RETRIES:
+        if( sscanf(optarg, "%d", &temp_int) != 1 || temp_int < 0 )
+        {
+          printf("--dns-retries should be a non-negative integer, got %s\n", optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        (*ptr_lookup_params)->dns_retries = temp_int;
+        break;
+
+      case OPT_CACHE_SIZE:
+        if( parse_size(optarg, &(*ptr_lookup_params)->cache_size) != 0 )
+        {
+          printf("--cache-size should be a size in bytes with an optional K, M or G suffix, got %s\n", optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        break;
+
+      case OPT_CACHE_SHARDS:
+        if( sscanf(optarg, "%d", &temp_int) != 1 || temp_int < 1 )
+        {
+          printf("--cache-shards should be an integer more than 0, got %s\n", optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        (*ptr_lookup_params)->cache_shards = temp_int;
+        break;
+
+      case OPT_CACHE_TTL:
+        if( sscanf(optarg, "%d", &temp_int) != 1 || temp_int < 1 )
+        {
+          printf("--cache-ttl should be an integer more than 0, got %s\n", optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        (*ptr_lookup_params)->cache_ttl = temp_int;
+        break;
+
+      case OPT_NEGATIVE_CACHE_SIZE:
+        if( parse_size(optarg, &(*ptr_lookup_params)->negative_cache_size) != 0 )
+        {
+          printf("--negative-cache-size should be a size in bytes with an optional K, M or G suffix, got %s\n", optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        break;
+
+      case OPT_NEGATIVE_TTL:
+        if( sscanf(optarg, "%d", &temp_int) != 1 || temp_int < 1 )
+        {
+          printf("--negative-ttl should be an integer more than 0, got %s\n", optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        (*ptr_lookup_params)->negative_ttl = temp_int;
+        break;
+
+      case OPT_MMAP:
+        (*ptr_lookup_params)->mmap_f = 1;
+        break;
+
+      case OPT_CHUNK_SIZE:
+        if( parse_size(optarg, &(*ptr_lookup_params)->chunk_size) != 0 || (*ptr_lookup_params)->chunk_size == 0 )
+        {
+          printf("--chunk-size should be a size in bytes more than 0 with an optional K, M or G suffix, got %s\n", optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        break;
+
+      case OPT_LOG_BUFFER:
+        if( parse_size(optarg, &(*ptr_lookup_params)->log_buffer) != 0 || (*ptr_lookup_params)->log_buffer == 0 )
+        {
+          printf("--log-buffer should be a size in bytes more than 0 with an optional K, M or G suffix, got %s\n", optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        break;
+
+      case OPT_MIN_REQUESTERS:
+      case OPT_MAX_REQUESTERS:
+      case OPT_MIN_RESOLVERS:
+      case OPT_MAX_RESOLVERS:
+        if( sscanf(optarg, "%d", &temp_int) != 1 || temp_int < 1 || temp_int > AUTOSCALE_MAX_THREADS )
+        {
+          printf("--%s should be an integer from 1 to %d, got %s\n", long_options[opt_idx].name, AUTOSCALE_MAX_THREADS, optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        if(opt == OPT_MIN_REQUESTERS) (*ptr_lookup_params)->min_requester = temp_int;
+        if(opt == OPT_MAX_REQUESTERS) (*ptr_lookup_params)->max_requester = temp_int;
+        if(opt == OPT_MIN_RESOLVERS) (*ptr_lookup_params)->min_resolver = temp_int;
+        if(opt == OPT_MAX_RESOLVERS) (*ptr_lookup_params)->max_resolver = temp_int;
+        break;
+
+      case OPT_AUTOSCALE_MS:
+        if( sscanf(optarg, "%d", &temp_int) != 1 || temp_int < 1 )
+        {
+          printf("--autoscale-ms should be an integer more than 0, got %s\n", optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        (*ptr_lookup_params)->autoscale_ms = temp_int;
+        break;
+
+      case OPT_BACKEND:
+        (*ptr_lookup_params)->backend_spec = optarg;
+        break;
+
+      case OPT_MOCK_LATENCY:
+        (*ptr_lookup_params)->mock_latency = optarg;
+        break;
+
+      case OPT_ALL_ADDRESSES:
+        (*ptr_lookup_params)->all_addresses_f = 1;
+        break;
+
+      case OPT_CACHE_FILE:
+        (*ptr_lookup_params)->cache_file = optarg;
+        break;
+
+      case OPT_DAEMON:
+        (*ptr_lookup_params)->daemon_spec = optarg;
+        break;
+
+      case OPT_METRICS:
+        (*ptr_lookup_params)->metrics_file = optarg;
+        break;
+
+      case OPT_METRICS_INTERVAL:
+        if( sscanf(optarg, "%d", &temp_int) != 1 || temp_int < 0 )
+        {
+          printf("--metrics-interval should be an integer of at least 0, got %s\n", optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        (*ptr_lookup_params)->metrics_interval = temp_int;
+        break;
+
+      case OPT_LOCK_PROFILE:
+        // no lock is held yet, so every one is timed from its first use
+        lockprof_enable();
+        break;
+
+      case OPT_BATCH:
+        if( sscanf(optarg, "%d", &temp_int) != 1 || temp_int < 1 )
+        {
+          printf("--batch should be an integer more than 0, got %s\n", optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        (*ptr_lookup_params)->batch_size = temp_int;
+        break;
+
+      case OPT_REQUESTER_CPUS:
+        (*ptr_lookup_params)->requester_cpus = optarg;
+        break;
+
+      case OPT_RESOLVER_CPUS:
+        (*ptr_lookup_params)->resolver_cpus = optarg;
+        break;
+
+      case OPT_CONCURRENCY_LIMIT:
+        if( strcmp(optarg, "auto") == 0 )
+        {
+          (*ptr_lookup_params)->limit_adaptive_f = 1;
+        }
+        else if( sscanf(optarg, "%d", &temp_int) != 1 || temp_int < 1 )
+        {
+          printf("--concurrency-limit should be auto or an integer more than 0, got %s\n", optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        else
+        {
+          (*ptr_lookup_params)->concurrency_limit = temp_int;
+        }
+        break;
+
+      case OPT_LOWERCASE:
+        (*ptr_lookup_params)->lowercase_f = 1;
+        break;
+
+      case OPT_SCALAR_TOKENIZER:
+        (*ptr_lookup_params)->scalar_tokenizer_f = 1;
+        break;
+
+      case OPT_PARTITION:
+        (*ptr_lookup_params)->partition_f = 1;
+        break;
+
+      case OPT_METRICS_SOCKET:
+        (*ptr_lookup_params)->metrics_socket = optarg;
+        break;
+
+      case OPT_RECORD:
+        (*ptr_lookup_params)->record_file = optarg;
+        break;
+
+      case OPT_SWEEP:
+        (*ptr_lookup_params)->sweep_file = optarg;
+        break;
+
+      case OPT_SWEEP_REPS:
+        if( sscanf(optarg, "%d", &temp_int) != 1 || temp_int < 1 )
+        {
+          printf("--sweep-reps should be an integer more than 0, got %s\n", optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        (*ptr_lookup_params)->sweep_reps = temp_int;
+        break;
+
+      case OPT_STATS:
+        (*ptr_lookup_params)->stats_f = 1;
+        break;
+
+      case OPT_MOCK_FAIL:
+        if( sscanf(optarg, "%lf", &(*ptr_lookup_params)->mock_fail) != 1 ||
+            (*ptr_lookup_params)->mock_fail < 0 || (*ptr_lookup_params)->mock_fail > 1 )
+        {
+          printf("--mock-fail should be a fraction from 0 to 1, got %s\n", optarg);
+          free((void *)*ptr_lookup_params);
+          return -1;
+        }
+        break;
+
+      default:
+        printf(USAGE_DECLARATION);
+        free((void *)*ptr_lookup_params);
+        return -1;
+    }
+  }
+
+  // find the DNS server up front so every resolver thread can use it
+  if( (*ptr_lookup_params)->async_f &&
+      dns_server_parse((*ptr_lookup_params)->dns_server_str, &(*ptr_lookup_params)->dns_server,
+                       &(*ptr_lookup_params)->dns_server_len) != 0 )
   {
-    printf("<# requester> should be an integer\n");
+    if((*ptr_lookup_params)->dns_server_str != NULL)
+    {
+      printf("--dns-server should be an IP address with an optional port, got %s\n", (*ptr_lookup_params)->dns_server_str);
+    }
+    else
+    {
+      printf("No nameserver found in %s, use --dns-server\n", DNS_RESOLV_CONF);
+    }
     free((void *)*ptr_lookup_params);
     return -1;
   }
 
-  // verify value
-  if( temp_int < 1 )
+  // every hostname takes an A and an AAAA query, and each needs its own transaction ID
+  if( (*ptr_lookup_params)->async_f && (*ptr_lookup_params)->all_addresses_f &&
+      (*ptr_lookup_params)->max_inflight > DNS_MAX_INFLIGHT / 2 )
   {
-    printf("<# requester> should be more than 0, got %d\n", temp_int);
+    printf("--max-inflight can be at most %d with --async and --all-addresses\n", DNS_MAX_INFLIGHT / 2);
     free((void *)*ptr_lookup_params);
     return -1;
   }
 
-  // store
-  (*ptr_lookup_params)->num_requester = temp_int;
+  // asynchronous resolvers send their own queries instead of using a backend
+  if( (*ptr_lookup_params)->async_f && strcmp((*ptr_lookup_params)->backend_spec, BACKEND_DEFAULT) != 0 )
+  {
+    printf("--backend cannot be combined with --async\n");
+    free((void *)*ptr_lookup_params);
+    return -1;
+  }
+  if( (*ptr_lookup_params)->async_f && (*ptr_lookup_params)->record_file != NULL )
+  {
+    printf("--record cannot be combined with --async\n");
+    free((void *)*ptr_lookup_params);
+    return -1;
+  }
+
+  // every sweep run starts cold, times one batch of files, and reports its own metrics
+  if( (*ptr_lookup_params)->sweep_file != NULL &&
+      ((*ptr_lookup_params)->daemon_spec != NULL || (*ptr_lookup_params)->cache_file != NULL ||
+       (*ptr_lookup_params)->metrics_file != NULL || (*ptr_lookup_params)->metrics_socket != NULL) )
+  {
+    printf("--sweep cannot be combined with --daemon, --cache-file, --metrics or --metrics-socket\n");
+    free((void *)*ptr_lookup_params);
+    return -1;
+  }
+
+  // shift so positional parameters keep their indices
+  argc -= optind - 1;
+  argv += optind - 1;
+  if( (*ptr_lookup_params)->daemon_spec != NULL && argc > PARAM_NUM_DATA_FILE )
+  {
+    printf("<data file> cannot be combined with --daemon\n");
+    free((void *)*ptr_lookup_params);
+    return -1;
+  }
+  if( argc < ((*ptr_lookup_params)->daemon_spec != NULL ? PARAM_NUM_DATA_FILE : MIN_NUM_PARAMS) )
+  {
+    printf(USAGE_DECLARATION);
+    free((void *)*ptr_lookup_params);
+    return -1;
+  }
+
+  /*
+   * Number of requester threads
+   */
+  if( (*ptr_lookup_params)->sweep_file != NULL ?
+      parse_range(argv[PARAM_NUM_REQUESTERS], "<# requester>", &(*ptr_lookup_params)->min_requester,
+                  &(*ptr_lookup_params)->max_requester) != 0 :
+      parse_pool(argv[PARAM_NUM_REQUESTERS], "<# requester>", &(*ptr_lookup_params)->min_requester,
+                 &(*ptr_lookup_params)->max_requester, AUTO_REQUESTERS_PER_CPU) != 0 )
+  {
+    free((void *)*ptr_lookup_params);
+    return -1;
+  }
 
   /*
    * Number of resolver threads
    */
-  // convert from string
-  if( sscanf(argv[PARAM_NUM_RESOLVERS], "%d", &temp_int) != 1 )
+  if( (*ptr_lookup_params)->sweep_file != NULL ?
+      parse_range(argv[PARAM_NUM_RESOLVERS], "<# resolver>", &(*ptr_lookup_params)->min_resolver,
+                  &(*ptr_lookup_params)->max_resolver) != 0 :
+      parse_pool(argv[PARAM_NUM_RESOLVERS], "<# resolver>", &(*ptr_lookup_params)->min_resolver,
+                 &(*ptr_lookup_params)->max_resolver, AUTO_RESOLVERS_PER_CPU) != 0 )
   {
-    printf("<# resolver> should be an integer\n");
     free((void *)*ptr_lookup_params);
     return -1;
   }
 
-  // verify value
-  if( temp_int < 1 )
+  // every hostname has a fixed owner, so the owners cannot come and go
+  if( (*ptr_lookup_params)->partition_f && (*ptr_lookup_params)->sweep_file == NULL &&
+      (*ptr_lookup_params)->min_resolver != (*ptr_lookup_params)->max_resolver )
   {
-    printf("<# resolver> should be more than 0, got %d\n", temp_int);
+    printf("--partition needs a fixed number of resolvers\n");
     free((void *)*ptr_lookup_params);
     return -1;
   }
 
-  // store
-  (*ptr_lookup_params)->num_resolver = temp_int;
-  
   /*
    * Requester log file
    */
@@ -116,14 +640,14 @@ int process_inputs(int argc, char ** argv, lookup_params_t ** ptr_lookup_params)
   ptr_requester_log->name_len = strlen(*ptr_requester_log->name);
 
   // create mutex for file
-  if( (ptr_temp_mutex = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t))) == NULL )
+  if( (ptr_temp_mutex = (lockprof_mutex_t *)malloc(sizeof(lockprof_mutex_t))) == NULL )
   {
     free((void *)*ptr_lookup_params);
     fclose(ptr_requester_log->ptr_file);
     free((void *)ptr_requester_log);
     return -1;
   }
-  pthread_mutex_init(ptr_temp_mutex, NULL);
+  lockprof_mutex_init(ptr_temp_mutex, "requester log");
   ptr_requester_log->ptr_mutex = ptr_temp_mutex;
 
   //store
@@ -156,7 +680,7 @@ int process_inputs(int argc, char ** argv, lookup_params_t ** ptr_lookup_params)
   ptr_resolver_log->name_len = strlen(*ptr_resolver_log->name);
 
   // create mutex for file
-  if( (ptr_temp_mutex = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t))) == NULL )
+  if( (ptr_temp_mutex = (lockprof_mutex_t *)malloc(sizeof(lockprof_mutex_t))) == NULL )
   {
     free((void *)*ptr_lookup_params);
     fclose(ptr_requester_log->ptr_file);
@@ -165,7 +689,7 @@ int process_inputs(int argc, char ** argv, lookup_params_t ** ptr_lookup_params)
     free((void *)ptr_resolver_log);
     return -1;
   }
-  pthread_mutex_init(ptr_temp_mutex, NULL);
+  lockprof_mutex_init(ptr_temp_mutex, "resolver log");
   ptr_resolver_log->ptr_mutex = ptr_temp_mutex;
 
   // store
@@ -211,16 +735,46 @@ int process_inputs(int argc, char ** argv, lookup_params_t ** ptr_lookup_params)
     ptr_data_file->ptr_file = temp;
     ptr_data_file->name = &argv[i];
     ptr_data_file->name_len = strlen(*ptr_data_file->name);
+    ptr_data_file->map = NULL;
+    ptr_data_file->size = 0;
+
+    // regular files are split into byte ranges for the scheduler, and
+    // mapped if asked, anything else is read as a stream
+    if( fstat(fileno(temp), &file_stat) == 0 && S_ISREG(file_stat.st_mode) && file_stat.st_size > 0 )
+    {
+      ptr_data_file->size = file_stat.st_size;
+      if( (*ptr_lookup_params)->mmap_f )
+      {
+        ptr_data_file->map = (char *)mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fileno(temp), 0);
+        if(ptr_data_file->map == MAP_FAILED)
+        {
+          ptr_data_file->map = NULL;
+        }
+      }
+    }
+
+    // a stream is used up by the first run of a sweep
+    if( (*ptr_lookup_params)->sweep_file != NULL && ptr_data_file->size == 0 &&
+        (fstat(fileno(temp), &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) )
+    {
+      printf("%s cannot be read more than once, --sweep needs regular data files\n", argv[i]);
+      fclose(temp);
+      free((void *)ptr_data_file);
+      (*ptr_lookup_params)->input_files = input_files;
+      (*ptr_lookup_params)->num_input_files = num_input_files;
+      free_lookup_params(*ptr_lookup_params);
+      return -1;
+    }
 
     // create mutex for file
-    if( (ptr_temp_mutex = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t))) == NULL )
+    if( (ptr_temp_mutex = (lockprof_mutex_t *)malloc(sizeof(lockprof_mutex_t))) == NULL )
     {
       (*ptr_lookup_params)->input_files = input_files;
       (*ptr_lookup_params)->num_input_files = num_input_files;
       free_lookup_params(*ptr_lookup_params);
       return -1;
     }
-    pthread_mutex_init(ptr_temp_mutex, NULL);
+    lockprof_mutex_init(ptr_temp_mutex, "input file");
     ptr_data_file->ptr_mutex = ptr_temp_mutex;
 
     // store
@@ -231,11 +785,35 @@ int process_inputs(int argc, char ** argv, lookup_params_t ** ptr_lookup_params)
   (*ptr_lookup_params)->input_files = input_files;
   (*ptr_lookup_params)->num_input_files = num_input_files;
 
+  // create the backend blocking resolvers look names up through
+  if( backend_init(&(*ptr_lookup_params)->ptr_backend, (*ptr_lookup_params)->backend_spec,
+                   (*ptr_lookup_params)->mock_latency, (*ptr_lookup_params)->mock_fail,
+                   (*ptr_lookup_params)->all_addresses_f) != 0 )
+  {
+    printf("Unable to create backend %s, --backend should be getaddrinfo, hosts:FILE, mock or replay:FILE and --mock-latency\n"
+           "should be fixed:US, uniform:MIN_US:MAX_US or lognormal:MEDIAN_US:SIGMA\n", (*ptr_lookup_params)->backend_spec);
+    (*ptr_lookup_params)->ptr_backend = NULL;
+    free_lookup_params(*ptr_lookup_params);
+    return -1;
+  }
+  if( (*ptr_lookup_params)->record_file != NULL &&
+      backend_record(&(*ptr_lookup_params)->ptr_backend, (*ptr_lookup_params)->record_file) != 0 )
+  {
+    printf("Unable to write trace to %s\n", (*ptr_lookup_params)->record_file);
+    free_lookup_params(*ptr_lookup_params);
+    return -1;
+  }
+
   return 0;
 }
 
 void free_lookup_params(lookup_params_t * ptr_lookup_params)
 {
+  if(ptr_lookup_params->ptr_backend != NULL)
+  {
+    backend_free(ptr_lookup_params->ptr_backend);
+  }
+
   fclose(ptr_lookup_params->requester_log->ptr_file);
   free((void *)ptr_lookup_params->requester_log->ptr_mutex);
   free((void *)ptr_lookup_params->requester_log);
@@ -246,6 +824,10 @@ void free_lookup_params(lookup_params_t * ptr_lookup_params)
 
   for(int i = 0; i < ptr_lookup_params->num_input_files; i++)
   {
+    if(ptr_lookup_params->input_files[i]->map != NULL)
+    {
+      munmap(ptr_lookup_params->input_files[i]->map, ptr_lookup_params->input_files[i]->size);
+    }
     fclose(ptr_lookup_params->input_files[i]->ptr_file);
     free((void *)(ptr_lookup_params->input_files[i]->ptr_mutex));
     free((void *)(ptr_lookup_params->input_files[i]));
@@ -254,184 +836,1286 @@ void free_lookup_params(lookup_params_t * ptr_lookup_params)
   free((void *)ptr_lookup_params);
 }
 
-void * requester(void * arg)
+/**
+ * @brief Add a hostname to the shared queue, sleeping while the resolvers catch up
+ *
+ * With --partition it goes to the queue of the resolver whose hash owns the
+ * name instead. With metrics, the item is stamped so its time in the queue
+ * can be measured, and the time spent sleeping counts as idle.
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+static int requester_enqueue(lookup_info_t * ptr_lookup_info, metrics_thread_t * ptr_metrics, queue_item_t * ptr_item)
 {
-  lookup_info_t * ptr_lookup_info = (lookup_info_t *)arg;
-  lookup_params_t * ptr_lookup_params = ptr_lookup_info->ptr_lookup_params;
-  int curr_file_idx = 0;
-  file_t * ptr_curr_file;
-  int num_files = 0;
+  queue_t * ptr_queue = ptr_lookup_info->ptr_queue;
+  long long start_ns;
+  int ret;
+
+  if(ptr_lookup_info->ptr_partition != NULL)
+  {
+    ptr_queue = ptr_lookup_info->ptr_partition->queues[partition_of(ptr_lookup_info->ptr_partition, ptr_item->str)];
+  }
+
+  if(ptr_metrics == NULL)
+  {
+    ptr_item->enqueue_ns = 0;
+    return queue_push_wait(ptr_queue, ptr_item);
+  }
+
+  start_ns = now_ns();
+  ptr_item->enqueue_ns = start_ns;
+  ret = queue_push_wait(ptr_queue, ptr_item);
+  metrics_add(&ptr_metrics->idle_ns, now_ns() - start_ns);
+  metrics_add(&ptr_metrics->names, 1);
+  return ret;
+}
+
+/**
+ * @brief Copy the next hostname of a buffer into an arena and add it to the shared queue
+ *
+ * The hostname is found, copied and lower-cased in one pass straight into
+ * the arena. Sleeps while the resolvers catch up.
+ *
+ * @return 0 if a hostname was added, 1 at the end of the buffer, -1 if the queue is closed
+ */
+static int requester_push(lookup_info_t * ptr_lookup_info, metrics_thread_t * ptr_metrics, arena_t * ptr_arena,
+                          const char * buf, size_t end, size_t * ptr_pos)
+{
+  queue_item_t item;
+  int token_len;
 
-  char * str_in;
-  char * temp_str_in;
-  int str_in_len;
-  if( (str_in = (char *)malloc(1025)) == NULL )
+  if( (item.str = arena_reserve(ptr_arena, TOKEN_COPY_SIZE)) == NULL )
   {
-    pthread_mutex_lock(ptr_lookup_info->ptr_printf_mutex);
+    lockprof_lock(ptr_lookup_info->ptr_printf_mutex);
     printf("Unable to malloc\n");
-    pthread_mutex_unlock(ptr_lookup_info->ptr_printf_mutex);
+    lockprof_unlock(ptr_lookup_info->ptr_printf_mutex);
     exit(-1);
   }
+  if( tokenize_next_copy(buf, end, ptr_pos, item.str, &token_len,
+                         ptr_lookup_info->ptr_lookup_params->lowercase_f) != 0 )
+  {
+    return 1;
+  }
+  item.len = token_len + 1;
+  arena_commit(ptr_arena, item.len);
 
-  // loop over input files
-  while(1)
+  return requester_enqueue(ptr_lookup_info, ptr_metrics, &item);
+}
+
+/**
+ * @brief Read a byte range of a file into a buffer, growing it as needed
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+static int read_range(int fd, char ** ptr_buf, size_t * ptr_size, size_t offset, size_t len)
+{
+  char * temp;
+  ssize_t num_read;
+
+  if(len > *ptr_size)
   {
-    // get next file index that has not been completed
-    pthread_mutex_lock(ptr_lookup_info->ptr_mutex);
-    curr_file_idx = ptr_lookup_info->rr_next_file;
-    int i;
-    for(i = curr_file_idx;
-        i != (curr_file_idx + ptr_lookup_params->num_input_files - 1) % ptr_lookup_params->num_input_files &&
-          ptr_lookup_info->file_done_f[i];
-        i = (i + 1) % ptr_lookup_params->num_input_files);
-    curr_file_idx = i;
-    ptr_lookup_info->rr_next_file = (curr_file_idx + 1) % ptr_lookup_params->num_input_files;
-    if(ptr_lookup_info->file_done_f[curr_file_idx])
+    if( (temp = (char *)realloc(*ptr_buf, len)) == NULL )
     {
-      pthread_mutex_unlock(ptr_lookup_info->ptr_mutex);
-      break;
+      return -1;
     }
-    pthread_mutex_unlock(ptr_lookup_info->ptr_mutex);
-
-    ptr_curr_file = ptr_lookup_params->input_files[curr_file_idx];
+    *ptr_buf = temp;
+    *ptr_size = len;
+  }
 
-    // loop through file
-    while(1)
+  for(size_t done = 0; done < len; done += num_read)
+  {
+    if( (num_read = pread(fd, *ptr_buf + done, len - done, offset + done)) <= 0 )
     {
-      // read next line
-      pthread_mutex_lock(ptr_curr_file->ptr_mutex);
-      if(ptr_curr_file->ptr_file == NULL)
-      {
-        pthread_mutex_unlock(ptr_curr_file->ptr_mutex);
-        break;
-      }
-      if( fscanf(ptr_curr_file->ptr_file, "%1024s", str_in) == EOF )
-      {
-        pthread_mutex_unlock(ptr_curr_file->ptr_mutex);
-        break;
-      }
-      pthread_mutex_unlock(ptr_curr_file->ptr_mutex);
-
-      // shorten string
-      str_in_len = strlen(str_in) + 1;
-      if( (temp_str_in = (char *)malloc(str_in_len)) == NULL )
-      {
-        break;
-      }
-      memcpy(temp_str_in, str_in, str_in_len);
+      return -1;
+    }
+  }
+
+  return 0;
+}
 
-      // write line to array
-      pthread_mutex_lock(ptr_lookup_info->ptr_mutex);
-      if( (ptr_lookup_info->ptr_domains = (char **)realloc(ptr_lookup_info->ptr_domains, (ptr_lookup_info->num_domains + 1) * sizeof(char *))) == NULL )
+/**
+ * @brief Read hostnames from daemon clients, one client at a time, until the daemon stops
+ *
+ * @return The number of clients served
+ */
+static int requester_serve(lookup_info_t * ptr_lookup_info, metrics_thread_t * ptr_metrics, int self)
+{
+  daemon_t * ptr_daemon = ptr_lookup_info->ptr_daemon;
+  autoscale_t * ptr_autoscale = ptr_lookup_info->ptr_autoscale;
+  daemon_client_t * ptr_client;
+  queue_item_t item;
+  const char * token;
+  int token_len;
+  int num_clients = 0;
+
+  while( autoscale_park(ptr_autoscale, &ptr_autoscale->requesters, self) == 0 &&
+         (ptr_client = daemon_accept(ptr_daemon)) != NULL )
+  {
+    num_clients++;
+    while( daemon_next(ptr_client, &token, &token_len) == 0 )
+    {
+      // the request is freed once its result has been sent back
+      if( (item.str = daemon_request(ptr_daemon, ptr_client, token, token_len)) == NULL )
       {
-        pthread_mutex_unlock(ptr_lookup_info->ptr_mutex);
-        break;
+        lockprof_lock(ptr_lookup_info->ptr_printf_mutex);
+        printf("Unable to malloc\n");
+        lockprof_unlock(ptr_lookup_info->ptr_printf_mutex);
+        exit(-1);
       }
-      if( (ptr_lookup_info->domains_len = (int *)realloc(ptr_lookup_info->domains_len, (ptr_lookup_info->num_domains + 1) * sizeof(int))) == NULL )
+      item.len = token_len + 1;
+      if(ptr_lookup_info->ptr_lookup_params->lowercase_f)
+      {
+        for(int i = 0; i < token_len; i++)
+        {
+          if(item.str[i] >= 'A' && item.str[i] <= 'Z')
+          {
+            item.str[i] += 'a' - 'A';
+          }
+        }
+      }
+      if( requester_enqueue(ptr_lookup_info, ptr_metrics, &item) != 0 )
       {
-        pthread_mutex_unlock(ptr_lookup_info->ptr_mutex);
         break;
       }
-      ptr_lookup_info->ptr_domains[ptr_lookup_info->num_domains] = temp_str_in;
-      ptr_lookup_info->domains_len[ptr_lookup_info->num_domains++] = str_in_len;
-      pthread_mutex_unlock(ptr_lookup_info->ptr_mutex);
     }
+    daemon_done(ptr_daemon, ptr_client);
+  }
+
+  return num_clients;
+}
+
+void * requester(void * arg)
+{
+  lookup_info_t * ptr_lookup_info = (lookup_info_t *)arg;
+  lookup_params_t * ptr_lookup_params = ptr_lookup_info->ptr_lookup_params;
+  autoscale_t * ptr_autoscale = ptr_lookup_info->ptr_autoscale;
+  int self = autoscale_index(&ptr_autoscale->requesters);
+  arena_t * ptr_arena = &ptr_lookup_info->arenas[self];
+  metrics_thread_t * ptr_metrics = NULL;
+  sched_task_t task;
+  file_t * ptr_curr_file;
+  int * serviced_f;
+  int num_files = 0;
+  int num_clients = 0;
 
-    // mark file as done and close
-    pthread_mutex_lock(ptr_lookup_info->ptr_mutex);
-    ptr_lookup_info->file_done_f[curr_file_idx] = 1;
-    pthread_mutex_unlock(ptr_lookup_info->ptr_mutex);
+  char * range_buf = NULL;
+  size_t range_size = 0;
+  const char * buf;
+  size_t pos, end;
 
-    num_files++;
+  // pin before allocating so the thread's memory lands on its node
+  if(ptr_lookup_info->ptr_numa != NULL)
+  {
+    numa_place(ptr_lookup_info->ptr_numa, NUMA_REQUESTERS, self);
   }
+  if( (serviced_f = (int *)calloc(ptr_lookup_params->num_input_files, sizeof(int))) == NULL )
+  {
+    lockprof_lock(ptr_lookup_info->ptr_printf_mutex);
+    printf("Unable to malloc\n");
+    lockprof_unlock(ptr_lookup_info->ptr_printf_mutex);
+    exit(-1);
+  }
+  if(ptr_lookup_info->ptr_metrics != NULL)
+  {
+    ptr_metrics = &ptr_lookup_info->ptr_metrics->requesters[self];
+    atomic_store(&ptr_metrics->used_f, 1);
+    atomic_store(&ptr_metrics->running_f, 1);
+  }
+
+  // a daemon has no files to schedule
+  if(ptr_lookup_info->ptr_daemon != NULL)
+  {
+    num_clients = requester_serve(ptr_lookup_info, ptr_metrics, self);
+  }
+
+  // run own tasks, then steal from the other requesters until none are left,
+  // parking whenever the pool is shrunk below this thread
+  while( ptr_lookup_info->ptr_daemon == NULL &&
+         autoscale_park(ptr_autoscale, &ptr_autoscale->requesters, self) == 0 &&
+         sched_next(ptr_lookup_info->ptr_sched, self, &task) == 0 )
+  {
+    ptr_curr_file = ptr_lookup_params->input_files[task.file_idx];
+    if(!serviced_f[task.file_idx])
+    {
+      serviced_f[task.file_idx] = 1;
+      num_files++;
+    }
+
+    if(ptr_curr_file->size == 0)
+    {
+      // a stream is one task, read it a block at a time and keep any
+      // hostname cut off at the end of a block for the next one
+      size_t kept = 0;
+      size_t num_read;
+      int ret = 0;
+
+      do
+      {
+        if( range_size < kept + TOKEN_STREAM_READ_SIZE )
+        {
+          char * temp;
+
+          if( (temp = (char *)realloc(range_buf, kept + TOKEN_STREAM_READ_SIZE)) == NULL )
+          {
+            lockprof_lock(ptr_lookup_info->ptr_printf_mutex);
+            printf("Unable to malloc\n");
+            lockprof_unlock(ptr_lookup_info->ptr_printf_mutex);
+            exit(-1);
+          }
+          range_buf = temp;
+          range_size = kept + TOKEN_STREAM_READ_SIZE;
+        }
+
+        // read next block
+        if(ptr_metrics != NULL)
+        {
+          long long start_ns = now_ns();
+          lockprof_lock(ptr_curr_file->ptr_mutex);
+          metrics_add(&ptr_metrics->lock_wait_ns, now_ns() - start_ns);
+        }
+        else
+        {
+          lockprof_lock(ptr_curr_file->ptr_mutex);
+        }
+        num_read = 0;
+        if(ptr_curr_file->ptr_file != NULL)
+        {
+          num_read = fread(range_buf + kept, 1, TOKEN_STREAM_READ_SIZE, ptr_curr_file->ptr_file);
+        }
+        lockprof_unlock(ptr_curr_file->ptr_mutex);
+
+        // at the end of the stream whatever was kept is the last hostname
+        end = kept + num_read;
+        if(num_read > 0)
+        {
+          end = tokenize_stream_end(range_buf, end);
+        }
+        pos = 0;
+        while( (ret = requester_push(ptr_lookup_info, ptr_metrics, ptr_arena, range_buf, end, &pos)) == 0 );
+
+        kept = kept + num_read - end;
+        memmove(range_buf, range_buf + end, kept);
+      } while(num_read > 0 && ret > 0);
+      continue;
+    }
+
+    // move the range to line boundaries, then tokenize it without locking
+    if(ptr_curr_file->map != NULL)
+    {
+      buf = ptr_curr_file->map;
+      pos = tokenize_chunk_start(buf, ptr_curr_file->size, task.start);
+      end = tokenize_chunk_start(buf, ptr_curr_file->size, task.end);
+    }
+    else
+    {
+      pos = tokenize_fd_chunk_start(fileno(ptr_curr_file->ptr_file), ptr_curr_file->size, task.start);
+      end = tokenize_fd_chunk_start(fileno(ptr_curr_file->ptr_file), ptr_curr_file->size, task.end);
+      if( read_range(fileno(ptr_curr_file->ptr_file), &range_buf, &range_size, pos, end - pos) != 0 )
+      {
+        lockprof_lock(ptr_lookup_info->ptr_printf_mutex);
+        printf("Unable to read %s\n", *ptr_curr_file->name);
+        lockprof_unlock(ptr_lookup_info->ptr_printf_mutex);
+        continue;
+      }
+      buf = range_buf;
+      end -= pos;
+      pos = 0;
+    }
+
+    while( requester_push(ptr_lookup_info, ptr_metrics, ptr_arena, buf, end, &pos) == 0 );
+  }
+
+  // no work is left, so parked requesters can exit and no more are started
+  autoscale_stop(ptr_autoscale, &ptr_autoscale->requesters);
 
   // print to serviced file
   ptr_curr_file = ptr_lookup_params->requester_log;
-  pthread_mutex_lock(ptr_curr_file->ptr_mutex);
-  fprintf(ptr_curr_file->ptr_file, "Thread %ld serviced %d files.\n", syscall(SYS_gettid), num_files);
-  pthread_mutex_unlock(ptr_curr_file->ptr_mutex);
+  lockprof_lock(ptr_curr_file->ptr_mutex);
+  if(ptr_lookup_info->ptr_daemon != NULL)
+  {
+    fprintf(ptr_curr_file->ptr_file, "Thread %ld serviced %d clients.\n", syscall(SYS_gettid), num_clients);
+  }
+  else
+  {
+    fprintf(ptr_curr_file->ptr_file, "Thread %ld serviced %d files.\n", syscall(SYS_gettid), num_files);
+  }
+  lockprof_unlock(ptr_curr_file->ptr_mutex);
 
-  free((void *)str_in);
+  free((void *)range_buf);
+  free((void *)serviced_f);
+  if(ptr_metrics != NULL)
+  {
+    atomic_store(&ptr_metrics->running_f, 0);
+  }
+
+  // the last requester out tells the resolvers no more hostnames are coming
+  if( autoscale_exit(ptr_autoscale, &ptr_autoscale->requesters) )
+  {
+    queue_close(ptr_lookup_info->ptr_queue);
+    if(ptr_lookup_info->ptr_partition != NULL)
+    {
+      partition_close(ptr_lookup_info->ptr_partition);
+    }
+    autoscale_stop(ptr_autoscale, &ptr_autoscale->resolvers);
+  }
 
   pthread_exit(0);
 }
 
+/**
+ * @brief Give a resolver's log buffer the thread's metrics slot, if metrics are kept
+ */
+static void resolver_metrics(lookup_info_t * ptr_lookup_info, logbuf_t * ptr_log, int self)
+{
+  if(ptr_lookup_info->ptr_metrics != NULL)
+  {
+    ptr_log->ptr_metrics = &ptr_lookup_info->ptr_metrics->resolvers[self];
+    atomic_store(&ptr_log->ptr_metrics->used_f, 1);
+    atomic_store(&ptr_log->ptr_metrics->running_f, 1);
+  }
+}
+
+/**
+ * @brief Count whether the cache answered a hostname, if metrics are kept
+ *
+ * A name shared with a lookup already in flight counts as answered.
+ */
+static void resolver_cached(logbuf_t * ptr_log, int claim)
+{
+  if(ptr_log->ptr_metrics != NULL)
+  {
+    metrics_add(claim == CACHE_CLAIMED ? &ptr_log->ptr_metrics->cache_misses : &ptr_log->ptr_metrics->cache_hits, 1);
+  }
+}
+
+/**
+ * @brief Count time a resolver spent waiting for a hostname
+ */
+static void resolver_idle(lookup_info_t * ptr_lookup_info, logbuf_t * ptr_log, long long idle_ns)
+{
+  atomic_fetch_add_explicit(&ptr_lookup_info->ptr_autoscale->resolver_idle_ns, idle_ns, memory_order_relaxed);
+  if(ptr_log->ptr_metrics != NULL)
+  {
+    metrics_add(&ptr_log->ptr_metrics->idle_ns, idle_ns);
+  }
+}
+
+/**
+ * @brief Pick the queue and cache a resolver works from
+ *
+ * With --partition they are the thread's own, otherwise the shared ones.
+ */
+static void resolver_partition(lookup_info_t * ptr_lookup_info, int self, queue_t ** ptr_queue, cache_t ** ptr_cache)
+{
+  if(ptr_lookup_info->ptr_partition != NULL)
+  {
+    *ptr_queue = ptr_lookup_info->ptr_partition->queues[self];
+    *ptr_cache = ptr_lookup_info->ptr_partition->caches[self];
+  }
+  else
+  {
+    *ptr_queue = ptr_lookup_info->ptr_queue;
+    *ptr_cache = ptr_lookup_info->ptr_cache;
+  }
+}
+
+/**
+ * @brief How many hostnames a resolver should claim at once
+ *
+ * An even share of the queue between the active resolvers, so a short
+ * queue is still spread over all of them, up to the --batch limit. A
+ * resolver's own queue is all its share.
+ */
+static size_t resolver_batch_size(lookup_info_t * ptr_lookup_info, queue_t * ptr_queue)
+{
+  size_t max = ptr_lookup_info->ptr_lookup_params->batch_size;
+  size_t share = queue_depth(ptr_queue);
+
+  if(ptr_lookup_info->ptr_partition == NULL)
+  {
+    share /= atomic_load_explicit(&ptr_lookup_info->ptr_autoscale->resolvers.target, memory_order_relaxed);
+  }
+
+  return share < 1 ? 1 : share > max ? max : share;
+}
+
 void * resolver(void * arg)
 {
   lookup_info_t * ptr_lookup_info = (lookup_info_t *)arg;
   lookup_params_t * ptr_lookup_params = ptr_lookup_info->ptr_lookup_params;
   file_t * ptr_resolver_log = ptr_lookup_params->resolver_log;
-  int domain_idx;
-  char * ptr_domain_str;
-  int domain_len;
-  char ip_str[INET6_ADDRSTRLEN];
+  queue_t * ptr_queue;
+  cache_t * ptr_cache;
+  queue_item_t item;
+  addr_set_t addrs;
   int dns_ret;
+  int claim;
+  int ttl_s;
+  logbuf_t log;
+  autoscale_t * ptr_autoscale = ptr_lookup_info->ptr_autoscale;
+  int self = autoscale_index(&ptr_autoscale->resolvers);
+  long long start_ns;
+  int pop_ret;
+  queue_item_t * batch;
+  size_t batch_len = 0;
+  size_t batch_pos = 0;
+
+  // pin before allocating so the thread's memory lands on its node
+  if(ptr_lookup_info->ptr_numa != NULL)
+  {
+    numa_place(ptr_lookup_info->ptr_numa, NUMA_RESOLVERS, self);
+  }
+  if( logbuf_init(&log, fileno(ptr_resolver_log->ptr_file), ptr_resolver_log->ptr_mutex, ptr_lookup_params->log_buffer) != 0 ||
+      (batch = (queue_item_t *)malloc(sizeof(queue_item_t) * ptr_lookup_params->batch_size)) == NULL )
+  {
+    lockprof_lock(ptr_lookup_info->ptr_printf_mutex);
+    printf("Unable to malloc\n");
+    lockprof_unlock(ptr_lookup_info->ptr_printf_mutex);
+    exit(-1);
+  }
+  resolver_metrics(ptr_lookup_info, &log, self);
+  resolver_partition(ptr_lookup_info, self, &ptr_queue, &ptr_cache);
 
   while(1)
   {
-    pthread_mutex_lock(ptr_lookup_info->ptr_mutex);
+    // the claimed batch is always finished before parking or refilling
+    if(batch_pos == batch_len)
+    {
+      // park while the pool is shrunk below this thread
+      if(self >= atomic_load_explicit(&ptr_autoscale->resolvers.target, memory_order_relaxed))
+      {
+        logbuf_flush(&log);
+        if( autoscale_park(ptr_autoscale, &ptr_autoscale->resolvers, self) != 0 )
+        {
+          break;
+        }
+      }
+
+      // claim the next domains, writing out buffered results before sleeping
+      // until one arrives or the requesters are done
+      batch_pos = 0;
+      if( (batch_len = queue_pop_batch(ptr_queue, batch, resolver_batch_size(ptr_lookup_info, ptr_queue))) == 0 )
+      {
+        logbuf_flush(&log);
+        start_ns = now_ns();
+        pop_ret = queue_pop_wait(ptr_queue, &batch[0]);
+        resolver_idle(ptr_lookup_info, &log, now_ns() - start_ns);
+        if(pop_ret != 0)
+        {
+          break;
+        }
+        batch_len = 1;
+      }
+    }
+    item = batch[batch_pos++];
+    if(log.ptr_metrics != NULL && item.enqueue_ns != 0)
+    {
+      metrics_record(log.ptr_metrics, METRICS_QUEUE, now_ns() - item.enqueue_ns);
+    }
+
+    // get IP, asking the cache first and sharing any lookup already in flight
+    claim = cache_claim(ptr_cache, item.str, &addrs, NULL);
+    resolver_cached(&log, claim);
+    switch(claim)
+    {
+      case CACHE_HIT:
+        dns_ret = UTIL_SUCCESS;
+        break;
+
+      case CACHE_FAILED:
+        dns_ret = UTIL_FAILURE;
+        break;
+
+      default:
+        // a previous run may already know the name
+        if( ptr_lookup_info->ptr_diskcache != NULL &&
+            diskcache_get(ptr_lookup_info->ptr_diskcache, item.str, &addrs, &ttl_s) == 0 )
+        {
+          dns_ret = UTIL_SUCCESS;
+          cache_complete(ptr_cache, item.str, 0, &addrs, ttl_s);
+          break;
+        }
+        if(ptr_lookup_info->ptr_limit != NULL)
+        {
+          limit_acquire(ptr_lookup_info->ptr_limit);
+        }
+        start_ns = now_ns();
+        dns_ret = backend_lookup(ptr_lookup_params->ptr_backend, item.str, &addrs);
+        start_ns = now_ns() - start_ns;
+        if(ptr_lookup_info->ptr_limit != NULL)
+        {
+          limit_release(ptr_lookup_info->ptr_limit, start_ns, dns_ret != UTIL_SUCCESS);
+        }
+        atomic_fetch_add_explicit(&ptr_autoscale->lookup_ns, start_ns, memory_order_relaxed);
+        if(log.ptr_metrics != NULL)
+        {
+          metrics_record(log.ptr_metrics, METRICS_LOOKUP, start_ns);
+        }
+        atomic_fetch_add_explicit(&ptr_autoscale->lookups, 1, memory_order_relaxed);
+        cache_complete(ptr_cache, item.str, dns_ret == UTIL_SUCCESS ? 0 : -1, &addrs, ptr_lookup_params->cache_ttl);
+        break;
+    }
+
+    // buffer for the log, the hostname stays in its requester's arena
+    write_result(ptr_lookup_info, &log, item.str, dns_ret, &addrs);
+  }
+
+  if(log.ptr_metrics != NULL)
+  {
+    atomic_store(&log.ptr_metrics->running_f, 0);
+  }
+  logbuf_free(&log);
+  free((void *)batch);
+  autoscale_exit(ptr_autoscale, &ptr_autoscale->resolvers);
+
+  pthread_exit(0);
+}
+
+/**
+ * @brief Cache and log a finished asynchronous query
+ *
+ * The record's own TTL is used, capped by the configured cache TTL.
+ */
+static void resolver_async_done(void * ptr_user, void * ctx, int status, const addr_set_t * ptr_addrs, int ttl_s)
+{
+  resolver_ctx_t * ptr_ctx = (resolver_ctx_t *)ptr_user;
+  lookup_params_t * ptr_lookup_params = ptr_ctx->ptr_lookup_info->ptr_lookup_params;
 
-    // check if there are any domains to read or if all files are done
-    if(ptr_lookup_info->num_domains <= 0)
+  cache_complete(ptr_ctx->ptr_cache, (char *)ctx, status, ptr_addrs,
+                 ttl_s < ptr_lookup_params->cache_ttl ? ttl_s : ptr_lookup_params->cache_ttl);
+  write_result(ptr_ctx->ptr_lookup_info, &ptr_ctx->log, (char *)ctx, status == 0 ? UTIL_SUCCESS : UTIL_FAILURE,
+               ptr_addrs);
+}
+
+/**
+ * @brief Time an answered asynchronous query, then cache and log it
+ */
+static void resolver_async_answer(void * ptr_user, void * ctx, int status, const addr_set_t * ptr_addrs, int ttl_s)
+{
+  resolver_ctx_t * ptr_ctx = (resolver_ctx_t *)ptr_user;
+
+  if(ptr_ctx->log.ptr_metrics != NULL)
+  {
+    metrics_record(ptr_ctx->log.ptr_metrics, METRICS_LOOKUP, ptr_ctx->ptr_engine->last_elapsed_ns);
+  }
+  if(ptr_ctx->ptr_lookup_info->ptr_limit != NULL)
+  {
+    limit_release(ptr_ctx->ptr_lookup_info->ptr_limit, ptr_ctx->ptr_engine->last_elapsed_ns, status != 0);
+  }
+  resolver_async_done(ptr_user, ctx, status, ptr_addrs, ttl_s);
+}
+
+void * resolver_async(void * arg)
+{
+  lookup_info_t * ptr_lookup_info = (lookup_info_t *)arg;
+  lookup_params_t * ptr_lookup_params = ptr_lookup_info->ptr_lookup_params;
+  file_t * ptr_resolver_log = ptr_lookup_params->resolver_log;
+  queue_t * ptr_queue;
+  cache_t * ptr_cache;
+  dns_engine_t * ptr_engine;
+  queue_item_t item;
+  addr_set_t addrs;
+  int closed_f = 0;
+  cache_flight_t ** pending_flights;
+  char ** pending_names;
+  int num_pending = 0;
+  int ret;
+  int ttl_s;
+  resolver_ctx_t ctx;
+  autoscale_t * ptr_autoscale = ptr_lookup_info->ptr_autoscale;
+  int self = autoscale_index(&ptr_autoscale->resolvers);
+  long long start_ns;
+  limit_t * ptr_limit = ptr_lookup_info->ptr_limit;
+  int submitted_f;
+
+  // pin before allocating so the thread's memory lands on its node
+  if(ptr_lookup_info->ptr_numa != NULL)
+  {
+    numa_place(ptr_lookup_info->ptr_numa, NUMA_RESOLVERS, self);
+  }
+
+  ctx.ptr_lookup_info = ptr_lookup_info;
+  resolver_partition(ptr_lookup_info, self, &ptr_queue, &ptr_cache);
+  ctx.ptr_cache = ptr_cache;
+  if( logbuf_init(&ctx.log, fileno(ptr_resolver_log->ptr_file), ptr_resolver_log->ptr_mutex, ptr_lookup_params->log_buffer) != 0 )
+  {
+    lockprof_lock(ptr_lookup_info->ptr_printf_mutex);
+    printf("Unable to malloc\n");
+    lockprof_unlock(ptr_lookup_info->ptr_printf_mutex);
+    exit(-1);
+  }
+
+  if( dns_engine_init(&ptr_engine, (struct sockaddr *)&ptr_lookup_params->dns_server, ptr_lookup_params->dns_server_len,
+                      ptr_lookup_params->max_inflight, ptr_lookup_params->dns_timeout_ms, ptr_lookup_params->dns_retries,
+                      ptr_lookup_params->all_addresses_f) != 0 )
+  {
+    lockprof_lock(ptr_lookup_info->ptr_printf_mutex);
+    printf("Unable to create DNS engine\n");
+    lockprof_unlock(ptr_lookup_info->ptr_printf_mutex);
+    exit(-1);
+  }
+  ctx.ptr_engine = ptr_engine;
+  resolver_metrics(ptr_lookup_info, &ctx.log, self);
+
+  // names waiting on another resolver's lookup
+  if( (pending_flights = (cache_flight_t **)malloc(sizeof(cache_flight_t *) * ptr_lookup_params->max_inflight)) == NULL ||
+      (pending_names = (char **)malloc(sizeof(char *) * ptr_lookup_params->max_inflight)) == NULL )
+  {
+    lockprof_lock(ptr_lookup_info->ptr_printf_mutex);
+    printf("Unable to malloc\n");
+    lockprof_unlock(ptr_lookup_info->ptr_printf_mutex);
+    exit(-1);
+  }
+
+  while(!closed_f || ptr_engine->num_inflight > 0 || num_pending > 0)
+  {
+    // top up queries in flight, only sleeping on the queue when idle
+    while(!closed_f && ptr_engine->num_inflight + num_pending < ptr_engine->max_inflight)
     {
-      int i;
-      for(i = 0; i < ptr_lookup_params->num_input_files && ptr_lookup_info->file_done_f[i]; i++);
-      if(i == ptr_lookup_params->num_input_files)
+      if(ptr_engine->num_inflight == 0 && num_pending == 0)
       {
-        pthread_mutex_unlock(ptr_lookup_info->ptr_mutex);
+        // park while the pool is shrunk below this thread
+        logbuf_flush(&ctx.log);
+        if( autoscale_park(ptr_autoscale, &ptr_autoscale->resolvers, self) != 0 )
+        {
+          closed_f = 1;
+          break;
+        }
+
+        start_ns = now_ns();
+        ret = queue_pop_wait(ptr_queue, &item);
+        resolver_idle(ptr_lookup_info, &ctx.log, now_ns() - start_ns);
+        if(ret != 0)
+        {
+          closed_f = 1;
+          break;
+        }
+
+        // with nothing in flight this thread holds no slot, so it can sleep for one
+        if(ptr_limit != NULL)
+        {
+          limit_acquire(ptr_limit);
+        }
+      }
+      else if( self >= atomic_load_explicit(&ptr_autoscale->resolvers.target, memory_order_relaxed) ||
+               (ptr_limit != NULL && limit_try_acquire(ptr_limit) != 0) )
+      {
+        // a thread about to park drains its queries first, and one over the
+        // limit collects answers until a slot is free
         break;
       }
-      pthread_mutex_unlock(ptr_lookup_info->ptr_mutex);
-      continue;
+      else if( queue_pop(ptr_queue, &item) != 0 )
+      {
+        if(ptr_limit != NULL)
+        {
+          limit_cancel(ptr_limit);
+        }
+        break;
+      }
+      if(ctx.log.ptr_metrics != NULL && item.enqueue_ns != 0)
+      {
+        metrics_record(ctx.log.ptr_metrics, METRICS_QUEUE, now_ns() - item.enqueue_ns);
+      }
+
+      // cached names need no query and give their slot back, names that
+      // cannot be sent fail right away
+      submitted_f = 0;
+      ret = cache_claim(ptr_cache, item.str, &addrs, &pending_flights[num_pending]);
+      resolver_cached(&ctx.log, ret);
+      switch(ret)
+      {
+        case CACHE_HIT:
+        case CACHE_FAILED:
+          write_result(ptr_lookup_info, &ctx.log, item.str, ret == CACHE_HIT ? UTIL_SUCCESS : UTIL_FAILURE, &addrs);
+          break;
+
+        case CACHE_PENDING:
+          pending_names[num_pending++] = item.str;
+          break;
+
+        default:
+          if( ptr_lookup_info->ptr_diskcache != NULL &&
+              diskcache_get(ptr_lookup_info->ptr_diskcache, item.str, &addrs, &ttl_s) == 0 )
+          {
+            resolver_async_done(&ctx, item.str, 0, &addrs, ttl_s);
+          }
+          else if( dns_engine_submit(ptr_engine, item.str, item.str) != 0 )
+          {
+            resolver_async_done(&ctx, item.str, -1, NULL, 0);
+          }
+          else
+          {
+            submitted_f = 1;
+          }
+          break;
+      }
+      if(!submitted_f && ptr_limit != NULL)
+      {
+        limit_cancel(ptr_limit);
+      }
+    }
+
+    // collect answers, waking up now and then to pick up new names
+    if(ptr_engine->num_inflight > 0 || num_pending > 0)
+    {
+      dns_engine_poll(ptr_engine, closed_f && num_pending == 0 ? -1 : ASYNC_POLL_MS, resolver_async_answer, &ctx);
     }
 
-    // read next domain
-    domain_idx = --ptr_lookup_info->num_domains;
-    domain_len = ptr_lookup_info->domains_len[domain_idx];
-    if( (ptr_domain_str = (char *)malloc(domain_len)) == NULL )
+    // log names whose shared lookup has finished
+    for(int i = 0; i < num_pending; i++)
+    {
+      if( (ret = cache_flight_poll(pending_flights[i], &addrs)) != CACHE_PENDING )
+      {
+        write_result(ptr_lookup_info, &ctx.log, pending_names[i], ret == CACHE_HIT ? UTIL_SUCCESS : UTIL_FAILURE,
+                     &addrs);
+        num_pending--;
+        pending_flights[i] = pending_flights[num_pending];
+        pending_names[i--] = pending_names[num_pending];
+      }
+    }
+  }
+
+  dns_engine_free(ptr_engine);
+  free((void *)pending_flights);
+  free((void *)pending_names);
+  if(ctx.log.ptr_metrics != NULL)
+  {
+    atomic_store(&ctx.log.ptr_metrics->running_f, 0);
+  }
+  logbuf_free(&ctx.log);
+  autoscale_exit(ptr_autoscale, &ptr_autoscale->resolvers);
+
+  pthread_exit(0);
+}
+
+/**
+ * @brief Add the queue gauges to a live metrics scrape
+ *
+ * Queue depths are read from their head and tail counters, so a scrape
+ * never takes a lock the pipeline uses.
+ */
+static void live_gauges(void * ptr_user, FILE * ptr_out)
+{
+  lookup_info_t * ptr_lookup_info = (lookup_info_t *)ptr_user;
+  partition_t * ptr_partition = ptr_lookup_info->ptr_partition;
+  size_t depth = queue_depth(ptr_lookup_info->ptr_queue);
+  size_t capacity = ptr_lookup_info->ptr_queue->mask + 1;
+
+  if(ptr_partition != NULL)
+  {
+    depth = 0;
+    capacity = 0;
+    for(int i = 0; i < ptr_partition->num_partitions; i++)
     {
-      
+      depth += queue_depth(ptr_partition->queues[i]);
+      capacity += ptr_partition->queues[i]->mask + 1;
     }
-    strcpy(ptr_domain_str, ptr_lookup_info->ptr_domains[domain_idx]);
-    free((void *)ptr_lookup_info->ptr_domains[domain_idx]);
-    if(ptr_lookup_info->num_domains > 0)
+  }
+
+  fprintf(ptr_out, "# HELP multilookup_queue_depth Hostnames waiting for a resolver.\n"
+          "# TYPE multilookup_queue_depth gauge\nmultilookup_queue_depth %zu\n", depth);
+  fprintf(ptr_out, "# HELP multilookup_queue_capacity Most hostnames that can wait for a resolver.\n"
+          "# TYPE multilookup_queue_capacity gauge\nmultilookup_queue_capacity %zu\n", capacity);
+}
+
+void write_result(lookup_info_t * ptr_lookup_info, logbuf_t * ptr_log, char * hostname, int status,
+                  const addr_set_t * ptr_addrs)
+{
+  char ip_strs[ADDR_SET_MAX][INET6_ADDRSTRLEN];
+  const char * pieces[1 + 2 * ADDR_SET_MAX] = {hostname, ","};
+  int num_pieces = 2;
+  int all_f = ptr_lookup_info->ptr_lookup_params->all_addresses_f;
+
+  if(status == UTIL_SUCCESS && all_f)
+  {
+    for(int i = 0; i < ptr_addrs->count; i++)
     {
-      if( (ptr_lookup_info->ptr_domains = (char **)realloc(ptr_lookup_info->ptr_domains, ptr_lookup_info->num_domains * sizeof(char **))) == NULL )
+      if(i > 0)
       {
+        pieces[num_pieces++] = ",";
       }
-      if( (ptr_lookup_info->domains_len = realloc(ptr_lookup_info->domains_len, ptr_lookup_info->num_domains * sizeof(int))) == NULL )
+      pieces[num_pieces++] = addr_format(&ptr_addrs->addrs[i], ip_strs[i]);
+    }
+  }
+  else if(status == UTIL_SUCCESS)
+  {
+    // a single address is the first IPv4 one, as it always was, whatever
+    // order a hosts file, trace or cache file lists them in
+    int first = 0;
+    for(int i = 0; i < ptr_addrs->count; i++)
+    {
+      if(ptr_addrs->addrs[i].family == ADDR_V4)
       {
+        first = i;
+        break;
       }
     }
-    else
+    pieces[num_pieces++] = addr_format(&ptr_addrs->addrs[first], ip_strs[0]);
+  }
+
+  logbuf_line(ptr_log, pieces, num_pieces);
+  if(ptr_log->ptr_metrics != NULL)
+  {
+    metrics_add(&ptr_log->ptr_metrics->names, 1);
+    if(status != UTIL_SUCCESS)
+    {
+      metrics_add(&ptr_log->ptr_metrics->failed, 1);
+    }
+  }
+  if(ptr_lookup_info->ptr_daemon != NULL)
+  {
+    daemon_reply(hostname, pieces, num_pieces);
+  }
+}
+
+/**
+ * @brief Split every regular input file into byte-range tasks, and every stream into one
+ *
+ * @return The tasks, or NULL if they could not be allocated
+ */
+static sched_task_t * build_tasks(lookup_params_t * ptr_lookup_params, size_t * ptr_num_tasks)
+{
+  sched_task_t * tasks;
+  size_t num_tasks = 0;
+
+  for(int i = 0; i < ptr_lookup_params->num_input_files; i++)
+  {
+    num_tasks += ptr_lookup_params->input_files[i]->size > 0 ?
+      (ptr_lookup_params->input_files[i]->size + ptr_lookup_params->chunk_size - 1) / ptr_lookup_params->chunk_size : 1;
+  }
+  if( (tasks = (sched_task_t *)malloc(sizeof(sched_task_t) * num_tasks)) == NULL )
+  {
+    return NULL;
+  }
+  num_tasks = 0;
+  for(int i = 0; i < ptr_lookup_params->num_input_files; i++)
+  {
+    size_t offset = 0;
+    do
     {
-      free((void *)ptr_lookup_info->ptr_domains);
-      free((void *)ptr_lookup_info->domains_len);
-      ptr_lookup_info->ptr_domains = NULL;
-      ptr_lookup_info->domains_len = NULL;
+      tasks[num_tasks].file_idx = i;
+      tasks[num_tasks].start = offset;
+      offset += ptr_lookup_params->chunk_size;
+      tasks[num_tasks++].end = offset;
+    } while(offset < ptr_lookup_params->input_files[i]->size);
+  }
+
+  *ptr_num_tasks = num_tasks;
+  return tasks;
+}
+
+/**
+ * @brief Free whichever parts of a run were created
+ *
+ * Every thread must have finished. Reports are printed before this, since
+ * they read the parts it frees.
+ */
+static void lookup_teardown(lookup_info_t * ptr_lookup_info)
+{
+  if(ptr_lookup_info->ptr_autoscale != NULL)
+  {
+    autoscale_free(ptr_lookup_info->ptr_autoscale);
+  }
+  if(ptr_lookup_info->ptr_numa != NULL)
+  {
+    numa_free(ptr_lookup_info->ptr_numa);
+  }
+  if(ptr_lookup_info->ptr_limit != NULL)
+  {
+    limit_free(ptr_lookup_info->ptr_limit);
+  }
+  if(ptr_lookup_info->ptr_metrics != NULL)
+  {
+    metrics_free(ptr_lookup_info->ptr_metrics);
+  }
+  if(ptr_lookup_info->ptr_daemon != NULL)
+  {
+    daemon_free(ptr_lookup_info->ptr_daemon);
+  }
+  if(ptr_lookup_info->ptr_diskcache != NULL)
+  {
+    diskcache_free(ptr_lookup_info->ptr_diskcache);
+  }
+  if(ptr_lookup_info->ptr_partition != NULL)
+  {
+    partition_free(ptr_lookup_info->ptr_partition);
+  }
+  if(ptr_lookup_info->ptr_cache != NULL)
+  {
+    cache_free(ptr_lookup_info->ptr_cache);
+  }
+
+  // release every hostname at once
+  if(ptr_lookup_info->arenas != NULL)
+  {
+    for(int i = 0; i < ptr_lookup_info->num_arenas; i++)
+    {
+      arena_free(&ptr_lookup_info->arenas[i]);
     }
+    free((void *)ptr_lookup_info->arenas);
+  }
+  if(ptr_lookup_info->ptr_sched != NULL)
+  {
+    sched_free(ptr_lookup_info->ptr_sched);
+  }
+  if(ptr_lookup_info->ptr_printf_mutex != NULL)
+  {
+    lockprof_mutex_destroy(ptr_lookup_info->ptr_printf_mutex);
+    free((void *)ptr_lookup_info->ptr_printf_mutex);
+  }
+  if(ptr_lookup_info->ptr_queue != NULL)
+  {
+    queue_free(ptr_lookup_info->ptr_queue);
+  }
+  free((void *)ptr_lookup_info);
+}
 
-    pthread_mutex_unlock(ptr_lookup_info->ptr_mutex);
+/**
+ * @brief Create everything one run of the pipeline needs, short of its threads
+ *
+ * Both pools may grow from their minimum to their maximum, and the
+ * arenas and metrics slots are sized for the maximum. Whatever was
+ * created before a failure is freed again.
+ *
+ * @param ptr_lookup_params A pointer to the parameters
+ * @param min_requester The fewest requester threads
+ * @param max_requester The most requester threads
+ * @param min_resolver The fewest resolver threads
+ * @param max_resolver The most resolver threads
+ * @param ptr_lookup_info A pointer to the uninitialized run pointer
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+static int lookup_setup(lookup_params_t * ptr_lookup_params, int min_requester, int max_requester, int min_resolver,
+                        int max_resolver, lookup_info_t ** ptr_lookup_info)
+{
+  lookup_info_t * ptr_info;
+  sched_task_t * tasks;
+  size_t num_tasks;
 
-    // get IP
-    dns_ret = dnslookup(ptr_domain_str, ip_str, INET6_ADDRSTRLEN);
+  // every part starts out NULL, so a failure frees only what exists
+  if( (ptr_info = (lookup_info_t *)calloc(1, sizeof(lookup_info_t))) == NULL )
+  {
+    printf("Unable to malloc\n");
+    return -1;
+  }
+  ptr_info->ptr_lookup_params = ptr_lookup_params;
 
-    // write to file
-    pthread_mutex_lock(ptr_resolver_log->ptr_mutex);
-    if(dns_ret == UTIL_SUCCESS)
+  // create shared hostname queue
+  if( queue_init(&ptr_info->ptr_queue, ptr_lookup_params->queue_size) != 0 )
+  {
+    printf("Unable to malloc\n");
+    ptr_info->ptr_queue = NULL;
+    lookup_teardown(ptr_info);
+    return -1;
+  }
+
+  // create resolution cache, which also shares lookups in flight when it has no memory
+  if( cache_init(&ptr_info->ptr_cache, ptr_lookup_params->cache_size, ptr_lookup_params->cache_shards,
+                 ptr_lookup_params->negative_cache_size, ptr_lookup_params->negative_ttl) != 0 )
+  {
+    printf("Unable to malloc\n");
+    ptr_info->ptr_cache = NULL;
+    lookup_teardown(ptr_info);
+    return -1;
+  }
+
+  // split every regular file into byte ranges, streams are a single task, and
+  // deal the tasks out to one deque per requester the pool can grow to
+  if( (tasks = build_tasks(ptr_lookup_params, &num_tasks)) == NULL )
+  {
+    printf("Unable to malloc\n");
+    lookup_teardown(ptr_info);
+    return -1;
+  }
+  if( sched_init(&ptr_info->ptr_sched, tasks, num_tasks, max_requester) != 0 )
+  {
+    printf("Unable to malloc\n");
+    ptr_info->ptr_sched = NULL;
+    free((void *)tasks);
+    lookup_teardown(ptr_info);
+    return -1;
+  }
+
+  // create one hostname arena per requester, freed only once every resolver is done
+  if( (ptr_info->arenas = (arena_t *)malloc(sizeof(arena_t) * max_requester)) == NULL )
+  {
+    printf("Unable to malloc\n");
+    lookup_teardown(ptr_info);
+    return -1;
+  }
+  ptr_info->num_arenas = max_requester;
+  for(int i = 0; i < max_requester; i++)
+  {
+    arena_init(&ptr_info->arenas[i], ARENA_DEFAULT_BLOCK_SIZE);
+  }
+
+  // create printf mutex
+  if( (ptr_info->ptr_printf_mutex = (lockprof_mutex_t *)malloc(sizeof(lockprof_mutex_t))) == NULL )
+  {
+    printf("Unable to malloc\n");
+    lookup_teardown(ptr_info);
+    return -1;
+  }
+  lockprof_mutex_init(ptr_info->ptr_printf_mutex, "printf");
+
+  // map the cache file left by earlier runs
+  if( ptr_lookup_params->cache_file != NULL &&
+      diskcache_open(&ptr_info->ptr_diskcache, ptr_lookup_params->cache_file) != 0 )
+  {
+    printf("Unable to malloc\n");
+    ptr_info->ptr_diskcache = NULL;
+    lookup_teardown(ptr_info);
+    return -1;
+  }
+
+  // create a metrics slot for every thread the pools can grow to, which a
+  // sweep reads its latency percentiles from
+  if( ptr_lookup_params->metrics_file != NULL || ptr_lookup_params->metrics_socket != NULL ||
+      ptr_lookup_params->sweep_file != NULL )
+  {
+    if( metrics_init(&ptr_info->ptr_metrics, ptr_lookup_params->metrics_file, ptr_lookup_params->metrics_interval,
+                     max_requester, max_resolver) != 0 )
     {
-      fprintf(ptr_resolver_log->ptr_file, "%s,%s\n", ptr_domain_str, ip_str);
+      if(ptr_lookup_params->metrics_file != NULL)
+      {
+        printf("Unable to write metrics to %s\n", ptr_lookup_params->metrics_file);
+      }
+      else
+      {
+        printf("Unable to malloc\n");
+      }
+      ptr_info->ptr_metrics = NULL;
+      lookup_teardown(ptr_info);
+      return -1;
     }
-    else
+    if( ptr_lookup_params->metrics_socket != NULL &&
+        metrics_listen(ptr_info->ptr_metrics, ptr_lookup_params->metrics_socket, live_gauges, (void *)ptr_info) != 0 )
     {
-      fprintf(ptr_resolver_log->ptr_file, "%s,\n", ptr_domain_str);
+      printf("Unable to listen on %s\n", ptr_lookup_params->metrics_socket);
+      lookup_teardown(ptr_info);
+      return -1;
     }
-    pthread_mutex_unlock(ptr_resolver_log->ptr_mutex);
+  }
 
-    free((void *)ptr_domain_str);
+  // listen for hostnames before any thread exists, so only one thread takes signals
+  if( ptr_lookup_params->daemon_spec != NULL &&
+      daemon_init(&ptr_info->ptr_daemon, ptr_lookup_params->daemon_spec) != 0 )
+  {
+    printf("Unable to listen on %s, --daemon should be stdin or unix:PATH\n", ptr_lookup_params->daemon_spec);
+    ptr_info->ptr_daemon = NULL;
+    lookup_teardown(ptr_info);
+    return -1;
   }
 
-  pthread_exit(0);
+  // read the node layout and move the queue to the nodes its threads run on
+  if( ptr_lookup_params->requester_cpus != NULL || ptr_lookup_params->resolver_cpus != NULL )
+  {
+    const char * ptr_bad = NULL;
+    if( numa_init(&ptr_info->ptr_numa) != 0 )
+    {
+      printf("Unable to malloc\n");
+      ptr_info->ptr_numa = NULL;
+      lookup_teardown(ptr_info);
+      return -1;
+    }
+    if( ptr_lookup_params->requester_cpus != NULL &&
+        numa_set_pool(ptr_info->ptr_numa, NUMA_REQUESTERS, ptr_lookup_params->requester_cpus) != 0 )
+    {
+      ptr_bad = ptr_lookup_params->requester_cpus;
+    }
+    else if( ptr_lookup_params->resolver_cpus != NULL &&
+             numa_set_pool(ptr_info->ptr_numa, NUMA_RESOLVERS, ptr_lookup_params->resolver_cpus) != 0 )
+    {
+      ptr_bad = ptr_lookup_params->resolver_cpus;
+    }
+    if( ptr_bad != NULL )
+    {
+      printf("Unable to run on %s, CPUs should be numa or a list such as 0-3,8 of CPUs this process may use\n",
+             ptr_bad);
+      lookup_teardown(ptr_info);
+      return -1;
+    }
+    numa_bind_shared(ptr_info->ptr_numa, ptr_info->ptr_queue->slots,
+                     sizeof(queue_slot_t) * (ptr_info->ptr_queue->mask + 1));
+  }
+
+  // an adaptive limit may grow to every lookup the resolvers could have outstanding
+  if( ptr_lookup_params->concurrency_limit > 0 || ptr_lookup_params->limit_adaptive_f )
+  {
+    int max_limit = ptr_lookup_params->concurrency_limit;
+    if(ptr_lookup_params->limit_adaptive_f)
+    {
+      max_limit = max_resolver * (ptr_lookup_params->async_f ? ptr_lookup_params->max_inflight : 1);
+    }
+    if( limit_init(&ptr_info->ptr_limit, max_limit, ptr_lookup_params->limit_adaptive_f) != 0 )
+    {
+      printf("Unable to malloc\n");
+      ptr_info->ptr_limit = NULL;
+      lookup_teardown(ptr_info);
+      return -1;
+    }
+  }
+
+  // give every resolver its own queue and cache, split from the shared bounds
+  if(ptr_lookup_params->partition_f)
+  {
+    if( partition_init(&ptr_info->ptr_partition, max_resolver, ptr_lookup_params->queue_size,
+                       ptr_lookup_params->cache_size, ptr_lookup_params->negative_cache_size,
+                       ptr_lookup_params->negative_ttl) != 0 )
+    {
+      printf("Unable to malloc\n");
+      ptr_info->ptr_partition = NULL;
+      lookup_teardown(ptr_info);
+      return -1;
+    }
+    for(int i = 0; ptr_info->ptr_numa != NULL && i < ptr_info->ptr_partition->num_partitions; i++)
+    {
+      queue_t * ptr_queue = ptr_info->ptr_partition->queues[i];
+      numa_bind_shared(ptr_info->ptr_numa, ptr_queue->slots, sizeof(queue_slot_t) * (ptr_queue->mask + 1));
+    }
+  }
+
+  // create thread pools
+  if( autoscale_init(&ptr_info->ptr_autoscale, min_requester, max_requester, min_resolver, max_resolver,
+                     ptr_lookup_params->autoscale_ms) != 0 )
+  {
+    printf("Unable to malloc\n");
+    ptr_info->ptr_autoscale = NULL;
+    lookup_teardown(ptr_info);
+    return -1;
+  }
+
+  *ptr_lookup_info = ptr_info;
+  return 0;
+}
+
+/**
+ * @brief Start the threads of a run and wait until they have all finished
+ *
+ * Resolvers start first so they are waiting before any hostname arrives.
+ */
+static void lookup_run(lookup_info_t * ptr_lookup_info)
+{
+  autoscale_t * ptr_autoscale = ptr_lookup_info->ptr_autoscale;
+
+  if( ptr_lookup_info->ptr_metrics != NULL && metrics_start(ptr_lookup_info->ptr_metrics) != 0 )
+  {
+    printf("Failed to create thread\n");
+  }
+  if( autoscale_start(ptr_autoscale, &ptr_autoscale->resolvers,
+                      ptr_lookup_info->ptr_lookup_params->async_f ? resolver_async : resolver,
+                      (void *)ptr_lookup_info) != 0 ||
+      autoscale_start(ptr_autoscale, &ptr_autoscale->requesters, requester, (void *)ptr_lookup_info) != 0 )
+  {
+    printf("Failed to create thread\n");
+  }
+
+  // resize the pools until the work is done, then wait for threads. Names
+  // are spread evenly over the partitions, so any one queue stands for all
+  autoscale_run(ptr_autoscale, ptr_lookup_info->ptr_partition != NULL ? ptr_lookup_info->ptr_partition->queues[0] :
+                ptr_lookup_info->ptr_queue);
+}
+
+/**
+ * @brief Empty a log so the next sweep run writes it from the start
+ */
+static void sweep_truncate(file_t * ptr_log)
+{
+  fflush(ptr_log->ptr_file);
+  if( ftruncate(fileno(ptr_log->ptr_file), 0) != 0 )
+  {
+    printf("Unable to truncate %s\n", *ptr_log->name);
+  }
+  rewind(ptr_log->ptr_file);
+}
+
+/**
+ * @brief Run the pipeline once with fixed pool sizes and add its row to the sweep CSV
+ *
+ * Every run is set up and torn down like the one main runs, so no run
+ * starts with the names another one cached. The input files stay open and
+ * mapped between runs, and both logs are emptied first, so they hold the
+ * output of the last run once the sweep is over.
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+static int sweep_run(lookup_params_t * ptr_lookup_params, int num_requesters, int num_resolvers, int rep, FILE * ptr_csv)
+{
+  lookup_info_t * ptr_lookup_info;
+  metrics_t * ptr_metrics;
+  unsigned long long names = 0;
+  long long start_ns;
+  double seconds;
+
+  sweep_truncate(ptr_lookup_params->requester_log);
+  sweep_truncate(ptr_lookup_params->resolver_log);
+  if( lookup_setup(ptr_lookup_params, num_requesters, num_requesters, num_resolvers, num_resolvers,
+                   &ptr_lookup_info) != 0 )
+  {
+    return -1;
+  }
+
+  // time the pipeline alone, from the first thread started to the last one joined
+  start_ns = now_ns();
+  lookup_run(ptr_lookup_info);
+  seconds = (now_ns() - start_ns) / 1e9;
+
+  ptr_metrics = ptr_lookup_info->ptr_metrics;
+  for(int i = 0; i < num_resolvers; i++)
+  {
+    names += atomic_load(&ptr_metrics->resolvers[i].names);
+  }
+  fprintf(ptr_csv, "%d,%d,%d,%.6f,%llu,%.1f,%llu,%llu,%llu,%llu\n", num_requesters, num_resolvers, rep, seconds, names,
+          seconds > 0 ? names / seconds : 0.0,
+          metrics_quantile(ptr_metrics, METRICS_LOOKUP, 50.0), metrics_quantile(ptr_metrics, METRICS_LOOKUP, 99.0),
+          metrics_quantile(ptr_metrics, METRICS_QUEUE, 50.0), metrics_quantile(ptr_metrics, METRICS_QUEUE, 99.0));
+  fflush(ptr_csv);
+  printf("Sweep: %d requesters, %d resolvers, run %d took %.6f s, %.0f hostnames/s\n", num_requesters, num_resolvers,
+         rep, seconds, seconds > 0 ? names / seconds : 0.0);
+
+  lookup_teardown(ptr_lookup_info);
+  return 0;
+}
+
+/**
+ * @brief Run the pipeline over every combination of pool sizes, writing one CSV row per run
+ *
+ * The data files are opened and split once and every run reads them from
+ * memory or the page cache, so the sweep times the pipeline rather than
+ * process start-up.
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+static int sweep(lookup_params_t * ptr_lookup_params)
+{
+  FILE * ptr_csv;
+
+  if( (ptr_csv = fopen(ptr_lookup_params->sweep_file, "w")) == NULL )
+  {
+    printf("%s does not exist or does not grant write permissions\n", ptr_lookup_params->sweep_file);
+    return -1;
+  }
+  fprintf(ptr_csv, "requesters,resolvers,rep,seconds,names,names_per_s,lookup_p50_ns,lookup_p99_ns,"
+          "queue_p50_ns,queue_p99_ns\n");
+
+  for(int num_requesters = ptr_lookup_params->min_requester; num_requesters <= ptr_lookup_params->max_requester; num_requesters++)
+  {
+    for(int num_resolvers = ptr_lookup_params->min_resolver; num_resolvers <= ptr_lookup_params->max_resolver; num_resolvers++)
+    {
+      for(int rep = 1; rep <= ptr_lookup_params->sweep_reps; rep++)
+      {
+        if( sweep_run(ptr_lookup_params, num_requesters, num_resolvers, rep, ptr_csv) != 0 )
+        {
+          fclose(ptr_csv);
+          return -1;
+        }
+      }
+    }
+  }
+
+  fclose(ptr_csv);
+  return 0;
 }
 
 int main(int argc, char ** argv)
@@ -445,115 +2129,152 @@ int main(int argc, char ** argv)
 
   lookup_params_t * ptr_lookup_params;
   lookup_info_t * ptr_lookup_info;
-  int * file_done_f;
-  pthread_mutex_t * ptr_temp_mutex;
+  int ret;
 
   // process input parameters
-  if(argc < MIN_NUM_PARAMS)
-  {
-    printf(USAGE_DECLARATION);
-    return -1;
-  }
   if(process_inputs(argc, argv, &ptr_lookup_params) != 0) return -1;
 
   /*
    * Main initialization
    */
-  // create main struct
-  if( (ptr_lookup_info = (lookup_info_t *)malloc(sizeof(lookup_info_t))) == NULL )
+  // pick the tokenizer before any requester runs
+  tokenize_init(!ptr_lookup_params->scalar_tokenizer_f);
+
+  // a sweep runs the whole pipeline once per configuration
+  if(ptr_lookup_params->sweep_file != NULL)
   {
-    printf("Unable to malloc\n");
+    ret = sweep(ptr_lookup_params);
     free_lookup_params(ptr_lookup_params);
-    return -1;
+    if( atomic_load(&lockprof_enabled_f) )
+    {
+      lockprof_report(stdout);
+    }
+    lockprof_free();
+    if(ret != 0) return -1;
+
+    gettimeofday(&end_time, &time_zone);
+    timersub(&end_time, &start_time, &elapsed_time);
+    printf("Program finished. Time elapsed: %ld.%06ld s\n", elapsed_time.tv_sec, elapsed_time.tv_usec);
+    return 0;
   }
-  ptr_lookup_info->ptr_lookup_params = ptr_lookup_params;
-  ptr_lookup_info->ptr_domains = NULL;
-  ptr_lookup_info->domains_len = NULL;
-  ptr_lookup_info->num_domains = 0;
-  ptr_lookup_info->rr_next_file = 0;
 
-  // create array for file done flags
-  if( (file_done_f = (int *)malloc(sizeof(int) * ptr_lookup_params->num_input_files)) == NULL )
+  if( lookup_setup(ptr_lookup_params, ptr_lookup_params->min_requester, ptr_lookup_params->max_requester,
+                   ptr_lookup_params->min_resolver, ptr_lookup_params->max_resolver, &ptr_lookup_info) != 0 )
   {
-    printf("Unable to malloc\n");
     free_lookup_params(ptr_lookup_params);
-    free((void *)ptr_lookup_info);
     return -1;
   }
-  memset(file_done_f, 0, sizeof(int) * ptr_lookup_params->num_input_files);
-  ptr_lookup_info->file_done_f = file_done_f;
+  lookup_run(ptr_lookup_info);
 
-  // create mutex for struct
-  if( (ptr_temp_mutex = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t))) == NULL )
+  /*
+   * Reports, read before the parts they describe are freed
+   */
+  autoscale_t * ptr_autoscale = ptr_lookup_info->ptr_autoscale;
+  if( ptr_lookup_params->min_requester != ptr_lookup_params->max_requester ||
+      ptr_lookup_params->min_resolver != ptr_lookup_params->max_resolver )
   {
-    printf("Unable to malloc\n");
-    free_lookup_params(ptr_lookup_params);
-    free((void *)ptr_lookup_info);
-    free((void *)file_done_f);
-    return -1;
+    printf("Threads: finished with %d requesters (peak %d) and %d resolvers (peak %d)\n",
+           atomic_load(&ptr_autoscale->requesters.target), ptr_autoscale->requesters.peak,
+           atomic_load(&ptr_autoscale->resolvers.target), ptr_autoscale->resolvers.peak);
+  }
+  if(ptr_lookup_info->ptr_numa != NULL)
+  {
+    numa_t * ptr_numa = ptr_lookup_info->ptr_numa;
+    if(ptr_numa->shared_node >= 0)
+    {
+      printf("NUMA: %d nodes, queue on node %d", ptr_numa->num_nodes, ptr_numa->shared_node);
+    }
+    else
+    {
+      printf("NUMA: %d nodes, queue interleaved", ptr_numa->num_nodes);
+    }
+    if(atomic_load(&ptr_numa->bind_failures) > 0)
+    {
+      printf(", %d memory placements failed", atomic_load(&ptr_numa->bind_failures));
+    }
+    printf("\n");
+  }
+  if(ptr_lookup_info->ptr_limit != NULL)
+  {
+    limit_t * ptr_limit = ptr_lookup_info->ptr_limit;
+    if(ptr_limit->adaptive_f)
+    {
+      printf("Limit: %d lookups outstanding at exit (peak %d), %lu backoffs, %lu lookups waited for a slot\n",
+             (int)ptr_limit->limit, ptr_limit->peak, ptr_limit->decreases, ptr_limit->waits);
+    }
+    else
+    {
+      printf("Limit: %d lookups outstanding, %lu lookups waited for a slot\n", ptr_limit->max, ptr_limit->waits);
+    }
   }
-  pthread_mutex_init(ptr_temp_mutex, NULL);
-  ptr_lookup_info->ptr_mutex = ptr_temp_mutex;
 
-  // create printf mutex
-  if( (ptr_temp_mutex = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t))) == NULL )
+  // every thread has finished, so the final metrics are complete
+  if(ptr_lookup_info->ptr_metrics != NULL)
   {
-    printf("Unable to malloc\n");
-    free_lookup_params(ptr_lookup_params);
-    free((void *)ptr_lookup_info);
-    free((void *)file_done_f);
-    return -1;
+    metrics_stop(ptr_lookup_info->ptr_metrics);
   }
-  pthread_mutex_init(ptr_temp_mutex, NULL);
-  ptr_lookup_info->ptr_printf_mutex = ptr_temp_mutex;
 
-  // create array for threads
-  int num_threads = ptr_lookup_params->num_requester + ptr_lookup_params->num_resolver;
-  pthread_t * thread_array;
-  if( (thread_array = (pthread_t *)malloc(sizeof(pthread_t) * num_threads)) == NULL )
+  if(ptr_lookup_info->ptr_daemon != NULL)
   {
-    printf("Unable to malloc\n");
-    free_lookup_params(ptr_lookup_params);
-    free((void *)ptr_lookup_info);
-    free((void *)file_done_f);
-    return -1;
+    printf("Daemon: %lu clients, %lu requests\n", atomic_load(&ptr_lookup_info->ptr_daemon->connections),
+           atomic_load(&ptr_lookup_info->ptr_daemon->requests));
   }
 
-  // create threads
-  pthread_t thread_id;
-  pthread_attr_t thread_attr;
-  for(int i = 0; i < ptr_lookup_params->num_requester; i++)
+  // report how well the cache did so it can be sized
+  cache_stats_t cache_totals;
+  if(ptr_lookup_info->ptr_partition != NULL)
   {
-    pthread_attr_init(&thread_attr);
-    if( pthread_create(&thread_id, &thread_attr, requester, (void *)ptr_lookup_info) )
-    {
-      printf("Failed to create thread\n");
-    }
-    thread_array[i] = thread_id;
+    partition_stats(ptr_lookup_info->ptr_partition, &cache_totals);
+    printf("Partitions: %d, the busiest resolver was sent %.1f%% of hostnames\n",
+           ptr_lookup_info->ptr_partition->num_partitions, 100.0 * partition_skew(ptr_lookup_info->ptr_partition));
+  }
+  else
+  {
+    cache_stats(ptr_lookup_info->ptr_cache, &cache_totals);
+  }
+  if(ptr_lookup_params->stats_f && ptr_lookup_params->cache_size > 0)
+  {
+    printf("Cache: %lu hits, %lu misses (%.1f%% hit rate), %lu coalesced, %lu evictions, %lu expirations, %zu entries, %zu bytes\n",
+           cache_totals.hits, cache_totals.misses,
+           cache_totals.hits + cache_totals.misses > 0 ? 100.0 * cache_totals.hits / (cache_totals.hits + cache_totals.misses) : 0.0,
+           cache_totals.coalesced, cache_totals.evictions, cache_totals.expirations, cache_totals.entries, cache_totals.bytes);
   }
-  for(int i = 0; i < ptr_lookup_params->num_resolver; i++)
+  if(ptr_lookup_params->stats_f && ptr_lookup_params->negative_cache_size > 0)
   {
-    pthread_attr_init(&thread_attr);
-    if( pthread_create(&thread_id, &thread_attr, resolver, (void *)ptr_lookup_info) )
+    printf("Negative cache: %lu hits, %lu evictions, %zu entries, %zu bytes\n", cache_totals.negative_hits,
+           cache_totals.negative_evictions, cache_totals.negative_entries, cache_totals.negative_bytes);
+  }
+
+  // keep what this run learned for the next one
+  if(ptr_lookup_info->ptr_diskcache != NULL)
+  {
+    diskcache_t * ptr_diskcache = ptr_lookup_info->ptr_diskcache;
+    if( (ptr_lookup_info->ptr_partition != NULL ?
+         diskcache_save(ptr_diskcache, ptr_lookup_info->ptr_partition->caches, ptr_lookup_info->ptr_partition->num_partitions) :
+         diskcache_save(ptr_diskcache, &ptr_lookup_info->ptr_cache, 1)) != 0 )
     {
-      printf("Failed to create thread\n");
+      printf("Unable to write %s\n", ptr_lookup_params->cache_file);
     }
-    thread_array[i + ptr_lookup_params->num_requester] = thread_id;
+    printf("Cache file: %lu hits, %zu entries loaded, %zu saved\n",
+           atomic_load(&ptr_diskcache->hits), diskcache_entries(ptr_diskcache), ptr_diskcache->saved);
   }
 
-  // wait for threads
-  for(int i = 0; i < num_threads; i++)
+  // report how evenly the requesters shared the input
+  if(ptr_lookup_params->stats_f && ptr_lookup_info->ptr_daemon == NULL)
   {
-    pthread_join(thread_array[i], NULL);
+    printf("Scheduler: %zu tasks, %lu stolen\n", ptr_lookup_info->ptr_sched->num_tasks, sched_steals(ptr_lookup_info->ptr_sched));
   }
 
   // free heap memory
+  lookup_teardown(ptr_lookup_info);
   free_lookup_params(ptr_lookup_params);
-  free((void *)file_done_f);
-  free((void *)ptr_lookup_info->ptr_mutex);
-  free((void *)ptr_lookup_info->ptr_printf_mutex);
-  free((void *)ptr_lookup_info);
-  free((void *)thread_array);
+
+  // report which locks serialized the run
+  if( atomic_load(&lockprof_enabled_f) )
+  {
+    lockprof_report(stdout);
+  }
+  lockprof_free();
 
   // get end time
   gettimeofday(&end_time, &time_zone);
@@ -25,6 +25,22 @@
 #ifndef __MULTI_LOOKUP_H__
 #define __MULTI_LOOKUP_H__
 
+#include <sys/socket.h>
+#include "queue.h"
+#include "cache.h"
+#include "logbuf.h"
+#include "arena.h"
+#include "sched.h"
+#include "autoscale.h"
+#include "backend.h"
+#include "diskcache.h"
+#include "daemon.h"
+#include "metrics.h"
+#include "dns.h"
+#include "numa.h"
+#include "limit.h"
+#include "partition.h"
+
 #define MIN_NUM_PARAMS (6)
 #define PARAM_NUM_REQUESTERS (1)
 #define PARAM_NUM_RESOLVERS (2)
@@ -34,14 +50,155 @@
 
 #define NAME_SERVICED_LOG ("serviced.txt")
 
-#define USAGE_DECLARATION ("\nNAME\n    multi-lookup resolve a set of hostnames to IP addresses\n\nSYNOPSIS\n    multi-lookup <# requesters> <# resolvers> <requester log> <resolver log> <data file> [<data file> ...]\n\nDESCRIPTION\n    The file names specified by <data file> are passed to the pool of requester threads\n    which place information into a shared data area. Resolver threads read the shared\n    data area and find the corresponding IP address.\n\n    <# requesters> number of requester threads to place into the thread pool.\n    <# resolvers> number of resolver threads to place into the thread pool.\n    <requester log> name of the file into which all the requester status information is written.\n    <resolver log> name of the file into which all the resolver status information is written.\n    <data file> file(s) that are to be processed. Each file contains a list of host names, one per line,\n                that are to be resolved.\n")
+#define OPT_QUEUE_SIZE (256)
+#define OPT_ASYNC (257)
+#define OPT_DNS_SERVER (258)
+#define OPT_MAX_INFLIGHT (259)
+#define OPT_DNS_TIMEOUT (260)
+#define OPT_DNS_RETRIES (261)
+#define OPT_CACHE_SIZE (262)
+#define OPT_CACHE_SHARDS (263)
+#define OPT_CACHE_TTL (264)
+#define OPT_MMAP (265)
+#define OPT_CHUNK_SIZE (266)
+#define OPT_LOG_BUFFER (267)
+#define OPT_MIN_REQUESTERS (268)
+#define OPT_MAX_REQUESTERS (269)
+#define OPT_MIN_RESOLVERS (270)
+#define OPT_MAX_RESOLVERS (271)
+#define OPT_AUTOSCALE_MS (272)
+#define OPT_BACKEND (273)
+#define OPT_MOCK_LATENCY (274)
+#define OPT_MOCK_FAIL (275)
+#define OPT_ALL_ADDRESSES (276)
+#define OPT_CACHE_FILE (277)
+#define OPT_DAEMON (278)
+#define OPT_METRICS (279)
+#define OPT_METRICS_INTERVAL (280)
+#define OPT_LOCK_PROFILE (281)
+#define OPT_BATCH (282)
+#define OPT_REQUESTER_CPUS (283)
+#define OPT_RESOLVER_CPUS (284)
+#define OPT_CONCURRENCY_LIMIT (285)
+#define OPT_NEGATIVE_CACHE_SIZE (286)
+#define OPT_NEGATIVE_TTL (287)
+#define OPT_LOWERCASE (288)
+#define OPT_SCALAR_TOKENIZER (289)
+#define OPT_PARTITION (290)
+#define OPT_METRICS_SOCKET (291)
+#define OPT_RECORD (292)
+#define OPT_SWEEP (293)
+#define OPT_SWEEP_REPS (294)
+#define OPT_STATS (295)
+
+#define CHUNK_DEFAULT_SIZE (1024 * 1024)
+#define BATCH_DEFAULT_SIZE (32)
+
+// default upper bounds for auto pools, per online CPU
+#define AUTO_REQUESTERS_PER_CPU (1)
+#define AUTO_RESOLVERS_PER_CPU (8)
+
+#define ASYNC_POLL_MS (5)
+
+#define USAGE_DECLARATION ( \
+  "\n" \
+  "NAME\n" \
+  "    multi-lookup resolve a set of hostnames to IP addresses\n" \
+  "\n" \
+  "SYNOPSIS\n" \
+  "    multi-lookup [options] <# requesters> <# resolvers> <requester log> <resolver log> <data file> [<data file> ...]\n" \
+  "    multi-lookup [options] --daemon=SOURCE <# requesters> <# resolvers> <requester log> <resolver log>\n" \
+  "    multi-lookup [options] --sweep=FILE <LO-HI requesters> <LO-HI resolvers> <requester log> <resolver log> <data file> [<data file> ...]\n" \
+  "\n" \
+  "DESCRIPTION\n" \
+  "    The file names specified by <data file> are passed to the pool of requester threads\n" \
+  "    which place information into a shared data area. Resolver threads read the shared\n" \
+  "    data area and find the corresponding IP address. With --daemon, hostnames are read\n" \
+  "    from SOURCE instead for as long as it stays open, and each result is sent back as\n" \
+  "    soon as its lookup finishes.\n" \
+  "\n" \
+  "    <# requesters> number of requester threads to place into the thread pool, or auto to size the\n" \
+  "                   pool while running.\n" \
+  "    <# resolvers> number of resolver threads to place into the thread pool, or auto to size the\n" \
+  "                  pool while running.\n" \
+  "    <requester log> name of the file into which all the requester status information is written.\n" \
+  "    <resolver log> name of the file into which all the resolver status information is written.\n" \
+  "    <data file> file(s) that are to be processed. Each file contains a list of host names, one per line,\n" \
+  "                that are to be resolved.\n" \
+  "\n" \
+  "OPTIONS\n" \
+  "    --queue-size=N        capacity of the shared hostname queue (default 1024).\n" \
+  "    --async               resolvers send their own DNS queries over UDP instead of calling getaddrinfo,\n" \
+  "                          keeping many lookups in flight per thread.\n" \
+  "    --dns-server=ADDR     DNS server for --async as a.b.c.d[:port] or [x::y]:port\n" \
+  "                          (default first nameserver in /etc/resolv.conf).\n" \
+  "    --max-inflight=N      most outstanding queries per resolver thread with --async (default 512).\n" \
+  "    --dns-timeout=MS      time before an unanswered query is resent with --async (default 2000).\n" \
+  "    --dns-retries=N       times a query is resent before it fails with --async (default 2).\n" \
+  "    --cache-size=N[K|M|G] memory bound of the resolution cache in bytes, 0 disables caching but still\n" \
+  "                          shares lookups in flight (default 16M).\n" \
+  "    --cache-shards=N      number of independently locked cache shards (default 16).\n" \
+  "    --cache-ttl=S         longest time a resolved address is cached in seconds (default 300).\n" \
+  "    --negative-cache-size=N\n" \
+  "                          memory bound of the cache of failed lookups, with an optional K, M or G\n" \
+  "                          suffix (default 1M). 0 disables negative caching.\n" \
+  "    --negative-ttl=S      time a failed lookup is cached in seconds (default 30).\n" \
+  "    --mmap                map regular data files into memory instead of reading each chunk with pread.\n" \
+  "    --chunk-size=N[K|M|G] size of the byte ranges regular data files are split into for the requesters\n" \
+  "                          (default 1M).\n" \
+  "    --log-buffer=N[K|M|G] size of each resolver thread's resolver log buffer (default 64K).\n" \
+  "    --min-requesters=N    fewest requester threads for auto (default 1).\n" \
+  "    --max-requesters=N    most requester threads for auto (default 1 per CPU).\n" \
+  "    --min-resolvers=N     fewest resolver threads for auto (default 1).\n" \
+  "    --max-resolvers=N     most resolver threads for auto (default 8 per CPU).\n" \
+  "    --autoscale-ms=MS     time between auto pool adjustments (default 100).\n" \
+  "    --backend=SPEC        how blocking resolvers look names up: getaddrinfo, hosts:FILE for a fixed\n" \
+  "                          hosts-format table, mock for made-up addresses, or replay:FILE for the results\n" \
+  "                          and latencies of a --record trace (default getaddrinfo).\n" \
+  "    --record=FILE         write the result and latency of every backend lookup to FILE as a trace.\n" \
+  "    --mock-latency=DIST   delay of each mock lookup: fixed:US, uniform:MIN_US:MAX_US or\n" \
+  "                          lognormal:MEDIAN_US:SIGMA (default fixed:0).\n" \
+  "    --mock-fail=RATE      fraction of names the mock backend fails to resolve (default 0).\n" \
+  "    --all-addresses       write every IPv4 and IPv6 address of each hostname to the resolver log,\n" \
+  "                          IPv4 first and separated by commas, instead of only the first IPv4 one.\n" \
+  "                          With --async each hostname is sent as an A and an AAAA query.\n" \
+  "    --cache-file=PATH     cache file read before looking names up and written back at exit, so later\n" \
+  "                          runs start warm.\n" \
+  "    --daemon=SOURCE       keep running and resolve hostnames as they arrive, from stdin with results\n" \
+  "                          on stdout, or from clients of unix:PATH with results sent back to each\n" \
+  "                          client. A socket daemon runs until SIGINT or SIGTERM.\n" \
+  "    --metrics=FILE        write latency histograms and per-thread counters to FILE as JSON at exit.\n" \
+  "    --metrics-interval=S  also write them every S seconds, one JSON object per line (default 0).\n" \
+  "    --metrics-socket=PATH serve a live snapshot of the metrics in the Prometheus text format to every\n" \
+  "                          client of the Unix domain socket PATH while running.\n" \
+  "    --lock-profile        count acquisitions, contention, wait and hold time of every named lock and\n" \
+  "                          print them at exit.\n" \
+  "    --batch=N             most hostnames a resolver claims from the queue at once, scaled down to its\n" \
+  "                          share of the queue (default 32).\n" \
+  "    --requester-cpus=LIST CPUs the requester threads run on, such as 0-3,8, or numa to deal them out\n" \
+  "                          to the NUMA nodes in turn. Their memory is kept on their node.\n" \
+  "    --resolver-cpus=LIST  the same for the resolver threads.\n" \
+  "    --concurrency-limit=N most lookups outstanding at once over every resolver thread, or auto to\n" \
+  "                          adapt the limit to the latency and failures of the upstream resolver.\n" \
+  "    --lowercase           lower-case hostnames as they are read, so names differing only in case are\n" \
+  "                          logged alike.\n" \
+  "    --scalar-tokenizer    find hostnames one byte at a time instead of with SSE2 or AVX2.\n" \
+  "    --partition           give each resolver its own queue and cache, and send every hostname to the\n" \
+  "                          resolver its hash picks. Needs a fixed number of resolvers.\n" \
+  "    --sweep=FILE          run the pipeline once for every pool size from LO to HI, given as LO-HI or a\n" \
+  "                          number in place of <# requesters> and <# resolvers>, and write the time,\n" \
+  "                          throughput and latency percentiles of each run to FILE as CSV.\n" \
+  "    --sweep-reps=N        runs of each pair of pool sizes with --sweep (default 1).\n" \
+  "    --stats               print scheduler and cache counters at exit.\n")
 
 typedef struct
 {
   FILE * ptr_file;
   char ** name;
   int name_len;
-  pthread_mutex_t * ptr_mutex;
+  lockprof_mutex_t * ptr_mutex;
+  char * map;
+  size_t size;
 } file_t;
 
 typedef struct
@@ -50,22 +207,77 @@ typedef struct
   file_t * resolver_log;
   file_t ** input_files;
   int num_input_files;
-  int num_requester;
-  int num_resolver;
+  int min_requester;
+  int max_requester;
+  int min_resolver;
+  int max_resolver;
+  int autoscale_ms;
+  const char * backend_spec;
+  const char * record_file;
+  const char * mock_latency;
+  double mock_fail;
+  backend_t * ptr_backend;
+  int all_addresses_f;
+  const char * cache_file;
+  const char * daemon_spec;
+  const char * metrics_file;
+  int metrics_interval;
+  const char * metrics_socket;
+  size_t batch_size;
+  const char * requester_cpus;
+  const char * resolver_cpus;
+  int concurrency_limit;
+  int limit_adaptive_f;
+  int lowercase_f;
+  int scalar_tokenizer_f;
+  int partition_f;
+  const char * sweep_file;
+  int sweep_reps;
+  int stats_f;
+  int queue_size;
+  int async_f;
+  char * dns_server_str;
+  struct sockaddr_storage dns_server;
+  socklen_t dns_server_len;
+  int max_inflight;
+  int dns_timeout_ms;
+  int dns_retries;
+  size_t cache_size;
+  int cache_shards;
+  int cache_ttl;
+  size_t negative_cache_size;
+  int negative_ttl;
+  int mmap_f;
+  size_t chunk_size;
+  size_t log_buffer;
 } lookup_params_t;
 
 typedef struct
 {
   lookup_params_t * ptr_lookup_params;
-  char ** ptr_domains;
-  int * domains_len;
-  int num_domains;
-  int rr_next_file;
-  int * file_done_f;
-  pthread_mutex_t * ptr_mutex;
-  pthread_mutex_t * ptr_printf_mutex;
+  queue_t * ptr_queue;
+  cache_t * ptr_cache;
+  diskcache_t * ptr_diskcache;
+  daemon_t * ptr_daemon;
+  metrics_t * ptr_metrics;
+  numa_t * ptr_numa;
+  limit_t * ptr_limit;
+  partition_t * ptr_partition;
+  sched_t * ptr_sched;
+  autoscale_t * ptr_autoscale;
+  arena_t * arenas;
+  int num_arenas;
+  lockprof_mutex_t * ptr_printf_mutex;
 } lookup_info_t;
 
+typedef struct
+{
+  lookup_info_t * ptr_lookup_info;
+  cache_t * ptr_cache;
+  logbuf_t log;
+  dns_engine_t * ptr_engine;
+} resolver_ctx_t;
+
 /**
  * @brief Process inputs to main
  *
@@ -93,8 +305,15 @@ void free_lookup_params(lookup_params_t * ptr_lookup_params);
 /**
  * @brief Function for requester threads
  *
- * Reads hostnames from the input files and places them in the shared data.
- * Prints to the requester log file when complete.
+ * Reads hostnames from the input files, or from daemon clients one at a
+ * time, and places them in the shared queue, sleeping while the queue is
+ * full. Regular files are split into byte-range tasks that each requester
+ * takes from its own deque, stealing from the others once it runs dry, so
+ * several requesters can work through one large file without locking it.
+ * Hostnames are copied into the requester's own arena, which lives until
+ * the end of the run. With --partition each hostname goes to the queue of
+ * the resolver its hash picks instead. The last requester to finish closes
+ * the queues. Prints to the requester log file when complete.
  *
  * @param arg A pointer to the structure with all the information for the program.
  */
@@ -103,13 +322,47 @@ void * requester(void * arg);
 /**
  * @brief Function for resolver threads
  *
- * Reads hostnames from the shared data, resolves to IP addresses, and
- * prints out to the resolver log file.
+ * Reads hostnames from the shared queue, resolves to IP addresses through
+ * the cache, and buffers the results for the resolver log file. The buffer
+ * is written out whenever it fills, before sleeping on an empty queue and
+ * on exit. A name another resolver is already looking up waits for that
+ * result instead. Sleeps while the queue is empty and returns once it has
+ * been closed and drained. With --partition the queue and cache are the
+ * thread's own.
  *
  * @param arg A pointer to the structure with all the information for the program.
  */
 void * resolver(void * arg);
 
+/**
+ * @brief Function for resolver threads using the asynchronous DNS engine
+ *
+ * Keeps up to the configured number of queries in flight, topping them up
+ * from the shared queue and answering cached names without a query. Names
+ * another resolver is already looking up are set aside until that result
+ * is ready. Buffers each result for the resolver log file as its answer
+ * arrives.
+ *
+ * @param arg A pointer to the structure with all the information for the program.
+ */
+void * resolver_async(void * arg);
+
+/**
+ * @brief Add one lookup result to a resolver log buffer
+ *
+ * This is the only place addresses are turned into text. In daemon mode the
+ * result is also sent back to the client that asked for it, after which
+ * the hostname has been freed.
+ *
+ * @param ptr_lookup_info A pointer to the structure with all the information for the program
+ * @param ptr_log A pointer to the calling thread's log buffer
+ * @param hostname The hostname that was looked up
+ * @param status UTIL_SUCCESS if the lookup found an address
+ * @param ptr_addrs The addresses found, unused on failure
+ */
+void write_result(lookup_info_t * ptr_lookup_info, logbuf_t * ptr_log, char * hostname, int status,
+                  const addr_set_t * ptr_addrs);
+
 /**
  * @brief Main function for multi-lookup
  *
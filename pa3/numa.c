@@ -0,0 +1,296 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file numa.c
+ * @brief CPU affinity and NUMA placement of the thread pools
+ *
+ * Implementations for reading the node layout and placing threads and
+ * memory. Placement is only ever a hint: a thread that cannot be pinned
+ * or memory that cannot be moved stays where the kernel put it, and
+ * failed memory moves are counted so they can be reported at exit.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include "numa.h"
+
+#define NUMA_SYS_PATH "/sys/devices/system/node"
+
+/**
+ * @brief Parse a CPU list such as 0-3,8 into a set
+ */
+static int numa_parse_cpus(const char * str, cpu_set_t * ptr_set)
+{
+  char * end;
+  long first, last;
+
+  CPU_ZERO(ptr_set);
+  do
+  {
+    first = strtol(str, &end, 10);
+    if(end == str || first < 0)
+    {
+      return -1;
+    }
+    last = first;
+    if(*end == '-')
+    {
+      str = end + 1;
+      last = strtol(str, &end, 10);
+      if(end == str || last < first)
+      {
+        return -1;
+      }
+    }
+    if(last >= CPU_SETSIZE)
+    {
+      return -1;
+    }
+    for(long cpu = first; cpu <= last; cpu++)
+    {
+      CPU_SET(cpu, ptr_set);
+    }
+    str = end + 1;
+  } while(*end == ',');
+
+  // sysfs lists end in a newline
+  return *end == '\0' || *end == '\n' ? 0 : -1;
+}
+
+/**
+ * @brief Read the CPUs of one node from sysfs
+ */
+static int numa_read_node(int id, cpu_set_t * ptr_set)
+{
+  char path[sizeof(NUMA_SYS_PATH) + 32];
+  char line[4096];
+  FILE * file;
+  int ret = -1;
+
+  snprintf(path, sizeof(path), NUMA_SYS_PATH "/node%d/cpulist", id);
+  if( (file = fopen(path, "r")) == NULL )
+  {
+    return -1;
+  }
+  if( fgets(line, sizeof(line), file) != NULL )
+  {
+    ret = numa_parse_cpus(line, ptr_set);
+  }
+  fclose(file);
+
+  return ret;
+}
+
+int numa_init(numa_t ** ptr_numa)
+{
+  numa_t * ptr_n;
+  DIR * dir;
+  struct dirent * ent;
+  cpu_set_t set;
+  int id;
+  char extra;
+
+  if( (ptr_n = (numa_t *)malloc(sizeof(numa_t))) == NULL )
+  {
+    return -1;
+  }
+
+  if( sched_getaffinity(0, sizeof(ptr_n->allowed), &ptr_n->allowed) != 0 )
+  {
+    CPU_ZERO(&ptr_n->allowed);
+    for(long cpu = 0; cpu < sysconf(_SC_NPROCESSORS_ONLN) && cpu < CPU_SETSIZE; cpu++)
+    {
+      CPU_SET(cpu, &ptr_n->allowed);
+    }
+  }
+
+  // keep the nodes with CPUs this process may use, in order of their ids
+  ptr_n->num_nodes = 0;
+  if( (dir = opendir(NUMA_SYS_PATH)) != NULL )
+  {
+    while( (ent = readdir(dir)) != NULL )
+    {
+      if( sscanf(ent->d_name, "node%d%c", &id, &extra) != 1 || id < 0 || id >= NUMA_MAX_NODES ||
+          numa_read_node(id, &set) != 0 )
+      {
+        continue;
+      }
+      CPU_AND(&set, &set, &ptr_n->allowed);
+      if(CPU_COUNT(&set) == 0)
+      {
+        continue;
+      }
+      int i = ptr_n->num_nodes++;
+      for(; i > 0 && ptr_n->ids[i - 1] > id; i--)
+      {
+        ptr_n->ids[i] = ptr_n->ids[i - 1];
+        ptr_n->cpus[i] = ptr_n->cpus[i - 1];
+      }
+      ptr_n->ids[i] = id;
+      ptr_n->cpus[i] = set;
+    }
+    closedir(dir);
+  }
+  if(ptr_n->num_nodes == 0)
+  {
+    ptr_n->ids[0] = 0;
+    ptr_n->cpus[0] = ptr_n->allowed;
+    ptr_n->num_nodes = 1;
+  }
+
+  for(int pool = 0; pool < NUMA_NUM_POOLS; pool++)
+  {
+    ptr_n->pools[pool].mode = NUMA_ANY;
+    ptr_n->pools[pool].cpus = ptr_n->allowed;
+  }
+  ptr_n->shared_node = -1;
+  atomic_init(&ptr_n->bind_failures, 0);
+
+  *ptr_numa = ptr_n;
+  return 0;
+}
+
+void numa_free(numa_t * ptr_numa)
+{
+  free((void *)ptr_numa);
+}
+
+int numa_set_pool(numa_t * ptr_numa, int pool, const char * spec)
+{
+  numa_pool_t * ptr_pool = &ptr_numa->pools[pool];
+  cpu_set_t set;
+
+  if( strcmp(spec, "numa") == 0 )
+  {
+    ptr_pool->mode = NUMA_SPREAD;
+    return 0;
+  }
+
+  if( numa_parse_cpus(spec, &ptr_pool->cpus) != 0 )
+  {
+    return -1;
+  }
+  CPU_AND(&set, &ptr_pool->cpus, &ptr_numa->allowed);
+  if( !CPU_EQUAL(&set, &ptr_pool->cpus) )
+  {
+    return -1;
+  }
+  ptr_pool->mode = NUMA_CPUS;
+
+  return 0;
+}
+
+/**
+ * @brief Find the CPUs a thread runs on
+ *
+ * @return The index of the node holding all of them, -1 if they span nodes
+ */
+static int numa_thread_cpus(numa_t * ptr_numa, int pool, int idx, cpu_set_t * ptr_set)
+{
+  numa_pool_t * ptr_pool = &ptr_numa->pools[pool];
+  cpu_set_t set;
+
+  if(ptr_pool->mode == NUMA_SPREAD)
+  {
+    *ptr_set = ptr_numa->cpus[idx % ptr_numa->num_nodes];
+    return idx % ptr_numa->num_nodes;
+  }
+
+  *ptr_set = ptr_pool->cpus;
+  for(int i = 0; i < ptr_numa->num_nodes; i++)
+  {
+    CPU_AND(&set, ptr_set, &ptr_numa->cpus[i]);
+    if( CPU_EQUAL(&set, ptr_set) )
+    {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+void numa_place(numa_t * ptr_numa, int pool, int idx)
+{
+  cpu_set_t set;
+  unsigned long mask;
+  int node;
+
+  if(ptr_numa->pools[pool].mode == NUMA_ANY)
+  {
+    return;
+  }
+
+  node = numa_thread_cpus(ptr_numa, pool, idx, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if(node >= 0)
+  {
+    // the kernel drops the last bit of maxnode
+    mask = 1UL << ptr_numa->ids[node];
+    if( syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask, NUMA_MAX_NODES + 1) != 0 )
+    {
+      atomic_fetch_add(&ptr_numa->bind_failures, 1);
+    }
+  }
+}
+
+void numa_bind_shared(numa_t * ptr_numa, void * addr, size_t len)
+{
+  uintptr_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t start = ((uintptr_t)addr + page - 1) & ~(page - 1);
+  uintptr_t end = ((uintptr_t)addr + len) & ~(page - 1);
+  unsigned long mask = 0;
+  cpu_set_t set;
+  int num_nodes = 0;
+
+  // collect every node either pool runs on
+  for(int pool = 0; pool < NUMA_NUM_POOLS; pool++)
+  {
+    for(int i = 0; i < ptr_numa->num_nodes; i++)
+    {
+      CPU_AND(&set, &ptr_numa->pools[pool].cpus, &ptr_numa->cpus[i]);
+      if(ptr_numa->pools[pool].mode == NUMA_SPREAD || CPU_COUNT(&set) > 0)
+      {
+        mask |= 1UL << ptr_numa->ids[i];
+      }
+    }
+  }
+  for(int i = 0; i < ptr_numa->num_nodes; i++)
+  {
+    if(mask & (1UL << ptr_numa->ids[i]))
+    {
+      ptr_numa->shared_node = ptr_numa->ids[i];
+      num_nodes++;
+    }
+  }
+  if(num_nodes > 1)
+  {
+    ptr_numa->shared_node = -1;
+  }
+
+  if(end > start &&
+     syscall(SYS_mbind, (void *)start, end - start, num_nodes > 1 ? MPOL_INTERLEAVE : MPOL_BIND,
+             &mask, NUMA_MAX_NODES + 1, MPOL_MF_MOVE) != 0)
+  {
+    atomic_fetch_add(&ptr_numa->bind_failures, 1);
+  }
+}
@@ -0,0 +1,120 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file numa.h
+ * @brief CPU affinity and NUMA placement of the thread pools
+ *
+ * Definitions and declarations for pinning the requester and resolver
+ * threads and placing memory on the nodes they run on. The node layout is
+ * read from /sys and memory is placed with the mbind and set_mempolicy
+ * system calls, so no NUMA library is needed. A machine without /sys node
+ * information is treated as a single node holding every allowed CPU.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __NUMA_H__
+#define __NUMA_H__
+
+#include <stddef.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#define NUMA_MAX_NODES (64)
+
+#define NUMA_REQUESTERS (0)
+#define NUMA_RESOLVERS (1)
+#define NUMA_NUM_POOLS (2)
+
+#define NUMA_ANY (0)
+#define NUMA_CPUS (1)
+#define NUMA_SPREAD (2)
+
+typedef struct
+{
+  int mode;
+  cpu_set_t cpus;
+} numa_pool_t;
+
+typedef struct
+{
+  int num_nodes;
+  int ids[NUMA_MAX_NODES];
+  cpu_set_t cpus[NUMA_MAX_NODES];
+  cpu_set_t allowed;
+  numa_pool_t pools[NUMA_NUM_POOLS];
+  int shared_node;
+  atomic_int bind_failures;
+} numa_t;
+
+/**
+ * @brief Read the node layout, with both pools free to run anywhere
+ *
+ * Only CPUs the process may run on are counted, and nodes without any
+ * are left out.
+ *
+ * @param ptr_numa A pointer to the uninitialized placement pointer
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int numa_init(numa_t ** ptr_numa);
+
+/**
+ * @brief Free a placement from the heap
+ *
+ * @param ptr_numa A pointer to the placement
+ */
+void numa_free(numa_t * ptr_numa);
+
+/**
+ * @brief Choose where the threads of a pool run
+ *
+ * @param ptr_numa A pointer to the placement
+ * @param pool NUMA_REQUESTERS or NUMA_RESOLVERS
+ * @param spec numa to deal the threads out to the nodes in turn, each
+ *             running on every CPU of its node, or a CPU list such as
+ *             0-3,8 that every thread of the pool runs on
+ *
+ * @return 0 if successful, -1 if the spec is invalid or names a CPU the
+ *         process may not run on
+ */
+int numa_set_pool(numa_t * ptr_numa, int pool, const char * spec);
+
+/**
+ * @brief Pin the calling thread and prefer memory on its node
+ *
+ * Called once when the thread starts, before it allocates anything, so
+ * its arena, log buffer and other allocations land on the node it runs
+ * on. Memory is only steered when every CPU of the thread is on one node.
+ *
+ * @param ptr_numa A pointer to the placement
+ * @param pool NUMA_REQUESTERS or NUMA_RESOLVERS
+ * @param idx The index of the calling thread in its pool
+ */
+void numa_place(numa_t * ptr_numa, int pool, int idx);
+
+/**
+ * @brief Move memory shared by both pools to the nodes they run on
+ *
+ * The memory goes to the one node if both pools run on a single node,
+ * and is interleaved page by page over the nodes otherwise. Only whole
+ * pages inside the range are moved.
+ *
+ * @param ptr_numa A pointer to the placement
+ * @param addr The start of the memory
+ * @param len Its length in bytes
+ */
+void numa_bind_shared(numa_t * ptr_numa, void * addr, size_t len);
+
+#endif /* __NUMA_H__ */
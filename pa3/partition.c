@@ -0,0 +1,137 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file partition.c
+ * @brief Hostnames hash-partitioned over resolvers that share nothing
+ *
+ * Implementations for the partitions. Each resolver's cache has a single
+ * shard, since only its owner and the exit summary ever lock it. Owners
+ * are picked with the low bits of the hostname hash, which a cache of one
+ * shard never looks at, since the high bits pick its bucket. Sharing the
+ * high bits would leave each cache using only some of its buckets.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "partition.h"
+
+int partition_init(partition_t ** ptr_partition, int num_partitions, size_t queue_size, size_t cache_size,
+                   size_t negative_cache_size, int negative_ttl_s)
+{
+  partition_t * ptr_p;
+
+  if( (ptr_p = (partition_t *)malloc(sizeof(partition_t))) == NULL )
+  {
+    return -1;
+  }
+  ptr_p->num_partitions = 0;
+  if( (ptr_p->queues = (queue_t **)calloc(num_partitions, sizeof(queue_t *))) == NULL ||
+      (ptr_p->caches = (cache_t **)calloc(num_partitions, sizeof(cache_t *))) == NULL )
+  {
+    free((void *)ptr_p->queues);
+    free((void *)ptr_p);
+    return -1;
+  }
+
+  // the memory bounds are split evenly, as the names are
+  for(int i = 0; i < num_partitions; i++)
+  {
+    if( queue_init(&ptr_p->queues[i], queue_size) != 0 )
+    {
+      partition_free(ptr_p);
+      return -1;
+    }
+    if( cache_init(&ptr_p->caches[i], (cache_size + num_partitions - 1) / num_partitions, 1,
+                   (negative_cache_size + num_partitions - 1) / num_partitions, negative_ttl_s) != 0 )
+    {
+      queue_free(ptr_p->queues[i]);
+      partition_free(ptr_p);
+      return -1;
+    }
+    ptr_p->num_partitions++;
+  }
+
+  *ptr_partition = ptr_p;
+  return 0;
+}
+
+void partition_free(partition_t * ptr_partition)
+{
+  for(int i = 0; i < ptr_partition->num_partitions; i++)
+  {
+    queue_free(ptr_partition->queues[i]);
+    cache_free(ptr_partition->caches[i]);
+  }
+  free((void *)ptr_partition->queues);
+  free((void *)ptr_partition->caches);
+  free((void *)ptr_partition);
+}
+
+int partition_of(partition_t * ptr_partition, const char * hostname)
+{
+  return (uint32_t)cache_hash(hostname) % ptr_partition->num_partitions;
+}
+
+void partition_close(partition_t * ptr_partition)
+{
+  for(int i = 0; i < ptr_partition->num_partitions; i++)
+  {
+    queue_close(ptr_partition->queues[i]);
+  }
+}
+
+void partition_stats(partition_t * ptr_partition, cache_stats_t * ptr_stats)
+{
+  cache_stats_t stats;
+
+  memset(ptr_stats, 0, sizeof(cache_stats_t));
+  for(int i = 0; i < ptr_partition->num_partitions; i++)
+  {
+    cache_stats(ptr_partition->caches[i], &stats);
+    ptr_stats->hits += stats.hits;
+    ptr_stats->negative_hits += stats.negative_hits;
+    ptr_stats->misses += stats.misses;
+    ptr_stats->evictions += stats.evictions;
+    ptr_stats->negative_evictions += stats.negative_evictions;
+    ptr_stats->expirations += stats.expirations;
+    ptr_stats->coalesced += stats.coalesced;
+    ptr_stats->entries += stats.entries;
+    ptr_stats->bytes += stats.bytes;
+    ptr_stats->negative_entries += stats.negative_entries;
+    ptr_stats->negative_bytes += stats.negative_bytes;
+  }
+}
+
+double partition_skew(partition_t * ptr_partition)
+{
+  size_t total = 0;
+  size_t largest = 0;
+  size_t pushed;
+
+  // a queue's tail counts every name ever pushed to it
+  for(int i = 0; i < ptr_partition->num_partitions; i++)
+  {
+    pushed = atomic_load(&ptr_partition->queues[i]->tail);
+    total += pushed;
+    if(pushed > largest)
+    {
+      largest = pushed;
+    }
+  }
+
+  return total == 0 ? 1.0 / ptr_partition->num_partitions : (double)largest / total;
+}
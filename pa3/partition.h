@@ -0,0 +1,99 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file partition.h
+ * @brief Hostnames hash-partitioned over resolvers that share nothing
+ *
+ * Definitions and declarations for giving every resolver thread its own
+ * queue and its own cache. Requesters send each hostname to the resolver
+ * its hash picks, so a name is always looked up, cached and coalesced by
+ * the same thread and the resolvers never touch each other's memory.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __PARTITION_H__
+#define __PARTITION_H__
+
+#include <stddef.h>
+#include "queue.h"
+#include "cache.h"
+
+typedef struct
+{
+  queue_t ** queues;
+  cache_t ** caches;
+  int num_partitions;
+} partition_t;
+
+/**
+ * @brief Create a queue and a cache for each resolver
+ *
+ * @param ptr_partition A pointer to the uninitialized partition pointer
+ * @param num_partitions The number of resolver threads
+ * @param queue_size The capacity of each resolver's queue
+ * @param cache_size The memory bound of all the caches together
+ * @param negative_cache_size The memory bound of all the failed lookups together
+ * @param negative_ttl_s How long a failed lookup is cached in seconds
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int partition_init(partition_t ** ptr_partition, int num_partitions, size_t queue_size, size_t cache_size,
+                   size_t negative_cache_size, int negative_ttl_s);
+
+/**
+ * @brief Free every queue and cache of the partitions from the heap
+ *
+ * @param ptr_partition A pointer to the partitions
+ */
+void partition_free(partition_t * ptr_partition);
+
+/**
+ * @brief Pick the resolver that owns a hostname
+ *
+ * Names differing only in case have the same owner, as they share a
+ * cache entry.
+ *
+ * @param ptr_partition A pointer to the partitions
+ * @param hostname The hostname
+ *
+ * @return The index of the owning resolver
+ */
+int partition_of(partition_t * ptr_partition, const char * hostname);
+
+/**
+ * @brief Close every resolver's queue
+ *
+ * @param ptr_partition A pointer to the partitions
+ */
+void partition_close(partition_t * ptr_partition);
+
+/**
+ * @brief Sum the counters of every resolver's cache
+ *
+ * @param ptr_partition A pointer to the partitions
+ * @param ptr_stats A pointer to where the totals are stored
+ */
+void partition_stats(partition_t * ptr_partition, cache_stats_t * ptr_stats);
+
+/**
+ * @brief The largest share of the hostnames any one resolver was sent
+ *
+ * @param ptr_partition A pointer to the partitions
+ *
+ * @return A fraction from 1 / num_partitions, perfectly even, to 1
+ */
+double partition_skew(partition_t * ptr_partition);
+
+#endif /* __PARTITION_H__ */
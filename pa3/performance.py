@@ -7,10 +7,7 @@ import matplotlib.pyplot as plt
 from mpl_toolkits.mplot3d import Axes3D
 from matplotlib import cm
 from matplotlib.ticker import LinearLocator, FormatStrFormatter
-#from subprocess import run
-from timeit import timeit
-
-T_CONVERSION=100
+import subprocess
 
 # Fetches data from preformatted files
 def get_data(fname):
@@ -35,33 +32,46 @@ def get_data(fname):
 
     return res, req, times
 
-def generate_data(exe):
-    req_list  = []
-    res_list  = []
-    time_list = []
+# Fetches the mean time of each thread count pair from a --sweep CSV
+def get_sweep(fname):
+    runs = {}
+
+    # Open the file
+    f = open(fname)
+    header = f.readline().strip().split(",")
+    if header[:4] != ["requesters", "resolvers", "rep", "seconds"]:
+        print("Error: File Not Formatted Properly")
+        print("Expecting: the CSV written by multi-lookup --sweep")
+        exit()
+    # Sum the time of every repetition of each pair
+    for line in f.readlines():
+        d = line.split(",")
+        key = (int(d[0]), int(d[1]))
+        total, count = runs.get(key, (0.0, 0))
+        runs[key] = (total + float(d[3]), count + 1)
 
+    req_list = [key[0] for key in sorted(runs)]
+    res_list = [key[1] for key in sorted(runs)]
+    time_list = [runs[key][0] / runs[key][1] for key in sorted(runs)]
+
+    return req_list, res_list, time_list
+
+def generate_data(exe):
     # Generate a range for each type of thread
     ### MODIFY HERE ###
     reps = 100
-    for req in range(1, 10):
-        for res in range(1, 10):
-            # Declare parameters and the call arguments for the subprocess.call
-            name_files = "names1.txt names2.txt names3.txt names4.txt names5.txt"
-            parameters = "%s %s" % (req, res)
-            call_arguments = str("""["%s", "%s", "%s", "results.txt", "serviced.txt", "names1.txt", "names2.txt", "names3.txt", "names4.txt", "names5.txt"]""" % ("./"+str(exe), req, res))
-            print(call_arguments)
+    req_range = "1-9"
+    res_range = "1-9"
+    name_files = ["names1.txt", "names2.txt", "names3.txt", "names4.txt", "names5.txt"]
 
-            # Time the program using timeit
-            time = timeit(stmt = "subprocess.call(%s)" % call_arguments, setup = "import subprocess", number=reps) * T_CONVERSION / reps
+    # Run every pair in one process, which loads the names once and times
+    # only the lookups, instead of starting the program for every run
+    call_arguments = ["./"+str(exe), "--sweep=sweep.csv", "--sweep-reps=%d" % reps, req_range, res_range,
+                      "results.txt", "serviced.txt"] + name_files
+    print(call_arguments)
+    subprocess.call(call_arguments)
 
-            #print("Time: %s\n" % time)
-
-            # Store the data
-            req_list.append(req)
-            res_list.append(res)
-            time_list.append(time)
-
-    return req_list, res_list, time_list
+    return get_sweep("sweep.csv")
 
 # Takes the data input and plots it to a 3D graph
 def plot(data):
@@ -114,12 +124,15 @@ if __name__ == "__main__":
         print("Error: Extra Arguments")
         exit()
 
-    # Input arguments
+    # Input arguments, an executable to sweep or a CSV it already wrote
     exe = sys.argv[1]
 
     # Uncomment the following line to test with mock data
     #data = mock_data()
-    data = generate_data(exe)
+    if exe.endswith(".csv"):
+        data = get_sweep(exe)
+    else:
+        data = generate_data(exe)
 
     plot(data)
 
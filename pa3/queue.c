@@ -0,0 +1,354 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file queue.c
+ * @brief Bounded multi-producer/multi-consumer queue of hostnames
+ *
+ * Implementations for the lock-free ring buffer. A slot whose sequence
+ * number equals the tail position is free for a producer, and a slot
+ * whose sequence number is one past the head position holds an item for
+ * a consumer.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "queue.h"
+
+int queue_init(queue_t ** ptr_queue, size_t capacity)
+{
+  size_t size = 2;
+
+  // round capacity up to a power of two so positions can be masked, a
+  // single slot cannot tell a filled slot from a free one on the next lap
+  while(size < capacity) size <<= 1;
+
+  if( posix_memalign((void **)ptr_queue, CACHE_LINE_SIZE, sizeof(queue_t)) != 0 )
+  {
+    return -1;
+  }
+
+  if( ((*ptr_queue)->slots = (queue_slot_t *)malloc(sizeof(queue_slot_t) * size)) == NULL )
+  {
+    free((void *)*ptr_queue);
+    return -1;
+  }
+
+  // each slot starts out free for the producer at its position
+  for(size_t i = 0; i < size; i++)
+  {
+    atomic_init(&(*ptr_queue)->slots[i].seq, i);
+  }
+  (*ptr_queue)->mask = size - 1;
+  atomic_init(&(*ptr_queue)->head, 0);
+  atomic_init(&(*ptr_queue)->tail, 0);
+  atomic_init(&(*ptr_queue)->push_waiters, 0);
+  atomic_init(&(*ptr_queue)->pop_waiters, 0);
+  (*ptr_queue)->closed_f = 0;
+  lockprof_mutex_init(&(*ptr_queue)->mutex, "queue");
+  pthread_cond_init(&(*ptr_queue)->not_full, NULL);
+  pthread_cond_init(&(*ptr_queue)->not_empty, NULL);
+
+  return 0;
+}
+
+void queue_free(queue_t * ptr_queue)
+{
+  lockprof_mutex_destroy(&ptr_queue->mutex);
+  pthread_cond_destroy(&ptr_queue->not_full);
+  pthread_cond_destroy(&ptr_queue->not_empty);
+  free((void *)ptr_queue->slots);
+  free((void *)ptr_queue);
+}
+
+/**
+ * @brief Wake one thread sleeping on a condition if there are any
+ *
+ * The fence orders the caller's queue update before the waiter count is
+ * read. A sleeper increments the count before it re-checks the queue, so
+ * either it sees the update or this sees the sleeper.
+ */
+static void queue_wake(queue_t * ptr_queue, atomic_int * ptr_waiters, pthread_cond_t * ptr_cond)
+{
+  atomic_thread_fence(memory_order_seq_cst);
+  if(atomic_load_explicit(ptr_waiters, memory_order_relaxed) > 0)
+  {
+    lockprof_lock(&ptr_queue->mutex);
+    pthread_cond_signal(ptr_cond);
+    lockprof_unlock(&ptr_queue->mutex);
+  }
+}
+
+/**
+ * @brief Wake every thread sleeping on a condition if there are any
+ *
+ * Used when several slots change at once, since one woken thread may not
+ * use them all.
+ */
+static void queue_wake_all(queue_t * ptr_queue, atomic_int * ptr_waiters, pthread_cond_t * ptr_cond)
+{
+  atomic_thread_fence(memory_order_seq_cst);
+  if(atomic_load_explicit(ptr_waiters, memory_order_relaxed) > 0)
+  {
+    lockprof_lock(&ptr_queue->mutex);
+    pthread_cond_broadcast(ptr_cond);
+    lockprof_unlock(&ptr_queue->mutex);
+  }
+}
+
+/**
+ * @brief Add an item without waking any sleeping consumer
+ */
+static int queue_try_push(queue_t * ptr_queue, const queue_item_t * ptr_item)
+{
+  queue_slot_t * ptr_slot;
+  size_t pos = atomic_load_explicit(&ptr_queue->tail, memory_order_relaxed);
+  intptr_t diff;
+
+  while(1)
+  {
+    ptr_slot = &ptr_queue->slots[pos & ptr_queue->mask];
+    diff = (intptr_t)atomic_load_explicit(&ptr_slot->seq, memory_order_acquire) - (intptr_t)pos;
+
+    if(diff == 0)
+    {
+      // slot is free, try to claim it
+      if( atomic_compare_exchange_weak_explicit(&ptr_queue->tail, &pos, pos + 1,
+                                                memory_order_relaxed, memory_order_relaxed) )
+      {
+        break;
+      }
+    }
+    else if(diff < 0)
+    {
+      // slot still holds an item from the previous lap
+      return -1;
+    }
+    else
+    {
+      // another producer claimed the slot first
+      pos = atomic_load_explicit(&ptr_queue->tail, memory_order_relaxed);
+    }
+  }
+
+  // publish item to consumers
+  ptr_slot->item = *ptr_item;
+  atomic_store_explicit(&ptr_slot->seq, pos + 1, memory_order_release);
+
+  return 0;
+}
+
+/**
+ * @brief Remove an item without waking any sleeping producer
+ */
+static int queue_try_pop(queue_t * ptr_queue, queue_item_t * ptr_item)
+{
+  queue_slot_t * ptr_slot;
+  size_t pos = atomic_load_explicit(&ptr_queue->head, memory_order_relaxed);
+  intptr_t diff;
+
+  while(1)
+  {
+    ptr_slot = &ptr_queue->slots[pos & ptr_queue->mask];
+    diff = (intptr_t)atomic_load_explicit(&ptr_slot->seq, memory_order_acquire) - (intptr_t)(pos + 1);
+
+    if(diff == 0)
+    {
+      // slot holds an item, try to claim it
+      if( atomic_compare_exchange_weak_explicit(&ptr_queue->head, &pos, pos + 1,
+                                                memory_order_relaxed, memory_order_relaxed) )
+      {
+        break;
+      }
+    }
+    else if(diff < 0)
+    {
+      // producer has not filled the slot yet
+      return -1;
+    }
+    else
+    {
+      // another consumer claimed the slot first
+      pos = atomic_load_explicit(&ptr_queue->head, memory_order_relaxed);
+    }
+  }
+
+  // release slot to producers on the next lap
+  *ptr_item = ptr_slot->item;
+  atomic_store_explicit(&ptr_slot->seq, pos + ptr_queue->mask + 1, memory_order_release);
+
+  return 0;
+}
+
+/**
+ * @brief Remove a run of items without waking any sleeping producer
+ *
+ * Counts the slots from the head that already hold items, then claims
+ * them all by moving the head once.
+ */
+static size_t queue_try_pop_batch(queue_t * ptr_queue, queue_item_t * items, size_t max)
+{
+  queue_slot_t * ptr_slot;
+  size_t pos = atomic_load_explicit(&ptr_queue->head, memory_order_relaxed);
+  size_t count;
+  intptr_t diff;
+
+  while(1)
+  {
+    ptr_slot = &ptr_queue->slots[pos & ptr_queue->mask];
+    diff = (intptr_t)atomic_load_explicit(&ptr_slot->seq, memory_order_acquire) - (intptr_t)(pos + 1);
+
+    if(diff < 0)
+    {
+      // producer has not filled the slot yet
+      return 0;
+    }
+    else if(diff > 0)
+    {
+      // another consumer claimed the slot first
+      pos = atomic_load_explicit(&ptr_queue->head, memory_order_relaxed);
+      continue;
+    }
+
+    // a filled slot stays filled until claimed, so the run cannot shrink
+    for(count = 1; count < max; count++)
+    {
+      ptr_slot = &ptr_queue->slots[(pos + count) & ptr_queue->mask];
+      if(atomic_load_explicit(&ptr_slot->seq, memory_order_acquire) != pos + count + 1)
+      {
+        break;
+      }
+    }
+    if( atomic_compare_exchange_weak_explicit(&ptr_queue->head, &pos, pos + count,
+                                              memory_order_relaxed, memory_order_relaxed) )
+    {
+      break;
+    }
+  }
+
+  // release slots to producers on the next lap
+  for(size_t i = 0; i < count; i++)
+  {
+    ptr_slot = &ptr_queue->slots[(pos + i) & ptr_queue->mask];
+    items[i] = ptr_slot->item;
+    atomic_store_explicit(&ptr_slot->seq, pos + i + ptr_queue->mask + 1, memory_order_release);
+  }
+
+  return count;
+}
+
+int queue_pop(queue_t * ptr_queue, queue_item_t * ptr_item)
+{
+  if( queue_try_pop(ptr_queue, ptr_item) != 0 )
+  {
+    return -1;
+  }
+
+  queue_wake(ptr_queue, &ptr_queue->push_waiters, &ptr_queue->not_full);
+
+  return 0;
+}
+
+size_t queue_pop_batch(queue_t * ptr_queue, queue_item_t * items, size_t max)
+{
+  size_t count;
+
+  if( max == 0 || (count = queue_try_pop_batch(ptr_queue, items, max)) == 0 )
+  {
+    return 0;
+  }
+
+  if(count > 1)
+  {
+    queue_wake_all(ptr_queue, &ptr_queue->push_waiters, &ptr_queue->not_full);
+  }
+  else
+  {
+    queue_wake(ptr_queue, &ptr_queue->push_waiters, &ptr_queue->not_full);
+  }
+
+  return count;
+}
+
+int queue_push_wait(queue_t * ptr_queue, const queue_item_t * ptr_item)
+{
+  if( queue_try_push(ptr_queue, ptr_item) != 0 )
+  {
+    // full, sleep until a consumer frees a slot
+    lockprof_lock(&ptr_queue->mutex);
+    atomic_fetch_add(&ptr_queue->push_waiters, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    while( queue_try_push(ptr_queue, ptr_item) != 0 )
+    {
+      if(ptr_queue->closed_f)
+      {
+        atomic_fetch_sub(&ptr_queue->push_waiters, 1);
+        lockprof_unlock(&ptr_queue->mutex);
+        return -1;
+      }
+      lockprof_cond_wait(&ptr_queue->not_full, &ptr_queue->mutex);
+    }
+    atomic_fetch_sub(&ptr_queue->push_waiters, 1);
+    lockprof_unlock(&ptr_queue->mutex);
+  }
+
+  queue_wake(ptr_queue, &ptr_queue->pop_waiters, &ptr_queue->not_empty);
+
+  return 0;
+}
+
+int queue_pop_wait(queue_t * ptr_queue, queue_item_t * ptr_item)
+{
+  if( queue_try_pop(ptr_queue, ptr_item) != 0 )
+  {
+    // empty, sleep until a producer adds an item or the queue is closed
+    lockprof_lock(&ptr_queue->mutex);
+    atomic_fetch_add(&ptr_queue->pop_waiters, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    while( queue_try_pop(ptr_queue, ptr_item) != 0 )
+    {
+      if(ptr_queue->closed_f)
+      {
+        atomic_fetch_sub(&ptr_queue->pop_waiters, 1);
+        lockprof_unlock(&ptr_queue->mutex);
+        return -1;
+      }
+      lockprof_cond_wait(&ptr_queue->not_empty, &ptr_queue->mutex);
+    }
+    atomic_fetch_sub(&ptr_queue->pop_waiters, 1);
+    lockprof_unlock(&ptr_queue->mutex);
+  }
+
+  queue_wake(ptr_queue, &ptr_queue->push_waiters, &ptr_queue->not_full);
+
+  return 0;
+}
+
+void queue_close(queue_t * ptr_queue)
+{
+  lockprof_lock(&ptr_queue->mutex);
+  ptr_queue->closed_f = 1;
+  pthread_cond_broadcast(&ptr_queue->not_full);
+  pthread_cond_broadcast(&ptr_queue->not_empty);
+  lockprof_unlock(&ptr_queue->mutex);
+}
+
+size_t queue_depth(queue_t * ptr_queue)
+{
+  size_t head = atomic_load_explicit(&ptr_queue->head, memory_order_relaxed);
+  size_t tail = atomic_load_explicit(&ptr_queue->tail, memory_order_relaxed);
+
+  return tail > head ? tail - head : 0;
+}
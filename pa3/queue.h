@@ -0,0 +1,153 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file queue.h
+ * @brief Bounded multi-producer/multi-consumer queue of hostnames
+ *
+ * Definitions and declarations for a fixed-capacity, lock-free ring
+ * buffer shared between the requester and resolver threads. Each slot
+ * carries a sequence number so producers and consumers only contend on
+ * the head or tail index, never on a lock, and no memory is allocated
+ * after the queue is created. Threads that find the queue full or empty
+ * can sleep on a condition variable instead of polling; the lock behind
+ * it is only taken when a thread is actually asleep.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __QUEUE_H__
+#define __QUEUE_H__
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "lockprof.h"
+
+#define CACHE_LINE_SIZE (64)
+#define QUEUE_DEFAULT_CAPACITY (1024)
+
+typedef struct
+{
+  char * str;
+  int len;
+  long long enqueue_ns;
+} queue_item_t;
+
+typedef struct
+{
+  atomic_size_t seq;
+  queue_item_t item;
+} queue_slot_t;
+
+typedef struct
+{
+  queue_slot_t * slots;
+  size_t mask;
+  _Alignas(CACHE_LINE_SIZE) atomic_size_t head;
+  _Alignas(CACHE_LINE_SIZE) atomic_size_t tail;
+  _Alignas(CACHE_LINE_SIZE) atomic_int push_waiters;
+  atomic_int pop_waiters;
+  int closed_f;
+  lockprof_mutex_t mutex;
+  pthread_cond_t not_full;
+  pthread_cond_t not_empty;
+} queue_t;
+
+/**
+ * @brief Create a queue
+ *
+ * Allocates a queue whose capacity is the requested capacity rounded up
+ * to the next power of two, and at least two.
+ *
+ * @param ptr_queue A pointer to the uninitialized queue pointer
+ * @param capacity The minimum number of items the queue must hold
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int queue_init(queue_t ** ptr_queue, size_t capacity);
+
+/**
+ * @brief Free a queue from the heap
+ *
+ * Items still in the queue are not freed.
+ *
+ * @param ptr_queue A pointer to the queue
+ */
+void queue_free(queue_t * ptr_queue);
+
+/**
+ * @brief Remove an item from the head of the queue
+ *
+ * @param ptr_queue A pointer to the queue
+ * @param ptr_item A pointer to where the item is copied
+ *
+ * @return 0 if successful, -1 if the queue is empty
+ */
+int queue_pop(queue_t * ptr_queue, queue_item_t * ptr_item);
+
+/**
+ * @brief Remove up to max items from the head of the queue at once
+ *
+ * Claims every item already in place at the head, up to max, with a
+ * single update of the head, and wakes sleeping producers once for all
+ * of them.
+ *
+ * @param ptr_queue A pointer to the queue
+ * @param items An array of at least max items the removed items are copied to
+ * @param max The most items to remove
+ *
+ * @return The number of items removed, 0 if the queue is empty
+ */
+size_t queue_pop_batch(queue_t * ptr_queue, queue_item_t * items, size_t max);
+
+/**
+ * @brief Add an item to the tail of the queue, sleeping while it is full
+ *
+ * @param ptr_queue A pointer to the queue
+ * @param ptr_item A pointer to the item to copy into the queue
+ *
+ * @return 0 if successful, -1 if the queue has been closed
+ */
+int queue_push_wait(queue_t * ptr_queue, const queue_item_t * ptr_item);
+
+/**
+ * @brief Remove an item from the head of the queue, sleeping while it is empty
+ *
+ * @param ptr_queue A pointer to the queue
+ * @param ptr_item A pointer to where the item is copied
+ *
+ * @return 0 if successful, -1 if the queue has been closed and is empty
+ */
+int queue_pop_wait(queue_t * ptr_queue, queue_item_t * ptr_item);
+
+/**
+ * @brief Mark that no more items will be added
+ *
+ * Wakes every sleeping thread. Consumers drain the remaining items and
+ * then see the queue as finished.
+ *
+ * @param ptr_queue A pointer to the queue
+ */
+void queue_close(queue_t * ptr_queue);
+
+/**
+ * @brief Approximate number of items in the queue
+ *
+ * @param ptr_queue A pointer to the queue
+ *
+ * @return The number of items, which may be stale by the time it is used
+ */
+size_t queue_depth(queue_t * ptr_queue);
+
+#endif /* __QUEUE_H__ */
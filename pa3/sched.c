@@ -0,0 +1,149 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file sched.c
+ * @brief Work-stealing scheduler for requester threads
+ *
+ * Implementations for the task deques. Each deque is a fixed run of the
+ * task array, and both of its ends are packed into one 64-bit word so
+ * the owner and thieves claim tasks with a single compare and swap and
+ * can never both take the last one.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#include <stdlib.h>
+#include "sched.h"
+
+#define RANGE_FRONT(r) ((r) & 0xffffffffu)
+#define RANGE_BACK(r) ((r) >> 32)
+#define RANGE(front, back) (((uint_least64_t)(back) << 32) | (front))
+
+int sched_init(sched_t ** ptr_sched, sched_task_t * tasks, size_t num_tasks, int num_deques)
+{
+  size_t front, back;
+
+  if(num_tasks > 0xffffffffu)
+  {
+    return -1;
+  }
+
+  if( (*ptr_sched = (sched_t *)malloc(sizeof(sched_t))) == NULL )
+  {
+    return -1;
+  }
+
+  if( posix_memalign((void **)&(*ptr_sched)->deques, CACHE_LINE_SIZE, sizeof(sched_deque_t) * num_deques) != 0 )
+  {
+    free((void *)*ptr_sched);
+    return -1;
+  }
+
+  // neighbouring tasks are usually neighbouring ranges of the same file,
+  // so give each deque a contiguous run of them
+  for(int i = 0; i < num_deques; i++)
+  {
+    front = num_tasks * i / num_deques;
+    back = num_tasks * (i + 1) / num_deques;
+    atomic_init(&(*ptr_sched)->deques[i].range, RANGE(front, back));
+    (*ptr_sched)->deques[i].steals = 0;
+  }
+  (*ptr_sched)->tasks = tasks;
+  (*ptr_sched)->num_tasks = num_tasks;
+  (*ptr_sched)->num_deques = num_deques;
+
+  return 0;
+}
+
+void sched_free(sched_t * ptr_sched)
+{
+  free((void *)ptr_sched->tasks);
+  free((void *)ptr_sched->deques);
+  free((void *)ptr_sched);
+}
+
+/**
+ * @brief Claim the task at one end of a deque
+ *
+ * @return The index of the task, or -1 if the deque is empty
+ */
+static long sched_take(sched_deque_t * ptr_deque, int back_f)
+{
+  uint_least64_t range = atomic_load_explicit(&ptr_deque->range, memory_order_relaxed);
+  uint_least64_t front, back;
+
+  while(1)
+  {
+    front = RANGE_FRONT(range);
+    back = RANGE_BACK(range);
+    if(front >= back)
+    {
+      return -1;
+    }
+
+    if(back_f)
+    {
+      back--;
+    }
+    else
+    {
+      front++;
+    }
+
+    if( atomic_compare_exchange_weak_explicit(&ptr_deque->range, &range, RANGE(front, back),
+                                              memory_order_relaxed, memory_order_relaxed) )
+    {
+      return back_f ? (long)back : (long)front - 1;
+    }
+  }
+}
+
+int sched_next(sched_t * ptr_sched, int self, sched_task_t * ptr_task)
+{
+  long idx;
+
+  // run own tasks in order so a file is read front to back
+  if( (idx = sched_take(&ptr_sched->deques[self], 0)) < 0 )
+  {
+    // steal the task furthest from where each owner is reading
+    for(int i = 1; i < ptr_sched->num_deques; i++)
+    {
+      if( (idx = sched_take(&ptr_sched->deques[(self + i) % ptr_sched->num_deques], 1)) >= 0 )
+      {
+        ptr_sched->deques[self].steals++;
+        break;
+      }
+    }
+    if(idx < 0)
+    {
+      return -1;
+    }
+  }
+
+  *ptr_task = ptr_sched->tasks[idx];
+
+  return 0;
+}
+
+unsigned long sched_steals(sched_t * ptr_sched)
+{
+  unsigned long total = 0;
+
+  for(int i = 0; i < ptr_sched->num_deques; i++)
+  {
+    total += ptr_sched->deques[i].steals;
+  }
+
+  return total;
+}
@@ -0,0 +1,101 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file sched.h
+ * @brief Work-stealing scheduler for requester threads
+ *
+ * Definitions and declarations for a set of task deques, one per
+ * requester thread. Every input file is split into byte-range tasks up
+ * front, and the tasks are dealt out to the deques in contiguous runs.
+ * A requester takes tasks from the front of its own deque, and once that
+ * is empty it steals from the back of the others, so the threads stay
+ * busy however unevenly the work is spread across the files.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __SCHED_H__
+#define __SCHED_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "queue.h"
+
+typedef struct
+{
+  int file_idx;
+  size_t start;
+  size_t end;
+} sched_task_t;
+
+typedef struct
+{
+  // index of the front task in the low half, one past the back in the high half
+  _Alignas(CACHE_LINE_SIZE) atomic_uint_least64_t range;
+  unsigned long steals;
+} sched_deque_t;
+
+typedef struct
+{
+  sched_task_t * tasks;
+  size_t num_tasks;
+  sched_deque_t * deques;
+  int num_deques;
+} sched_t;
+
+/**
+ * @brief Create a scheduler and deal tasks out to its deques
+ *
+ * @param ptr_sched A pointer to the uninitialized scheduler pointer
+ * @param tasks The tasks, in the order a single thread should run them,
+ *              taken over by the scheduler
+ * @param num_tasks The number of tasks
+ * @param num_deques The number of deques, one per thread
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int sched_init(sched_t ** ptr_sched, sched_task_t * tasks, size_t num_tasks, int num_deques);
+
+/**
+ * @brief Free a scheduler and its tasks from the heap
+ *
+ * @param ptr_sched A pointer to the scheduler
+ */
+void sched_free(sched_t * ptr_sched);
+
+/**
+ * @brief Take the next task for a thread, stealing if its deque is empty
+ *
+ * No tasks are added once the scheduler is created, so once this fails
+ * there is no work left for any thread.
+ *
+ * @param ptr_sched A pointer to the scheduler
+ * @param self The index of the calling thread's deque
+ * @param ptr_task A pointer to where the task is stored
+ *
+ * @return 0 if a task was taken, -1 if every deque is empty
+ */
+int sched_next(sched_t * ptr_sched, int self, sched_task_t * ptr_task);
+
+/**
+ * @brief Sum the tasks stolen from other deques
+ *
+ * @param ptr_sched A pointer to the scheduler
+ *
+ * @return The number of tasks run by a thread other than their owner
+ */
+unsigned long sched_steals(sched_t * ptr_sched);
+
+#endif /* __SCHED_H__ */
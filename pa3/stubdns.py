@@ -0,0 +1,178 @@
+#!/usr/bin/env python
+
+# Stub DNS server for testing multi-lookup --async offline
+#
+#   python stubdns.py PORT          answer queries on 127.0.0.1:PORT until killed
+#   python stubdns.py --test EXE    run EXE --async against a stub and check the results
+#
+# The first label of a name picks how it is answered:
+#   nx        NXDOMAIN
+#   drop      never answered, so the lookup times out
+#   once      the first query is dropped and the resend is answered
+#   badid     an answer with the wrong transaction ID comes first
+#   badname   an answer with the right ID but another question name comes first
+#   tc        an answer with the truncated bit set
+#   v4only    AAAA queries get an empty answer
+#   v6only    A queries get an empty answer
+# Every other name resolves to an IPv4 and an IPv6 address made from its hash.
+
+from __future__ import print_function
+import os
+import shutil
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import threading
+import zlib
+
+FLAG_ANSWER = 0x8180
+FLAG_NXDOMAIN = 0x8183
+FLAG_TC = 0x0200
+
+TYPE_A = 1
+TYPE_AAAA = 28
+
+# Address a name resolves to, as text and as record data
+def address(name, qtype=TYPE_A):
+    h = struct.pack(">I", zlib.crc32(name.encode()) & 0xFFFFFFFF)
+    if qtype == TYPE_AAAA:
+        rdata = b"\x20\x01\x0d\xb8" + bytes(bytearray(8)) + h
+        return socket.inet_ntop(socket.AF_INET6, rdata), rdata
+    return socket.inet_ntoa(h), h
+
+# Build a response to a question, with one record of the asked type unless there is no rdata
+def response(qid, flags, question, qtype, rdata):
+    if rdata is None:
+        return struct.pack(">HHHHHH", qid, flags, 1, 0, 0, 0) + question
+    record = b"\xc0\x0c" + struct.pack(">HHIH", qtype, 1, 300, len(rdata)) + rdata
+    return struct.pack(">HHHHHH", qid, flags, 1, 1, 0, 0) + question + record
+
+# Split a query into its ID, question name, question type and the raw question section
+def parse_query(data):
+    qid = struct.unpack(">H", data[:2])[0]
+    offset = 12
+    labels = []
+    while data[offset] != 0:
+        length = data[offset]
+        labels.append(data[offset + 1:offset + 1 + length].decode())
+        offset += 1 + length
+    qtype = struct.unpack(">H", data[offset + 1:offset + 3])[0]
+    return qid, labels, qtype, bytes(data[12:offset + 5])
+
+# Encode a name as a question
+def question(name, qtype):
+    encoded = b"".join(struct.pack("B", len(label)) + label.encode() for label in name.split("."))
+    return encoded + b"\x00" + struct.pack(">HH", qtype, 1)
+
+# Answer queries until the socket is closed, remembering the once names already dropped in seen
+def serve(sock, seen):
+    while True:
+        try:
+            data, client = sock.recvfrom(2048)
+        except OSError:
+            return
+        qid, labels, qtype, q = parse_query(bytearray(data))
+        name = ".".join(labels)
+        kind = labels[0].split("-")[0]
+        rdata = address(name, qtype)[1]
+        decoy = address("decoy." + name, qtype)[1]
+
+        if kind == "drop":
+            continue
+        if kind == "once" and (name, qtype) not in seen:
+            seen.add((name, qtype))
+            continue
+        if kind == "nx":
+            sock.sendto(response(qid, FLAG_NXDOMAIN, q, qtype, None), client)
+            continue
+        if kind == "tc":
+            sock.sendto(response(qid, FLAG_ANSWER | FLAG_TC, q, qtype, rdata), client)
+            continue
+        if (kind == "v4only" and qtype == TYPE_AAAA) or (kind == "v6only" and qtype == TYPE_A):
+            rdata = None
+        if kind == "badid":
+            sock.sendto(response(qid ^ 0x5A5A, FLAG_ANSWER, q, qtype, decoy), client)
+        if kind == "badname":
+            sock.sendto(response(qid, FLAG_ANSWER, question("decoy." + name, qtype), qtype, decoy), client)
+        sock.sendto(response(qid, FLAG_ANSWER, q, qtype, rdata), client)
+
+# Expected resolver log entry of a name, the empty string for a failure
+def expected_result(name, all_f):
+    kind = name.split("-")[0]
+    if kind in ("nx", "drop", "tc") or (kind == "v6only" and not all_f):
+        return ""
+    if not all_f:
+        return address(name)[0]
+    addrs = []
+    if kind != "v6only":
+        addrs.append(address(name)[0])
+    if kind != "v4only":
+        addrs.append(address(name, TYPE_AAAA)[0])
+    return ",".join(addrs)
+
+# Run the program against the stub once and compare every line of the resolver log
+def check(exe, port, seen, tmp, names, options, all_f):
+    requester_log = os.path.join(tmp, "serviced.txt")
+    resolver_log = os.path.join(tmp, "results.txt")
+    names_file = os.path.join(tmp, "names.txt")
+    with open(names_file, "w") as f:
+        f.write("\n".join(names) + "\n")
+    seen.clear()
+
+    call_arguments = [exe, "--async", "--dns-server=127.0.0.1:%d" % port, "--dns-timeout=200", "--dns-retries=1",
+                      "--cache-size=0", "--negative-cache-size=0"] + options + \
+                     ["1", "1", requester_log, resolver_log, names_file]
+    if subprocess.call(call_arguments, stdout=open(os.devnull, "w")) != 0:
+        print("FAIL: %s exited with an error" % " ".join(call_arguments))
+        return 1
+
+    failures = 0
+    results = {}
+    for line in open(resolver_log):
+        name, addrs = line.rstrip("\n").split(",", 1)
+        results[name] = addrs
+    for name in names:
+        if results.get(name) != expected_result(name, all_f):
+            print("FAIL: %s %s resolved to %r, expected %r" % (" ".join(options), name, results.get(name),
+                                                               expected_result(name, all_f)))
+            failures += 1
+    print("%s%d of %d names resolved as expected" % (" ".join(options) + ": " if options else "",
+                                                      len(names) - failures, len(names)))
+    return failures
+
+def test(exe):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("127.0.0.1", 0))
+    port = sock.getsockname()[1]
+    seen = set()
+    server = threading.Thread(target=serve, args=(sock, seen))
+    server.daemon = True
+    server.start()
+
+    names = []
+    for i in range(20):
+        for kind in ("host", "once", "badid", "badname", "v4only", "v6only"):
+            names.append("%s-%d.example.com" % (kind, i))
+    for i in range(5):
+        for kind in ("nx", "drop", "tc"):
+            names.append("%s-%d.example.com" % (kind, i))
+
+    tmp = tempfile.mkdtemp()
+    failures = check(exe, port, seen, tmp, names, [], False)
+    failures += check(exe, port, seen, tmp, names, ["--all-addresses"], True)
+    sock.close()
+    shutil.rmtree(tmp)
+    return 1 if failures > 0 else 0
+
+if __name__ == "__main__":
+    if len(sys.argv) == 3 and sys.argv[1] == "--test":
+        sys.exit(test(sys.argv[2]))
+    elif len(sys.argv) == 2:
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        sock.bind(("127.0.0.1", int(sys.argv[1])))
+        serve(sock, set())
+    else:
+        print("Usage: %s PORT | --test EXE" % sys.argv[0])
+        sys.exit(1)
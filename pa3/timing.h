@@ -0,0 +1,48 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file timing.h
+ * @brief Monotonic clock helpers
+ *
+ * Readings of the monotonic clock for timeouts and expiry, which unlike
+ * gettimeofday never jump when the wall clock is adjusted.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __TIMING_H__
+#define __TIMING_H__
+
+#include <time.h>
+
+/**
+ * @brief Current time on the monotonic clock in nanoseconds
+ */
+static inline long long now_ns(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long long)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * @brief Current time on the monotonic clock in milliseconds
+ */
+static inline long long now_ms(void)
+{
+  return now_ns() / 1000000;
+}
+
+#endif /* __TIMING_H__ */
@@ -0,0 +1,388 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file tokenize.c
+ * @brief Split an in-memory input buffer into hostnames
+ *
+ * Implementations for the buffer tokenizer. Whitespace is the same set
+ * isspace() uses in the C locale, checked directly so the result does
+ * not depend on the process locale. The vector loops only load whole
+ * vectors that lie inside the buffer and finish with the scalar loop, so
+ * they never read past its end. Each byte is tested as an unsigned
+ * offset from the start of a range, which SSE2 can do with min and
+ * compare, so every implementation classifies every byte the same way.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#include <string.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TOKENIZE_X86
+#endif
+#include "tokenize.h"
+
+#define IS_SPACE(c) ((c) == ' ' || ((c) >= '\t' && (c) <= '\r'))
+#define TO_LOWER(c) ((c) >= 'A' && (c) <= 'Z' ? (c) | 0x20 : (c))
+
+/**
+ * @brief Find the next token from *ptr_pos, copying it to dst unless NULL
+ *
+ * @return 0 with *ptr_start set if a token was found, -1 otherwise
+ */
+typedef int (* tokenize_scan_t)(const char * buf, size_t end, size_t * ptr_pos, size_t * ptr_start, char * dst,
+                                int lower_f);
+
+/**
+ * @brief Find the next token a byte at a time
+ */
+static int tokenize_scan_scalar(const char * buf, size_t end, size_t * ptr_pos, size_t * ptr_start, char * dst,
+                                int lower_f)
+{
+  size_t pos = *ptr_pos;
+  size_t start, limit;
+  char c;
+
+  while(pos < end && IS_SPACE(buf[pos])) pos++;
+  if(pos >= end)
+  {
+    *ptr_pos = pos;
+    return -1;
+  }
+
+  start = pos;
+  limit = end - start > TOKEN_MAX_LEN ? start + TOKEN_MAX_LEN : end;
+  while(pos < limit && !IS_SPACE(c = buf[pos]))
+  {
+    if(dst != NULL)
+    {
+      dst[pos - start] = lower_f ? TO_LOWER(c) : c;
+    }
+    pos++;
+  }
+
+  *ptr_start = start;
+  *ptr_pos = pos;
+  return 0;
+}
+
+#ifdef TOKENIZE_X86
+/**
+ * @brief Set a bit for each whitespace byte of a 16 byte vector
+ */
+static inline unsigned tokenize_space_sse2(__m128i v)
+{
+  __m128i ctrl = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+
+  ctrl = _mm_cmpeq_epi8(_mm_min_epu8(ctrl, _mm_set1_epi8('\r' - '\t')), ctrl);
+  return _mm_movemask_epi8(_mm_or_si128(ctrl, _mm_cmpeq_epi8(v, _mm_set1_epi8(' '))));
+}
+
+/**
+ * @brief Lower-case the ASCII letters of a 16 byte vector
+ */
+static inline __m128i tokenize_lower_sse2(__m128i v)
+{
+  __m128i upper = _mm_sub_epi8(v, _mm_set1_epi8('A'));
+
+  upper = _mm_cmpeq_epi8(_mm_min_epu8(upper, _mm_set1_epi8('Z' - 'A')), upper);
+  return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+/**
+ * @brief Find the next token 16 bytes at a time
+ */
+__attribute__((target("sse2")))
+static int tokenize_scan_sse2(const char * buf, size_t end, size_t * ptr_pos, size_t * ptr_start, char * dst,
+                              int lower_f)
+{
+  size_t pos = *ptr_pos;
+  size_t start, limit;
+  unsigned mask;
+  __m128i v;
+  char c;
+
+  // skip whitespace, then stop on the first byte that is not
+  while(pos < end)
+  {
+    if(pos + 16 <= end)
+    {
+      if( (mask = ~tokenize_space_sse2(_mm_loadu_si128((const __m128i *)(buf + pos))) & 0xffff) == 0 )
+      {
+        pos += 16;
+        continue;
+      }
+      pos += __builtin_ctz(mask);
+      break;
+    }
+    if(!IS_SPACE(buf[pos]))
+    {
+      break;
+    }
+    pos++;
+  }
+  if(pos >= end)
+  {
+    *ptr_pos = pos;
+    return -1;
+  }
+
+  // copy whole vectors until one holds whitespace, then cut the token there
+  start = pos;
+  limit = end - start > TOKEN_MAX_LEN ? start + TOKEN_MAX_LEN : end;
+  while(pos < limit)
+  {
+    if(pos + 16 <= end)
+    {
+      v = _mm_loadu_si128((const __m128i *)(buf + pos));
+      if(dst != NULL)
+      {
+        _mm_storeu_si128((__m128i *)(dst + pos - start), lower_f ? tokenize_lower_sse2(v) : v);
+      }
+      if( (mask = tokenize_space_sse2(v)) != 0 )
+      {
+        pos += __builtin_ctz(mask);
+        break;
+      }
+      pos += 16;
+      continue;
+    }
+    if(IS_SPACE(c = buf[pos]))
+    {
+      break;
+    }
+    if(dst != NULL)
+    {
+      dst[pos - start] = lower_f ? TO_LOWER(c) : c;
+    }
+    pos++;
+  }
+
+  *ptr_start = start;
+  *ptr_pos = pos < limit ? pos : limit;
+  return 0;
+}
+
+/**
+ * @brief Set a bit for each whitespace byte of a 32 byte vector
+ */
+__attribute__((target("avx2")))
+static inline unsigned tokenize_space_avx2(__m256i v)
+{
+  __m256i ctrl = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+
+  ctrl = _mm256_cmpeq_epi8(_mm256_min_epu8(ctrl, _mm256_set1_epi8('\r' - '\t')), ctrl);
+  return (unsigned)_mm256_movemask_epi8(_mm256_or_si256(ctrl, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '))));
+}
+
+/**
+ * @brief Lower-case the ASCII letters of a 32 byte vector
+ */
+__attribute__((target("avx2")))
+static inline __m256i tokenize_lower_avx2(__m256i v)
+{
+  __m256i upper = _mm256_sub_epi8(v, _mm256_set1_epi8('A'));
+
+  upper = _mm256_cmpeq_epi8(_mm256_min_epu8(upper, _mm256_set1_epi8('Z' - 'A')), upper);
+  return _mm256_or_si256(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+/**
+ * @brief Find the next token 32 bytes at a time
+ */
+__attribute__((target("avx2")))
+static int tokenize_scan_avx2(const char * buf, size_t end, size_t * ptr_pos, size_t * ptr_start, char * dst,
+                              int lower_f)
+{
+  size_t pos = *ptr_pos;
+  size_t start, limit;
+  unsigned mask;
+  __m256i v;
+  char c;
+
+  // skip whitespace, then stop on the first byte that is not
+  while(pos < end)
+  {
+    if(pos + 32 <= end)
+    {
+      if( (mask = ~tokenize_space_avx2(_mm256_loadu_si256((const __m256i *)(buf + pos)))) == 0 )
+      {
+        pos += 32;
+        continue;
+      }
+      pos += __builtin_ctz(mask);
+      break;
+    }
+    if(!IS_SPACE(buf[pos]))
+    {
+      break;
+    }
+    pos++;
+  }
+  if(pos >= end)
+  {
+    *ptr_pos = pos;
+    return -1;
+  }
+
+  // copy whole vectors until one holds whitespace, then cut the token there
+  start = pos;
+  limit = end - start > TOKEN_MAX_LEN ? start + TOKEN_MAX_LEN : end;
+  while(pos < limit)
+  {
+    if(pos + 32 <= end)
+    {
+      v = _mm256_loadu_si256((const __m256i *)(buf + pos));
+      if(dst != NULL)
+      {
+        _mm256_storeu_si256((__m256i *)(dst + pos - start), lower_f ? tokenize_lower_avx2(v) : v);
+      }
+      if( (mask = tokenize_space_avx2(v)) != 0 )
+      {
+        pos += __builtin_ctz(mask);
+        break;
+      }
+      pos += 32;
+      continue;
+    }
+    if(IS_SPACE(c = buf[pos]))
+    {
+      break;
+    }
+    if(dst != NULL)
+    {
+      dst[pos - start] = lower_f ? TO_LOWER(c) : c;
+    }
+    pos++;
+  }
+
+  *ptr_start = start;
+  *ptr_pos = pos < limit ? pos : limit;
+  return 0;
+}
+#endif
+
+static tokenize_scan_t tokenize_scan = tokenize_scan_scalar;
+
+const char * tokenize_init(int simd_f)
+{
+  tokenize_scan = tokenize_scan_scalar;
+#ifdef TOKENIZE_X86
+  __builtin_cpu_init();
+  if(simd_f && __builtin_cpu_supports("avx2"))
+  {
+    tokenize_scan = tokenize_scan_avx2;
+    return "avx2";
+  }
+  if(simd_f && __builtin_cpu_supports("sse2"))
+  {
+    tokenize_scan = tokenize_scan_sse2;
+    return "sse2";
+  }
+#endif
+
+  return "scalar";
+}
+
+size_t tokenize_chunk_start(const char * buf, size_t len, size_t offset)
+{
+  const char * newline;
+
+  if(offset == 0)
+  {
+    return 0;
+  }
+  if(offset > len)
+  {
+    return len;
+  }
+  if( (newline = memchr(buf + offset - 1, '\n', len - offset + 1)) == NULL )
+  {
+    return len;
+  }
+
+  return newline - buf + 1;
+}
+
+size_t tokenize_fd_chunk_start(int fd, size_t len, size_t offset)
+{
+  char scan[TOKEN_SCAN_SIZE];
+  const char * newline;
+  ssize_t num_read;
+
+  if(offset == 0)
+  {
+    return 0;
+  }
+
+  // read forward from the byte before the offset until a newline turns up
+  for(offset--; offset < len; offset += num_read)
+  {
+    if( (num_read = pread(fd, scan, sizeof(scan), offset)) <= 0 )
+    {
+      return len;
+    }
+    if( (newline = memchr(scan, '\n', num_read)) != NULL )
+    {
+      return offset + (newline - scan) + 1;
+    }
+  }
+
+  return len;
+}
+
+size_t tokenize_stream_end(const char * buf, size_t len)
+{
+  size_t end = len;
+
+  while(end > 0 && !IS_SPACE(buf[end - 1])) end--;
+
+  // with no whitespace the block is all one token, which fscanf splits
+  // every TOKEN_MAX_LEN characters
+  if(end == 0)
+  {
+    end = len - len % TOKEN_MAX_LEN;
+  }
+
+  return end;
+}
+
+int tokenize_next(const char * buf, size_t end, size_t * ptr_pos, const char ** ptr_token, int * ptr_token_len)
+{
+  size_t start;
+
+  if( tokenize_scan(buf, end, ptr_pos, &start, NULL, 0) != 0 )
+  {
+    return -1;
+  }
+  *ptr_token = buf + start;
+  *ptr_token_len = *ptr_pos - start;
+
+  return 0;
+}
+
+int tokenize_next_copy(const char * buf, size_t end, size_t * ptr_pos, char * dst, int * ptr_token_len, int lower_f)
+{
+  size_t start;
+
+  if( tokenize_scan(buf, end, ptr_pos, &start, dst, lower_f) != 0 )
+  {
+    return -1;
+  }
+  *ptr_token_len = *ptr_pos - start;
+  dst[*ptr_token_len] = '\0';
+
+  return 0;
+}
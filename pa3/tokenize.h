@@ -0,0 +1,135 @@
+/******************************************************************************
+ * Copyright (C) 2018
+ * Christopher Morroni
+ * University of Colorado, Boulder
+ *
+ * Redistribution, modification, or use of this software in source or binary
+ * forms is permitted as long as the files maintain this copyright. Users are
+ * permitted to modify this and use it to learn about the field of operating
+ * systems. Christopher Morroni and the University of Colorado are not liable
+ * for any misuse of this material.
+ *
+ *****************************************************************************/
+/**
+ * @file tokenize.h
+ * @brief Split an in-memory input buffer into hostnames
+ *
+ * Definitions and declarations for reading hostnames straight out of a
+ * buffer, such as a memory-mapped data file. Tokens are found the same
+ * way fscanf("%1024s") finds them, so every way of reading a file gives
+ * the same hostnames. On x86 the delimiters are found 32 bytes at a time
+ * with AVX2 or 16 at a time with SSE2, whichever the CPU has, and a
+ * scalar loop that splits the input the same way is used elsewhere.
+ *
+ * @author agent
+ * @date 2026-10-18
+ */
+
+#ifndef __TOKENIZE_H__
+#define __TOKENIZE_H__
+
+#include <stddef.h>
+
+#define TOKEN_SCAN_SIZE (4096)
+
+#define TOKEN_MAX_LEN (1024)
+// widest vector store, which may run past the end of a copied token
+#define TOKEN_SIMD_WIDTH (32)
+// room a copied token needs, including the null and vector overrun
+#define TOKEN_COPY_SIZE (TOKEN_MAX_LEN + TOKEN_SIMD_WIDTH)
+// bytes read from a stream at a time
+#define TOKEN_STREAM_READ_SIZE (64 * 1024)
+
+/**
+ * @brief Choose how tokens are found
+ *
+ * Called once before any tokens are read. Until then the scalar loop is
+ * used.
+ *
+ * @param simd_f Whether to use the widest vector instructions the CPU has
+ *
+ * @return The name of the chosen implementation, "avx2", "sse2" or "scalar"
+ */
+const char * tokenize_init(int simd_f);
+
+/**
+ * @brief Find the start of the chunk containing an offset
+ *
+ * Chunks always begin just after a newline, so every thread splitting a
+ * buffer at the same offsets agrees on the boundaries and no hostname is
+ * cut in two.
+ *
+ * @param buf The buffer
+ * @param len The length of the buffer
+ * @param offset The nominal start of the chunk
+ *
+ * @return The offset just past the first newline at or after offset - 1,
+ *         0 for offset 0, or len if there is none
+ */
+size_t tokenize_chunk_start(const char * buf, size_t len, size_t offset);
+
+/**
+ * @brief Find the start of the chunk containing an offset of a file
+ *
+ * The same as tokenize_chunk_start() for a file that is read with
+ * pread() instead of being mapped.
+ *
+ * @param fd The file descriptor
+ * @param len The length of the file
+ * @param offset The nominal start of the chunk
+ *
+ * @return The offset just past the first newline at or after offset - 1,
+ *         0 for offset 0, or len if there is none or the file cannot be read
+ */
+size_t tokenize_fd_chunk_start(int fd, size_t len, size_t offset);
+
+/**
+ * @brief Find where the complete tokens of a block read from a stream end
+ *
+ * The rest of the block may be the start of a token that continues in
+ * the next block, so it is kept and read again with it.
+ *
+ * @param buf The block, starting at a token boundary
+ * @param len The length of the block
+ *
+ * @return The offset just past the last whitespace, or the longest run of
+ *         whole TOKEN_MAX_LEN tokens if there is none
+ */
+size_t tokenize_stream_end(const char * buf, size_t len);
+
+/**
+ * @brief Find the next token in a buffer
+ *
+ * Skips whitespace, then takes everything up to the next whitespace or
+ * TOKEN_MAX_LEN characters, whichever comes first.
+ *
+ * @param buf The buffer
+ * @param end The offset at which to stop
+ * @param ptr_pos The offset to start from, advanced past the token
+ * @param ptr_token Where a pointer to the token is stored
+ * @param ptr_token_len Where the length of the token is stored
+ *
+ * @return 0 if a token was found, -1 at the end of the buffer
+ */
+int tokenize_next(const char * buf, size_t end, size_t * ptr_pos, const char ** ptr_token, int * ptr_token_len);
+
+/**
+ * @brief Find the next token in a buffer and copy it out in the same pass
+ *
+ * Finds the same token as tokenize_next(), copying each block of input
+ * while its delimiters are searched, and lower-cases ASCII letters on the
+ * way if asked to.
+ *
+ * @param buf The buffer
+ * @param end The offset at which to stop
+ * @param ptr_pos The offset to start from, advanced past the token
+ * @param dst Where the null terminated token is copied, which must have
+ *            room for TOKEN_COPY_SIZE bytes
+ * @param ptr_token_len Where the length of the token is stored
+ * @param lower_f Whether to lower-case the copy
+ *
+ * @return 0 if a token was found, -1 at the end of the buffer
+ */
+int tokenize_next_copy(const char * buf, size_t end, size_t * ptr_pos, char * dst, int * ptr_token_len, int lower_f);
+
+#endif /* __TOKENIZE_H__ */
@@ -83,3 +83,43 @@ int dnslookup(const char* hostname, char* firstIPstr, int maxSize){
 
     return UTIL_SUCCESS;
 }
+
+int dnslookup_all(const char* hostname, addr_set_t* addrs, int ipv6_f){
+
+    /* Local vars */
+    struct addrinfo hints;
+    struct addrinfo* headresult = NULL;
+    struct addrinfo* result = NULL;
+    int addrError = 0;
+
+    /* Ask for IPv6 only when wanted, one socket type so each address comes back once */
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = ipv6_f ? AF_UNSPEC : AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    /* Lookup Hostname */
+    addrError = getaddrinfo(hostname, NULL, &hints, &headresult);
+    if(addrError){
+	return UTIL_FAILURE;
+    }
+
+    /* Keep Every Address in Binary Form, IPv4 First */
+    addrs->count = 0;
+    for(result=headresult; result != NULL; result = result->ai_next){
+	if(result->ai_addr->sa_family == AF_INET){
+	    addr_set_add(addrs, ADDR_V4,
+			 &((struct sockaddr_in*)result->ai_addr)->sin_addr);
+	}
+    }
+    for(result=headresult; result != NULL; result = result->ai_next){
+	if(result->ai_addr->sa_family == AF_INET6){
+	    addr_set_add(addrs, ADDR_V6,
+			 &((struct sockaddr_in6*)result->ai_addr)->sin6_addr);
+	}
+    }
+
+    /* Cleanup */
+    freeaddrinfo(headresult);
+
+    return addrs->count > 0 ? UTIL_SUCCESS : UTIL_FAILURE;
+}
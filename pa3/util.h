@@ -28,6 +28,8 @@
 #include <sys/socket.h>
 #include <netdb.h>
 
+#include "addr.h"
+
 #define UTIL_FAILURE -1
 #define UTIL_SUCCESS 0
 
@@ -39,4 +41,12 @@ int dnslookup(const char* hostname,
 	      char* firstIPstr,
 	      int maxSize);
 
+/* Fuction to return every IPv4 address found for
+ * hostname in binary form in addrs, followed by
+ * every IPv6 address when ipv6_f is set
+ */
+int dnslookup_all(const char* hostname,
+		  addr_set_t* addrs,
+		  int ipv6_f);
+
 #endif